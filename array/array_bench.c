@@ -0,0 +1,676 @@
+#include "sc_array.h"
+#include "sc_map.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static uint64_t time_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+static uint64_t rand64(uint64_t *state)
+{
+    uint64_t x = *state;
+
+    x ^= x << 13u;
+    x ^= x >> 7u;
+    x ^= x << 17u;
+    *state = x;
+
+    return x;
+}
+
+struct bench_item
+{
+    uint64_t key;
+    uint64_t payload;
+};
+
+#define u64_less(a, b)  ((a) < (b))
+#define u64_key(a)      (a)
+#define item_less(a, b) ((a).key < (b).key)
+#define item_key(a)     ((a).key)
+
+sc_array_sort_of(u64, uint64_t, u64_less)
+sc_array_radix_of(u64, uint64_t, uint64_t, u64_key)
+sc_array_sort_of(item, struct bench_item, item_less)
+sc_array_radix_of(item, struct bench_item, uint64_t, item_key)
+sc_array_sort_parallel_of(u64, uint64_t, u64_less)
+sc_array_set_of(u64, uint64_t, u64_less)
+
+static int cmp_u64(const void *a, const void *b)
+{
+    const uint64_t *x = a;
+    const uint64_t *y = b;
+
+    return *x < *y ? -1 : *x > *y;
+}
+
+static int cmp_item(const void *a, const void *b)
+{
+    const struct bench_item *x = a;
+    const struct bench_item *y = b;
+
+    return x->key < y->key ? -1 : x->key > y->key;
+}
+
+static const char *dists[] = {"random", "sorted", "reversed", "few unique",
+                              "small"};
+
+static uint64_t bench_value(int dist, uint64_t *seed, size_t i, size_t n)
+{
+    switch (dist) {
+    case 0:
+        return rand64(seed);
+    case 1:
+        return i;
+    case 2:
+        return n - i;
+    case 3:
+        return rand64(seed) % 16;
+    default:
+        // Random 20 bit keys in a 64 bit type
+        return rand64(seed) & 0xfffffu;
+    }
+}
+
+#define bench_sort(T, name, fill)                                              \
+    do {                                                                       \
+        T *arr, *src;                                                          \
+        uint64_t seed, start, q, s, r;                                         \
+                                                                               \
+        for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++) {        \
+            const size_t n = sizes[k];                                         \
+                                                                               \
+            sc_array_create(arr, n);                                           \
+            sc_array_create(src, n);                                           \
+                                                                               \
+            for (int d = 0; d < 5; d++) {                                      \
+                seed = 0x2545F4914F6CDD1Dull;                                  \
+                sc_array_clear(src);                                           \
+                for (size_t i = 0; i < n; i++) {                               \
+                    T v;                                                       \
+                    fill(v, bench_value(d, &seed, i, n), i);                   \
+                    sc_array_add(src, v);                                      \
+                }                                                              \
+                                                                               \
+                memcpy(arr, src, n * sizeof(*arr));                            \
+                sc_array_meta(arr)->size = n;                                  \
+                start = time_ns();                                             \
+                sc_array_sort(arr, cmp_##name);                                \
+                q = time_ns() - start;                                         \
+                                                                               \
+                memcpy(arr, src, n * sizeof(*arr));                            \
+                start = time_ns();                                             \
+                sc_array_sort_##name(arr);                                     \
+                s = time_ns() - start;                                         \
+                                                                               \
+                memcpy(arr, src, n * sizeof(*arr));                            \
+                start = time_ns();                                             \
+                sc_array_radix_##name(arr);                                    \
+                r = time_ns() - start;                                         \
+                                                                               \
+                printf("%-9zu %-11s qsort %7.2f  intro %7.2f  "                \
+                       "radix %7.2f ns/elem \n",                               \
+                       n, dists[d], (double) q / n, (double) s / n,            \
+                       (double) r / n);                                        \
+            }                                                                  \
+                                                                               \
+            sc_array_destroy(arr);                                             \
+            sc_array_destroy(src);                                             \
+        }                                                                      \
+    } while (0)
+
+#define fill_u64(v, x, i) ((v) = (x))
+#define fill_item(v, x, i) ((v).key = (x), (v).payload = (i))
+
+static const size_t sizes[] = {1000, 100000, 10000000};
+
+static void bench_u64(void)
+{
+    printf("\nuint64_t arrays \n\n");
+    bench_sort(uint64_t, u64, fill_u64);
+}
+
+static void bench_item(void)
+{
+    printf("\n16 byte structs, uint64_t key \n\n");
+    bench_sort(struct bench_item, item, fill_item);
+}
+
+static void bench_parallel(void)
+{
+    const size_t n = 20000000;
+    const uint32_t threads[] = {1, 2, 4, 8, 16, 32};
+    uint64_t *arr, *src, seed = 0x2545F4914F6CDD1Dull, start, elapsed;
+
+    printf("\nParallel sort, %zu random uint64_t \n\n", n);
+
+    sc_array_create(arr, n);
+    sc_array_create(src, n);
+    for (size_t i = 0; i < n; i++) {
+        sc_array_add(src, rand64(&seed));
+    }
+    memcpy(arr, src, n * sizeof(*arr));
+    sc_array_meta(arr)->size = n;
+
+    start = time_ns();
+    sc_array_sort_u64(arr);
+    elapsed = time_ns() - start;
+    printf("sequential   %8.2f ms \n", (double) elapsed / 1e6);
+
+    for (size_t i = 0; i < sizeof(threads) / sizeof(threads[0]); i++) {
+        memcpy(arr, src, n * sizeof(*arr));
+        start = time_ns();
+        sc_array_sort_parallel_u64(arr, threads[i], 0);
+        elapsed = time_ns() - start;
+        printf("threads %-4u %8.2f ms \n", threads[i], (double) elapsed / 1e6);
+    }
+
+    sc_array_destroy(arr);
+    sc_array_destroy(src);
+}
+
+static volatile uint64_t sink;
+
+static void bench_print(const char *op, size_t n, size_t reps, uint64_t loop,
+                        uint64_t scan)
+{
+    printf("%-9zu %-7s loop %6.3f  scan %6.3f ns/elem  %5.2fx \n", n, op,
+           (double) loop / (double) (n * reps),
+           (double) scan / (double) (n * reps), (double) loop / (double) scan);
+}
+
+/**
+ * Compares sc_array_foreach() loops to the scan functions. find() looks for a
+ * missing value, filter() keeps about half of the elements.
+ */
+#define bench_scan_of(sfx, T, S, gen, none, lo, hi)                            \
+    static void bench_scan_##sfx(void)                                         \
+    {                                                                          \
+        T *arr, *dst, v, min, max;                                             \
+        uint64_t seed = 0x2545F4914F6CDD1Dull, start, loop;                    \
+        size_t c, idx;                                                         \
+        S sum;                                                                 \
+                                                                               \
+        printf("\n%s arrays \n\n", #T);                                        \
+                                                                               \
+        for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++) {        \
+            const size_t n = sizes[k];                                         \
+            const size_t reps = 30000000 / n;                                  \
+                                                                               \
+            /* sc_array_foreach() reads one element past the end. */           \
+            sc_array_create(arr, n + 1);                                       \
+            sc_array_create(dst, n);                                           \
+            for (size_t i = 0; i < n; i++) {                                   \
+                sc_array_add(arr, (gen));                                      \
+            }                                                                  \
+                                                                               \
+            start = time_ns();                                                 \
+            for (size_t r = 0; r < reps; r++) {                                \
+                idx = SIZE_MAX;                                                \
+                c = 0;                                                         \
+                sc_array_foreach (arr, v) {                                    \
+                    if (v == (none)) {                                         \
+                        idx = c;                                               \
+                        break;                                                 \
+                    }                                                          \
+                    c++;                                                       \
+                }                                                              \
+                sink += idx;                                                   \
+            }                                                                  \
+            loop = time_ns() - start;                                          \
+            start = time_ns();                                                 \
+            for (size_t r = 0; r < reps; r++) {                                \
+                sink += sc_array_find_##sfx(arr, (none));                      \
+            }                                                                  \
+            bench_print("find", n, reps, loop, time_ns() - start);             \
+                                                                               \
+            start = time_ns();                                                 \
+            for (size_t r = 0; r < reps; r++) {                                \
+                c = 0;                                                         \
+                sc_array_foreach (arr, v) {                                    \
+                    c += (v == arr[0]);                                        \
+                }                                                              \
+                sink += c;                                                     \
+            }                                                                  \
+            loop = time_ns() - start;                                          \
+            start = time_ns();                                                 \
+            for (size_t r = 0; r < reps; r++) {                                \
+                sink += sc_array_count_##sfx(arr, arr[0]);                     \
+            }                                                                  \
+            bench_print("count", n, reps, loop, time_ns() - start);            \
+                                                                               \
+            start = time_ns();                                                 \
+            for (size_t r = 0; r < reps; r++) {                                \
+                min = max = arr[0];                                            \
+                sc_array_foreach (arr, v) {                                    \
+                    min = v < min ? v : min;                                   \
+                    max = v > max ? v : max;                                   \
+                }                                                              \
+                sink += (uint64_t) (max - min);                                \
+            }                                                                  \
+            loop = time_ns() - start;                                          \
+            start = time_ns();                                                 \
+            for (size_t r = 0; r < reps; r++) {                                \
+                sc_array_minmax_##sfx(arr, &min, &max);                        \
+                sink += (uint64_t) (max - min);                                \
+            }                                                                  \
+            bench_print("minmax", n, reps, loop, time_ns() - start);           \
+                                                                               \
+            start = time_ns();                                                 \
+            for (size_t r = 0; r < reps; r++) {                                \
+                sum = 0;                                                       \
+                sc_array_foreach (arr, v) {                                    \
+                    sum += v;                                                  \
+                }                                                              \
+                sink += (uint64_t) sum;                                        \
+            }                                                                  \
+            loop = time_ns() - start;                                          \
+            start = time_ns();                                                 \
+            for (size_t r = 0; r < reps; r++) {                                \
+                sink += (uint64_t) sc_array_sum_##sfx(arr);                    \
+            }                                                                  \
+            bench_print("sum", n, reps, loop, time_ns() - start);              \
+                                                                               \
+            start = time_ns();                                                 \
+            for (size_t r = 0; r < reps; r++) {                                \
+                sc_array_clear(dst);                                           \
+                sc_array_foreach (arr, v) {                                    \
+                    if (v >= (lo) && v <= (hi)) {                              \
+                        sc_array_add(dst, v);                                  \
+                    }                                                          \
+                }                                                              \
+                sink += sc_array_size(dst);                                    \
+            }                                                                  \
+            loop = time_ns() - start;                                          \
+            start = time_ns();                                                 \
+            for (size_t r = 0; r < reps; r++) {                                \
+                sc_array_clear(dst);                                           \
+                sc_array_filter_##sfx(&dst, arr, (lo), (hi));                  \
+                sink += sc_array_size(dst);                                    \
+            }                                                                  \
+            bench_print("filter", n, reps, loop, time_ns() - start);           \
+                                                                               \
+            sc_array_destroy(arr);                                             \
+            sc_array_destroy(dst);                                             \
+        }                                                                      \
+    }
+
+bench_scan_of(i32, int32_t, int64_t, (int32_t) (rand64(&seed) % 2000) - 1000,
+              5000, -500, 499)
+bench_scan_of(u64, uint64_t, uint64_t, rand64(&seed) & 0xfffffu, UINT64_MAX, 0,
+              0x7ffffu)
+bench_scan_of(f64, double, double, (double) (rand64(&seed) % 2000) - 1000.0,
+              5000.0, -500.0, 499.0)
+
+static void bench_scan(void)
+{
+    bench_scan_i32();
+    bench_scan_u64();
+    bench_scan_f64();
+}
+
+static void bench_inline(void)
+{
+    const size_t n = 10000000;
+    const size_t counts[] = {4, 8, 16};
+    uint64_t start, heap, local;
+    sc_array_inline(uint32_t, 8) buf;
+    uint32_t *arr;
+
+    printf("\nShort lived arrays, inline capacity 8 \n\n");
+
+    for (size_t k = 0; k < sizeof(counts) / sizeof(counts[0]); k++) {
+        start = time_ns();
+        for (size_t i = 0; i < n; i++) {
+            sc_array_create(arr, 0);
+            for (uint32_t j = 0; j < counts[k]; j++) {
+                sc_array_add(arr, j);
+            }
+            sink += arr[i % counts[k]];
+            sc_array_destroy(arr);
+        }
+        heap = time_ns() - start;
+
+        start = time_ns();
+        for (size_t i = 0; i < n; i++) {
+            sc_array_create_inline(arr, buf);
+            for (uint32_t j = 0; j < counts[k]; j++) {
+                sc_array_add(arr, j);
+            }
+            sink += arr[i % counts[k]];
+            sc_array_destroy(arr);
+        }
+        local = time_ns() - start;
+
+        printf("%-3zu elems  heap %7.2f  inline %7.2f ns/array \n", counts[k],
+               (double) heap / n, (double) local / n);
+    }
+}
+
+static void bench_segment(void)
+{
+    const size_t n = 50000000;
+    uint64_t *arr, *p, seed = 0x2545F4914F6CDD1Dull, start, add, get;
+    struct sc_array_seg s;
+
+    printf("\nAppend and random read, %zu uint64_t \n\n", n);
+
+    start = time_ns();
+    sc_array_create(arr, 0);
+    for (size_t i = 0; i < n; i++) {
+        sc_array_add(arr, i);
+    }
+    add = time_ns() - start;
+
+    start = time_ns();
+    for (size_t i = 0; i < n; i++) {
+        sink += arr[rand64(&seed) % n];
+    }
+    get = time_ns() - start;
+    sc_array_destroy(arr);
+    printf("sc_array      add %6.2f  read %6.2f ns/elem \n", (double) add / n,
+           (double) get / n);
+
+    start = time_ns();
+    sc_array_seg_init(&s, sizeof(uint64_t), 1024);
+    for (size_t i = 0; i < n; i++) {
+        p = sc_array_seg_push(&s);
+        *p = i;
+    }
+    add = time_ns() - start;
+
+    start = time_ns();
+    for (size_t i = 0; i < n; i++) {
+        sink += *(uint64_t *) sc_array_seg_at(&s, rand64(&seed) % n);
+    }
+    get = time_ns() - start;
+    sc_array_seg_term(&s);
+    printf("sc_array_seg  add %6.2f  read %6.2f ns/elem \n", (double) add / n,
+           (double) get / n);
+}
+
+static void bench_bulk(void)
+{
+    const size_t n = 50000000, block = 64;
+    uint64_t src[64], start;
+    uint64_t *arr;
+
+    printf("\nAppend %zu uint64_t in blocks of %zu \n\n", n, block);
+
+    for (size_t i = 0; i < block; i++) {
+        src[i] = i;
+    }
+
+    start = time_ns();
+    sc_array_create(arr, 0);
+    for (size_t i = 0; i < n; i += block) {
+        for (size_t j = 0; j < block; j++) {
+            sc_array_add(arr, src[j]);
+        }
+    }
+    sink += arr[n - 1];
+    sc_array_destroy(arr);
+    printf("add             %6.3f ns/elem \n", (double) (time_ns() - start) / n);
+
+    start = time_ns();
+    sc_array_create(arr, 0);
+    sc_array_reserve(arr, n);
+    for (size_t i = 0; i < n; i += block) {
+        for (size_t j = 0; j < block; j++) {
+            sc_array_add(arr, src[j]);
+        }
+    }
+    sink += arr[n - 1];
+    sc_array_destroy(arr);
+    printf("reserve + add   %6.3f ns/elem \n", (double) (time_ns() - start) / n);
+
+    start = time_ns();
+    sc_array_create(arr, 0);
+    for (size_t i = 0; i < n; i += block) {
+        sc_array_add_all(arr, src, block);
+    }
+    sink += arr[n - 1];
+    sc_array_destroy(arr);
+    printf("add_all         %6.3f ns/elem \n", (double) (time_ns() - start) / n);
+}
+
+/**
+ * Returns AnonHugePages of the mapping that contains 'p', in MB. Reads
+ * /proc/self/smaps, returns 0 on other platforms.
+ */
+static size_t huge_mb(const void *p)
+{
+    size_t kb = 0;
+#if defined(__linux__)
+    char line[256];
+    bool in = false;
+    unsigned long start, end;
+    FILE *fp = fopen("/proc/self/smaps", "r");
+
+    if (fp == NULL) {
+        return 0;
+    }
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+            in = (uintptr_t) p >= start && (uintptr_t) p < end;
+        } else if (in && sscanf(line, "AnonHugePages: %zu kB", &kb) == 1) {
+            break;
+        }
+    }
+
+    fclose(fp);
+#else
+    (void) p;
+#endif
+    return kb / 1024;
+}
+
+static void bench_mapped(void)
+{
+    const size_t n = 64 * 1024 * 1024, reads = 20000000;
+    uint64_t *arr, seed, start, add, get;
+    size_t huge;
+
+    printf("\nAppend and random read, %zu uint64_t (%zu MB) \n\n", n,
+           n * sizeof(*arr) / (1024 * 1024));
+
+    for (int mapped = 0; mapped < 2; mapped++) {
+        seed = 0x2545F4914F6CDD1Dull;
+
+        start = time_ns();
+        if (mapped) {
+            sc_array_create_mapped(arr, 0);
+        } else {
+            sc_array_create(arr, 0);
+        }
+        for (size_t i = 0; i < n; i++) {
+            sc_array_add(arr, i);
+        }
+        add = time_ns() - start;
+
+        start = time_ns();
+        for (size_t i = 0; i < reads; i++) {
+            sink += arr[rand64(&seed) & (n - 1)];
+        }
+        get = time_ns() - start;
+        huge = huge_mb(arr);
+        sc_array_destroy(arr);
+
+        printf("%-8s add %6.2f  random read %6.2f ns/elem  "
+               "huge pages %zu MB \n",
+               mapped ? "mapped" : "heap", (double) add / n,
+               (double) get / reads, huge);
+    }
+}
+
+struct bench_trade
+{
+    uint64_t time;
+    double price;
+    uint32_t qty;
+    char side;
+    char venue[16];
+};
+
+#define trade_fields(X)                                                        \
+    X(uint64_t, time)                                                          \
+    X(double, price)                                                           \
+    X(uint32_t, qty)                                                           \
+    X(char, side)
+
+sc_soa_of(trade, trade_fields)
+
+static void bench_soa(void)
+{
+    const size_t n = 10000000, reps = 10;
+    struct bench_trade *aos, tr = {0};
+    struct sc_soa_trade soa;
+    struct sc_soa_trade_row row = {0};
+    uint64_t seed = 0x2545F4914F6CDD1Dull, start, a, b;
+    double sum;
+
+    printf("\nSum of one field over %zu rows, %zu byte structs \n\n", n,
+           sizeof(tr));
+
+    sc_array_create(aos, n);
+    sc_soa_trade_init(&soa, n);
+    for (size_t i = 0; i < n; i++) {
+        tr.time = row.time = i;
+        tr.price = row.price = (double) (rand64(&seed) % 1000);
+        tr.qty = row.qty = (uint32_t) i;
+        sc_array_add(aos, tr);
+        sc_soa_trade_add(&soa, row);
+    }
+
+    start = time_ns();
+    for (size_t r = 0; r < reps; r++) {
+        sum = 0;
+        for (size_t i = 0; i < n; i++) {
+            sum += aos[i].price;
+        }
+        sink += (uint64_t) sum;
+    }
+    a = time_ns() - start;
+
+    start = time_ns();
+    for (size_t r = 0; r < reps; r++) {
+        sum = 0;
+        for (size_t i = 0; i < soa.size; i++) {
+            sum += soa.price[i];
+        }
+        sink += (uint64_t) sum;
+    }
+    b = time_ns() - start;
+
+    printf("array of structs %6.3f  struct of arrays %6.3f ns/row \n",
+           (double) a / (n * reps), (double) b / (n * reps));
+
+    sc_array_destroy(aos);
+    sc_soa_trade_term(&soa);
+}
+
+static void bench_set(void)
+{
+    const size_t sizes[] = {1000, 10000, 100000, 1000000};
+    const size_t lookups = 4000000;
+    uint64_t *keys, *eyt, *probes, seed, start, m, b, e, hits[3];
+    struct sc_map_64 map;
+    uint64_t v;
+
+    printf("\nLookups of random uint64_t, half of them present \n\n");
+
+    for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++) {
+        const size_t n = sizes[k];
+
+        seed = 0x2545F4914F6CDD1Dull;
+        sc_array_create(keys, n);
+        sc_array_create(eyt, 0);
+        sc_array_create(probes, lookups);
+        sc_map_init_64(&map, 0, 0);
+
+        for (size_t i = 0; i < n; i++) {
+            sc_array_add(keys, rand64(&seed));
+            sc_map_put_64(&map, keys[i], i);
+        }
+        for (size_t i = 0; i < lookups; i++) {
+            v = keys[rand64(&seed) % n];
+            sc_array_add(probes, (i % 2) ? v : rand64(&seed));
+        }
+        sc_array_unique_u64(keys);
+        sc_array_eytzinger_u64(&eyt, keys);
+
+        hits[0] = hits[1] = hits[2] = 0;
+
+        start = time_ns();
+        for (size_t i = 0; i < lookups; i++) {
+            hits[0] += sc_map_get_64(&map, probes[i], &v);
+        }
+        m = time_ns() - start;
+
+        start = time_ns();
+        for (size_t i = 0; i < lookups; i++) {
+            hits[1] += sc_array_bsearch_u64(keys, probes[i]) != SIZE_MAX;
+        }
+        b = time_ns() - start;
+
+        start = time_ns();
+        for (size_t i = 0; i < lookups; i++) {
+            size_t j = sc_array_eytzinger_find_u64(eyt, probes[i]);
+            hits[2] += j != 0 && eyt[j] == probes[i];
+        }
+        e = time_ns() - start;
+
+        sink += hits[0] + hits[1] + hits[2];
+        printf("%-8zu sc_map_64 %6.2f (%5zu KB)  binary %6.2f  "
+               "eytzinger %6.2f (%5zu KB) ns/lookup \n",
+               n, (double) m / lookups, sc_map_mem_usage_64(&map) / 1024,
+               (double) b / lookups, (double) e / lookups,
+               sc_array_cap(eyt) * sizeof(*eyt) / 1024);
+
+        sc_map_term_64(&map);
+        sc_array_destroy(keys);
+        sc_array_destroy(eyt);
+        sc_array_destroy(probes);
+    }
+}
+
+// clang-format off
+static const struct bench
+{
+    const char *name;
+    void (*fn)(void);
+} benches[] = {
+        {"u64",      bench_u64     },
+        {"struct",   bench_item    },
+        {"parallel", bench_parallel},
+        {"scan",     bench_scan    },
+        {"inline",   bench_inline  },
+        {"segment",  bench_segment },
+        {"bulk",     bench_bulk    },
+        {"mapped",   bench_mapped  },
+        {"soa",      bench_soa     },
+        {"set",      bench_set     },
+};
+// clang-format on
+
+/**
+ * Usage : sc_array_bench [name]   Runs all benchmarks if name is not given.
+ */
+int main(int argc, char *argv[])
+{
+    for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+        if (argc < 2 || strcmp(argv[1], benches[i].name) == 0) {
+            benches[i].fn();
+        }
+    }
+
+    return 0;
+}
@@ -3,6 +3,7 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 int example()
 {
@@ -75,6 +76,732 @@ static void test1(void)
     sc_array_destroy(arr);
 }
 
+struct item
+{
+    uint64_t key;
+    uint32_t index;
+};
+
+#define u64_less(a, b)  ((a) < (b))
+#define u64_key(a)      (a)
+#define i32_less(a, b)  ((a) < (b))
+#define i32_key(a)      sc_array_key_i32(a)
+#define f64_key(a)      sc_array_key_f64(a)
+#define item_less(a, b) ((a).key < (b).key)
+#define item_key(a)     ((uint32_t) (a).key)
+
+sc_array_sort_of(u64, uint64_t, u64_less)
+sc_array_radix_of(u64, uint64_t, uint64_t, u64_key)
+sc_array_sort_of(i32, int32_t, i32_less)
+sc_array_radix_of(i32, int32_t, uint32_t, i32_key)
+sc_array_radix_of(f64, double, uint64_t, f64_key)
+sc_array_sort_of(item, struct item, item_less)
+sc_array_sort_parallel_of(u64, uint64_t, u64_less)
+sc_array_sort_parallel_of(item, struct item, item_less)
+sc_array_set_of(u64, uint64_t, u64_less)
+sc_array_set_of(item, struct item, item_less)
+sc_array_radix_of(item, struct item, uint32_t, item_key)
+
+static int compare_u64(const void *a, const void *b)
+{
+    const uint64_t *x = a;
+    const uint64_t *y = b;
+
+    return *x < *y ? -1 : *x > *y;
+}
+
+static int compare_i32(const void *a, const void *b)
+{
+    const int32_t *x = a;
+    const int32_t *y = b;
+
+    return *x < *y ? -1 : *x > *y;
+}
+
+static uint64_t test_value(int dist, size_t i, size_t n)
+{
+    switch (dist) {
+    case 0:
+        return ((uint64_t) rand() << 32u) ^ (uint64_t) rand();
+    case 1:
+        return i;
+    case 2:
+        return n - i;
+    case 3:
+        return 7;
+    case 4:
+        return (uint64_t) rand() % 4;
+    case 5:
+        return i < n / 2 ? i : n - i;
+    default:
+        return (uint64_t) rand() % 1000;
+    }
+}
+
+static void test2(void)
+{
+    const size_t sizes[] = {0, 1, 2, 3, 16, 17, 100, 1000, 10000};
+    uint64_t *a, *b, *c, *d;
+    int32_t *x, *y;
+    double *f;
+    struct item *it;
+
+    for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++) {
+        const size_t n = sizes[k];
+
+        for (int dist = 0; dist < 7; dist++) {
+            assert(sc_array_create(a, 0));
+            assert(sc_array_create(b, 0));
+            assert(sc_array_create(c, 0));
+            assert(sc_array_create(d, 0));
+
+            for (size_t i = 0; i < n; i++) {
+                uint64_t v = test_value(dist, i, n);
+
+                assert(sc_array_add(a, v));
+                assert(sc_array_add(b, v));
+                assert(sc_array_add(c, v));
+                assert(sc_array_add(d, v));
+            }
+
+            sc_array_sort(a, compare_u64);
+            sc_array_sort_u64(b);
+            assert(sc_array_radix_u64(c));
+            // Depth limit 0, heapsort only
+            sc_array_qsort_u64(d, sc_array_size(d), 0);
+
+            for (size_t i = 0; i < n; i++) {
+                assert(a[i] == b[i] && a[i] == c[i] && a[i] == d[i]);
+            }
+
+            sc_array_destroy(a);
+            sc_array_destroy(b);
+            sc_array_destroy(c);
+            sc_array_destroy(d);
+        }
+    }
+
+    // Signed keys
+    assert(sc_array_create(x, 0));
+    assert(sc_array_create(y, 0));
+    for (int i = 0; i < 1000; i++) {
+        int32_t v = (i % 3 == 0) ? INT32_MIN + i : rand() - RAND_MAX / 2;
+
+        assert(sc_array_add(x, v));
+        assert(sc_array_add(y, v));
+    }
+    assert(sc_array_add(x, INT32_MAX));
+    assert(sc_array_add(y, INT32_MAX));
+    qsort(x, sc_array_size(x), sizeof(*x), compare_i32);
+    assert(sc_array_radix_i32(y));
+    for (size_t i = 0; i < sc_array_size(x); i++) {
+        assert(x[i] == y[i]);
+    }
+    sc_array_sort_i32(y);
+    for (size_t i = 0; i < sc_array_size(x); i++) {
+        assert(x[i] == y[i]);
+    }
+    sc_array_destroy(x);
+    sc_array_destroy(y);
+
+    // Floats
+    double fv[] = {3.5, -1.0, 0.0, -0.0, 1e300, -1e300, 2.25, -0.5, 1e-300};
+    double fs[] = {-1e300, -1.0, -0.5, -0.0, 0.0, 1e-300, 2.25, 3.5, 1e300};
+
+    assert(sc_array_create(f, 0));
+    for (size_t i = 0; i < sizeof(fv) / sizeof(fv[0]); i++) {
+        assert(sc_array_add(f, fv[i]));
+    }
+    assert(sc_array_radix_f64(f));
+    for (size_t i = 0; i < sizeof(fs) / sizeof(fs[0]); i++) {
+        assert(memcmp(&f[i], &fs[i], sizeof(double)) == 0);
+    }
+    sc_array_destroy(f);
+
+    // Radix sort is stable, only low 32 bits of the key are used
+    assert(sc_array_create(it, 0));
+    for (uint32_t i = 0; i < 5000; i++) {
+        struct item v = {.key = (uint64_t) (rand() % 100), .index = i};
+        assert(sc_array_add(it, v));
+    }
+    assert(sc_array_radix_item(it));
+    for (size_t i = 1; i < sc_array_size(it); i++) {
+        assert(it[i - 1].key < it[i].key ||
+               (it[i - 1].key == it[i].key && it[i - 1].index < it[i].index));
+    }
+    sc_array_sort_item(it);
+    for (size_t i = 1; i < sc_array_size(it); i++) {
+        assert(it[i - 1].key <= it[i].key);
+    }
+    sc_array_destroy(it);
+}
+
+static void test3(void)
+{
+    const uint32_t threads[] = {0, 1, 2, 3, 4, 5, 8, 13, 300};
+    const size_t sizes[] = {0, 1, 100, 999, 10000};
+    uint64_t *a, *b;
+    struct item *it;
+
+    for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++) {
+        for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+            for (int dist = 0; dist < 7; dist++) {
+                const size_t n = sizes[k];
+
+                assert(sc_array_create(a, 0));
+                assert(sc_array_create(b, 0));
+                for (size_t i = 0; i < n; i++) {
+                    uint64_t v = test_value(dist, i, n);
+
+                    assert(sc_array_add(a, v));
+                    assert(sc_array_add(b, v));
+                }
+
+                sc_array_sort_u64(a);
+                sc_array_sort_parallel_u64(b, threads[t], 10);
+                for (size_t i = 0; i < n; i++) {
+                    assert(a[i] == b[i]);
+                }
+
+                sc_array_destroy(a);
+                sc_array_destroy(b);
+            }
+        }
+    }
+
+    // Default cutoff, sorted in the calling thread
+    assert(sc_array_create(it, 0));
+    for (uint32_t i = 0; i < 5000; i++) {
+        struct item v = {.key = (uint64_t) (rand() % 100), .index = i};
+        assert(sc_array_add(it, v));
+    }
+    sc_array_sort_parallel_item(it, 8, 0);
+    for (size_t i = 1; i < sc_array_size(it); i++) {
+        assert(it[i - 1].key <= it[i].key);
+    }
+    sc_array_sort_parallel_item(it, 8, 100);
+    for (size_t i = 1; i < sc_array_size(it); i++) {
+        assert(it[i - 1].key <= it[i].key);
+    }
+    sc_array_destroy(it);
+}
+
+#define scan_check(sfx, T, S, gen)                                             \
+    static void scan_check_##sfx(size_t n, T lo, T hi)                         \
+    {                                                                          \
+        T *a, *f, min = 0, max = 0, v;                                         \
+        size_t c;                                                              \
+        S sum = 0;                                                             \
+                                                                               \
+        assert(sc_array_create(a, 0));                                         \
+        assert(sc_array_create(f, 1));                                         \
+        for (size_t i = 0; i < n; i++) {                                       \
+            assert(sc_array_add(a, gen));                                      \
+        }                                                                      \
+                                                                               \
+        for (size_t i = 0; i < n; i++) {                                       \
+            min = (i == 0 || a[i] < min) ? a[i] : min;                         \
+            max = (i == 0 || a[i] > max) ? a[i] : max;                         \
+            sum += a[i];                                                       \
+        }                                                                      \
+                                                                               \
+        assert(sc_array_minmax_##sfx(a, &lo, &hi) == (n > 0));                 \
+        if (n > 0) {                                                           \
+            assert(lo == min && hi == max);                                    \
+        }                                                                      \
+        assert(sc_array_sum_##sfx(a) == sum);                                  \
+                                                                               \
+        for (size_t i = 0; i < n; i++) {                                       \
+            v = a[i];                                                          \
+            c = 0;                                                             \
+            for (size_t j = 0; j < n; j++) {                                   \
+                c += (a[j] == v);                                              \
+            }                                                                  \
+            assert(sc_array_count_##sfx(a, v) == c);                           \
+            assert(a[sc_array_find_##sfx(a, v)] == v);                         \
+            assert(sc_array_find_##sfx(a, v) <= i);                            \
+        }                                                                      \
+        assert(sc_array_find_##sfx(a, (T) 77) == SIZE_MAX);                    \
+        assert(sc_array_count_##sfx(a, (T) 77) == 0);                          \
+                                                                               \
+        for (int p = 0; p < 4; p++) {                                          \
+            for (int q = p; q < 4; q++) {                                      \
+                T l = min + ((max - min) / 3) * p;                             \
+                T h = min + ((max - min) / 3) * q;                             \
+                                                                               \
+                sc_array_clear(f);                                             \
+                assert(sc_array_add(f, (T) 1));                                \
+                assert(sc_array_filter_##sfx(&f, a, l, h));                    \
+                c = 1;                                                         \
+                for (size_t i = 0; i < n; i++) {                               \
+                    if (a[i] >= l && a[i] <= h) {                              \
+                        assert(f[c++] == a[i]);                                \
+                    }                                                          \
+                }                                                              \
+                assert(f[0] == 1 && sc_array_size(f) == c);                    \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        sc_array_destroy(a);                                                   \
+        sc_array_destroy(f);                                                   \
+    }
+
+scan_check(i32, int32_t, int64_t, (int32_t) (rand() % 41) - 20)
+scan_check(u64, uint64_t, uint64_t,
+           (uint64_t) (rand() % 41) + (rand() % 2 ? UINT64_MAX - 50 : 0))
+scan_check(f64, double, double, (double) (rand() % 41) - 20.5)
+
+static void test4(void)
+{
+    int32_t *a, *f;
+    int32_t min, max;
+
+    for (size_t n = 0; n < 40; n++) {
+        scan_check_i32(n, 0, 0);
+        scan_check_u64(n, 0, 0);
+        scan_check_f64(n, 0, 0);
+    }
+
+    scan_check_i32(5003, 0, 0);
+    scan_check_u64(5003, 0, 0);
+    scan_check_f64(5003, 0, 0);
+
+    // Extremes and a long run before the match
+    assert(sc_array_create(a, 0));
+    for (int i = 0; i < 1000; i++) {
+        assert(sc_array_add(a, INT32_MAX));
+    }
+    assert(sc_array_add(a, INT32_MIN));
+    assert(sc_array_find_i32(a, INT32_MIN) == 1000);
+    assert(sc_array_minmax_i32(a, &min, &max));
+    assert(min == INT32_MIN && max == INT32_MAX);
+    assert(sc_array_sum_i32(a) == (int64_t) INT32_MAX * 1000 + INT32_MIN);
+
+    assert(sc_array_create(f, 0));
+    assert(sc_array_filter_i32(&f, a, INT32_MIN, INT32_MAX));
+    assert(sc_array_size(f) == sc_array_size(a));
+    sc_array_clear(f);
+    assert(sc_array_filter_i32(&f, a, 1, 0));
+    assert(sc_array_size(f) == 0);
+    sc_array_destroy(f);
+    sc_array_destroy(a);
+}
+
+struct owner
+{
+    sc_array_inline(int, 4) buf;
+    sc_array_inline(double, 2) dbuf;
+    int *ids;
+    double *vals;
+};
+
+static void test5(void)
+{
+    struct owner o;
+    double *src;
+    int *p;
+
+    sc_array_create_inline(o.ids, o.buf);
+    assert(sc_array_size(o.ids) == 0);
+    assert(sc_array_cap(o.ids) == 4);
+
+    for (int i = 0; i < 4; i++) {
+        assert(sc_array_add(o.ids, i));
+        assert(o.ids == o.buf.elems);
+    }
+
+    sc_array_remove(o.ids, 0);
+    assert(sc_array_add(o.ids, 4));
+    assert(o.ids == o.buf.elems);
+    sc_array_destroy(o.ids);
+    assert(o.ids == NULL);
+
+    // Moves to heap when it grows past inline capacity
+    sc_array_create_inline(o.ids, o.buf);
+    for (int i = 0; i < 100; i++) {
+        assert(sc_array_add(o.ids, i));
+        assert((o.ids == o.buf.elems) == (i < 4));
+    }
+    assert(sc_array_cap(o.ids) >= 100);
+    for (int i = 0; i < 100; i++) {
+        assert(o.ids[i] == i);
+    }
+    sc_array_destroy(o.ids);
+
+    // Stack storage
+    sc_array_inline(int, 1) sbuf;
+    sc_array_create_inline(p, sbuf);
+    assert(sc_array_add(p, 7));
+    assert(p == sbuf.elems);
+    assert(sc_array_add(p, 8));
+    assert(p != sbuf.elems && p[0] == 7 && p[1] == 8);
+    sc_array_destroy(p);
+
+    // Bulk growth from inline storage
+    assert(sc_array_create(src, 0));
+    for (int i = 0; i < 10; i++) {
+        assert(sc_array_add(src, i));
+    }
+    sc_array_create_inline(o.vals, o.dbuf);
+    assert(sc_array_add(o.vals, -1));
+    assert(sc_array_filter_f64(&o.vals, src, 0, 9));
+    assert(o.vals != o.dbuf.elems && sc_array_size(o.vals) == 11);
+    assert(o.vals[0] == -1 && o.vals[1] == 0 && o.vals[10] == 9);
+    sc_array_destroy(o.vals);
+    sc_array_destroy(src);
+}
+
+static void test6(void)
+{
+    const size_t firsts[] = {1, 3, 8, 1000};
+    struct sc_array_seg s;
+    uint64_t *p, *addr[5000];
+
+    assert(!sc_array_seg_init(&s, 0, 8));
+    assert(!sc_array_seg_init(&s, 8, 0));
+    assert(!sc_array_seg_init(&s, 8, SIZE_MAX));
+
+    for (size_t k = 0; k < sizeof(firsts) / sizeof(firsts[0]); k++) {
+        assert(sc_array_seg_init(&s, sizeof(uint64_t), firsts[k]));
+        assert(sc_array_seg_size(&s) == 0);
+
+        for (uint64_t i = 0; i < 5000; i++) {
+            p = sc_array_seg_push(&s);
+            assert(p != NULL);
+            *p = i * 3;
+            addr[i] = p;
+        }
+        assert(sc_array_seg_size(&s) == 5000);
+
+        // Addresses do not change as the array grows
+        for (size_t i = 0; i < 5000; i++) {
+            p = sc_array_seg_at(&s, i);
+            assert(p == addr[i] && *p == i * 3);
+        }
+
+        sc_array_seg_truncate(&s, 6000);
+        assert(sc_array_seg_size(&s) == 5000);
+        sc_array_seg_truncate(&s, 10);
+        assert(sc_array_seg_size(&s) == 10);
+        sc_array_seg_trim(&s);
+        assert(s.cap >= 10 && s.cap < 5000);
+        assert(*(uint64_t *) sc_array_seg_at(&s, 9) == 27);
+
+        for (uint64_t i = 10; i < 3000; i++) {
+            p = sc_array_seg_push(&s);
+            assert(p != NULL);
+            *p = i;
+        }
+        assert(*(uint64_t *) sc_array_seg_at(&s, 9) == 27);
+        assert(*(uint64_t *) sc_array_seg_at(&s, 2999) == 2999);
+
+        sc_array_seg_truncate(&s, 0);
+        sc_array_seg_trim(&s);
+        assert(s.cap == 0 && s.chunks == 0);
+        assert(sc_array_seg_push(&s) != NULL);
+        sc_array_seg_term(&s);
+    }
+
+    // Odd element size
+    char name[7] = "abcdef";
+
+    assert(sc_array_seg_init(&s, sizeof(name), 2));
+    for (int i = 0; i < 100; i++) {
+        name[0] = (char) ('a' + i % 26);
+        p = sc_array_seg_push(&s);
+        assert(p != NULL);
+        memcpy(p, name, sizeof(name));
+    }
+    for (int i = 0; i < 100; i++) {
+        char *e = sc_array_seg_at(&s, (size_t) i);
+        assert(e[0] == 'a' + i % 26 && strcmp(e + 1, "bcdef") == 0);
+    }
+    sc_array_seg_term(&s);
+}
+
+static void test7(void)
+{
+    const int src[] = {10, 11, 12, 13, 14};
+    sc_array_inline(int, 4) buf;
+    int *arr;
+
+    assert(sc_array_create(arr, 0));
+    assert(sc_array_reserve(arr, 0));
+    assert(sc_array_resize(arr, 0));
+    assert(sc_array_add_all(arr, src, 0));
+    assert(sc_array_size(arr) == 0);
+
+    assert(sc_array_reserve(arr, 100));
+    assert(sc_array_cap(arr) == 100 && sc_array_size(arr) == 0);
+    assert(sc_array_reserve(arr, 10));
+    assert(sc_array_cap(arr) == 100);
+
+    assert(sc_array_add_all(arr, src, 5));
+    assert(sc_array_add_all(arr, src, 2));
+    assert(sc_array_size(arr) == 7 && arr[4] == 14 && arr[6] == 11);
+
+    // [a, b, c] -> [x, y, a, b, c] -> [x, y, a, z, b, c] -> [..., c, w]
+    sc_array_clear(arr);
+    assert(sc_array_add_all(arr, src, 3));
+    assert(sc_array_insert_range(arr, 0, src + 3, 2));
+    assert(sc_array_insert_range(arr, 3, src + 4, 1));
+    assert(sc_array_insert_range(arr, sc_array_size(arr), src, 1));
+    assert(sc_array_size(arr) == 7);
+    assert(arr[0] == 13 && arr[1] == 14 && arr[2] == 10 && arr[3] == 14);
+    assert(arr[4] == 11 && arr[5] == 12 && arr[6] == 10);
+
+    assert(sc_array_resize(arr, 3));
+    assert(sc_array_size(arr) == 3 && arr[2] == 10);
+    assert(sc_array_resize(arr, 1000));
+    assert(sc_array_size(arr) == 1000 && arr[2] == 10);
+    for (int i = 3; i < 1000; i++) {
+        assert(arr[i] == 0);
+    }
+    sc_array_destroy(arr);
+
+    // Bulk appends move inline arrays to the heap when needed
+    sc_array_create_inline(arr, buf);
+    assert(sc_array_add_all(arr, src, 4));
+    assert(arr == buf.elems);
+    assert(sc_array_insert_range(arr, 2, src, 5));
+    assert(arr != buf.elems && sc_array_size(arr) == 9);
+    assert(arr[1] == 11 && arr[2] == 10 && arr[6] == 14 && arr[8] == 13);
+    sc_array_destroy(arr);
+
+    sc_array_create_inline(arr, buf);
+    assert(sc_array_resize(arr, 4));
+    assert(arr == buf.elems && arr[3] == 0);
+    assert(sc_array_reserve(arr, 5));
+    assert(arr != buf.elems && sc_array_cap(arr) == 5);
+    assert(sc_array_size(arr) == 4 && arr[0] == 0);
+    sc_array_destroy(arr);
+
+    // Many small appends grow geometrically
+    assert(sc_array_create(arr, 0));
+    for (int i = 0; i < 3000; i++) {
+        assert(sc_array_add_all(arr, src, 5));
+    }
+    assert(sc_array_size(arr) == 15000);
+    assert(sc_array_cap(arr) < 2 * 15000);
+    assert(arr[14999] == 14);
+    sc_array_destroy(arr);
+}
+
+static void test8(void)
+{
+    const uint32_t src[] = {1, 2, 3};
+    uint32_t *arr;
+
+    assert(!sc_array_create_mapped(arr, SIZE_MAX));
+    assert(arr == NULL);
+
+    assert(sc_array_create_mapped(arr, 0));
+    assert(sc_array_size(arr) == 0 && sc_array_cap(arr) > 0);
+    sc_array_destroy(arr);
+    assert(arr == NULL);
+
+    // Grows past the first mapping, elements are kept
+    assert(sc_array_create_mapped(arr, 10));
+    for (uint32_t i = 0; i < 30000; i++) {
+        assert(sc_array_add(arr, i));
+    }
+    assert(sc_array_cap(arr) >= 30000);
+    for (uint32_t i = 0; i < 30000; i++) {
+        assert(arr[i] == i);
+    }
+
+    assert(sc_array_add_all(arr, src, 3));
+    assert(sc_array_size(arr) == 30003 && arr[30002] == 3);
+    sc_array_remove(arr, 0);
+    assert(arr[0] == 1 && arr[sc_array_size(arr) - 1] == 3);
+    assert(sc_array_resize(arr, 10));
+    assert(sc_array_reserve(arr, 34000));
+    assert(sc_array_cap(arr) >= 34000 && arr[9] == 10);
+
+    // Maximum is enforced after rounding to the mapping size
+    assert(!sc_array_reserve(arr, 40000));
+    assert(sc_array_size(arr) == 10);
+    sc_array_destroy(arr);
+}
+
+#define trade_fields(X)                                                        \
+    X(uint64_t, time)                                                          \
+    X(double, price)                                                           \
+    X(char, side)                                                              \
+    X(uint32_t, qty)
+
+sc_soa_of(trade, trade_fields)
+
+static void test9(void)
+{
+    struct sc_soa_trade t;
+    struct sc_soa_trade_row r;
+
+    assert(sc_soa_trade_init(&t, 0));
+    assert(t.size == 0 && t.cap == 0 && t.mem == NULL);
+    sc_soa_trade_term(&t);
+
+    assert(sc_soa_trade_init(&t, 3));
+    assert(t.cap == 3);
+
+    for (uint32_t i = 0; i < 1000; i++) {
+        r = (struct sc_soa_trade_row){.time = i,
+                                      .price = i * 0.5,
+                                      .side = (char) ('a' + i % 2),
+                                      .qty = i * 10};
+        assert(sc_soa_trade_add(&t, r));
+    }
+
+    assert(t.size == 1000 && t.cap >= 1000);
+    assert((uintptr_t) t.time % SC_SOA_ALIGN == 0);
+    assert((uintptr_t) t.price % SC_SOA_ALIGN == 0);
+    assert((uintptr_t) t.side % SC_SOA_ALIGN == 0);
+    assert((uintptr_t) t.qty % SC_SOA_ALIGN == 0);
+
+    for (uint32_t i = 0; i < 1000; i++) {
+        assert(t.time[i] == i && t.price[i] == i * 0.5);
+        assert(t.side[i] == 'a' + i % 2 && t.qty[i] == i * 10);
+    }
+
+    r = sc_soa_trade_get(&t, 10);
+    assert(r.time == 10 && r.price == 5.0 && r.side == 'a' && r.qty == 100);
+    r.qty = 7;
+    sc_soa_trade_set(&t, 10, r);
+    assert(t.qty[10] == 7 && t.time[10] == 10);
+
+    sc_soa_trade_remove_unordered(&t, 0);
+    assert(t.size == 999 && t.time[0] == 999 && t.qty[0] == 9990);
+    sc_soa_trade_remove_unordered(&t, t.size - 1);
+    assert(t.size == 998 && t.time[997] == 997);
+
+    assert(sc_soa_trade_reserve(&t, 5000));
+    assert(t.cap == 5000 && t.size == 998 && t.time[997] == 997);
+    assert(t.price[10] == 5.0 && t.side[11] == 'b');
+
+    sc_soa_trade_clear(&t);
+    assert(t.size == 0 && t.cap == 5000);
+    assert(!sc_soa_trade_reserve(&t, SIZE_MAX));
+    sc_soa_trade_term(&t);
+    assert(t.mem == NULL);
+}
+
+static bool has_u64(const uint64_t *arr, uint64_t v)
+{
+    for (size_t i = 0; i < sc_array_size(arr); i++) {
+        if (arr[i] == v) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void test10(void)
+{
+    uint64_t *a, *b, *d, *e;
+    struct item *it;
+    size_t c, k;
+
+    assert(sc_array_create(a, 1));
+    assert(sc_array_create(b, 1));
+    assert(sc_array_create(d, 1));
+    assert(sc_array_create(e, 0));
+
+    // Empty sets
+    sc_array_unique_u64(a);
+    assert(sc_array_lower_bound_u64(a, 5) == 0);
+    assert(sc_array_bsearch_u64(a, 5) == SIZE_MAX);
+    assert(sc_array_union_u64(&d, a, b) && sc_array_size(d) == 0);
+    assert(sc_array_eytzinger_u64(&e, a) && sc_array_size(e) == 0);
+    assert(sc_array_eytzinger_find_u64(e, 5) == 0);
+
+    for (size_t n = 0; n < 300; n += 1 + n / 4) {
+        sc_array_clear(a);
+        sc_array_clear(b);
+        for (size_t i = 0; i < n; i++) {
+            assert(sc_array_add(a, (uint64_t) (rand() % 200) * 2));
+            assert(sc_array_add(b, (uint64_t) (rand() % 100) * 3));
+        }
+
+        sc_array_unique_u64(a);
+        sc_array_unique_u64(b);
+        for (size_t i = 1; i < sc_array_size(a); i++) {
+            assert(a[i - 1] < a[i]);
+        }
+
+        assert(sc_array_eytzinger_u64(&e, a));
+        assert(sc_array_size(e) == sc_array_size(a) + (n > 0));
+
+        for (uint64_t v = 0; v < 402; v++) {
+            c = 0;
+            while (c < sc_array_size(a) && a[c] < v) {
+                c++;
+            }
+            assert(sc_array_lower_bound_u64(a, v) == c);
+            assert(sc_array_bsearch_u64(a, v) ==
+                   (has_u64(a, v) ? c : SIZE_MAX));
+
+            k = sc_array_eytzinger_find_u64(e, v);
+            assert((k == 0) == (c == sc_array_size(a)));
+            assert(k == 0 || e[k] == a[c]);
+        }
+
+        sc_array_clear(d);
+        assert(sc_array_union_u64(&d, a, b));
+        c = 0;
+        for (uint64_t v = 0; v < 402; v++) {
+            if (has_u64(a, v) || has_u64(b, v)) {
+                assert(d[c++] == v);
+            }
+        }
+        assert(sc_array_size(d) == c);
+
+        sc_array_clear(d);
+        assert(sc_array_add(d, 1000));
+        assert(sc_array_intersect_u64(&d, a, b));
+        c = 1;
+        for (uint64_t v = 0; v < 402; v++) {
+            if (has_u64(a, v) && has_u64(b, v)) {
+                assert(d[c++] == v);
+            }
+        }
+        assert(d[0] == 1000 && sc_array_size(d) == c);
+
+        sc_array_clear(d);
+        assert(sc_array_difference_u64(&d, a, b));
+        c = 0;
+        for (uint64_t v = 0; v < 402; v++) {
+            if (has_u64(a, v) && !has_u64(b, v)) {
+                assert(d[c++] == v);
+            }
+        }
+        assert(sc_array_size(d) == c);
+    }
+
+    // Map, items are compared by key
+    assert(sc_array_create(it, 0));
+    for (uint32_t i = 0; i < 100; i++) {
+        struct item v = {.key = (uint64_t) (i % 50) * 10, .index = i};
+        assert(sc_array_add(it, v));
+    }
+    sc_array_unique_item(it);
+    assert(sc_array_size(it) == 50);
+
+    struct item probe = {.key = 120};
+
+    c = sc_array_bsearch_item(it, probe);
+    assert(c == 12 && it[c].key == 120 && it[c].index % 50 == 12);
+    probe.key = 121;
+    assert(sc_array_bsearch_item(it, probe) == SIZE_MAX);
+    assert(sc_array_lower_bound_item(it, probe) == 13);
+    sc_array_destroy(it);
+
+    sc_array_destroy(a);
+    sc_array_destroy(b);
+    sc_array_destroy(d);
+    sc_array_destroy(e);
+}
+
 #ifdef SC_HAVE_WRAP
 
 bool fail_realloc = false;
@@ -161,6 +888,110 @@ void fail_test()
     }
 
     sc_array_destroy(arr);
+
+    uint64_t *u;
+
+    assert(sc_array_create(u, 0));
+    assert(sc_array_add(u, 2));
+    assert(sc_array_add(u, 1));
+    fail_realloc = true;
+    assert(!sc_array_radix_u64(u));
+    fail_realloc = false;
+    assert(u[0] == 2 && u[1] == 1);
+    assert(sc_array_radix_u64(u));
+    assert(u[0] == 1 && u[1] == 2);
+    assert(sc_array_add(u, 0));
+
+    // Sorts in the calling thread if the buffer cannot be allocated
+    fail_realloc = true;
+    sc_array_sort_parallel_u64(u, 2, 1);
+    fail_realloc = false;
+    assert(u[0] == 0 && u[1] == 1 && u[2] == 2);
+
+    uint64_t *f;
+
+    assert(sc_array_create(f, 0));
+    fail_realloc = true;
+    assert(!sc_array_filter_u64(&f, u, 0, 10));
+    fail_realloc = false;
+    assert(sc_array_size(f) == 0);
+    assert(sc_array_filter_u64(&f, u, 1, 10));
+    assert(sc_array_size(f) == 2 && f[0] == 1 && f[1] == 2);
+    sc_array_destroy(f);
+    sc_array_destroy(u);
+
+    struct owner o;
+
+    // Stays on inline storage if it cannot move to the heap
+    sc_array_create_inline(o.ids, o.buf);
+    for (int i = 0; i < 4; i++) {
+        assert(sc_array_add(o.ids, i));
+    }
+    fail_realloc = true;
+    assert(!sc_array_add(o.ids, 4));
+    fail_realloc = false;
+    assert(o.ids == o.buf.elems && sc_array_size(o.ids) == 4);
+    assert(o.ids[3] == 3);
+    assert(sc_array_add(o.ids, 4));
+    assert(o.ids != o.buf.elems && o.ids[4] == 4);
+    sc_array_destroy(o.ids);
+
+    struct sc_array_seg s;
+
+    assert(sc_array_seg_init(&s, sizeof(uint64_t), 4));
+    fail_realloc = true;
+    assert(sc_array_seg_push(&s) == NULL);
+    fail_realloc = false;
+    assert(sc_array_seg_size(&s) == 0);
+    for (int i = 0; i < 4; i++) {
+        assert(sc_array_seg_push(&s) != NULL);
+    }
+    fail_realloc = true;
+    assert(sc_array_seg_push(&s) == NULL);
+    fail_realloc = false;
+    assert(sc_array_seg_size(&s) == 4 && s.chunks == 1);
+    assert(sc_array_seg_push(&s) != NULL);
+    sc_array_seg_term(&s);
+
+    const int src[] = {1, 2, 3};
+
+    assert(sc_array_create(arr, 0));
+    assert(sc_array_add_all(arr, src, 3));
+    fail_realloc = true;
+    assert(!sc_array_reserve(arr, 100));
+    assert(!sc_array_resize(arr, 100));
+    assert(!sc_array_add_all(arr, src, 3));
+    assert(!sc_array_insert_range(arr, 0, src, 3));
+    fail_realloc = false;
+    assert(sc_array_size(arr) == 3 && arr[0] == 1 && arr[2] == 3);
+    sc_array_destroy(arr);
+
+    struct sc_soa_trade t;
+    struct sc_soa_trade_row r = {.time = 1};
+
+    fail_realloc = true;
+    assert(!sc_soa_trade_init(&t, 10));
+    fail_realloc = false;
+    assert(sc_soa_trade_init(&t, 1));
+    assert(sc_soa_trade_add(&t, r));
+    fail_realloc = true;
+    assert(!sc_soa_trade_add(&t, r));
+    fail_realloc = false;
+    assert(t.size == 1 && t.time[0] == 1);
+    sc_soa_trade_term(&t);
+
+    uint64_t *a, *b;
+
+    assert(sc_array_create(a, 0));
+    assert(sc_array_create(b, 0));
+    assert(sc_array_add(a, 1) && sc_array_add(a, 2));
+    fail_realloc = true;
+    assert(!sc_array_union_u64(&b, a, a));
+    assert(!sc_array_eytzinger_u64(&b, a));
+    fail_realloc = false;
+    assert(sc_array_size(b) == 0);
+    sc_array_destroy(a);
+    sc_array_destroy(b);
 }
 #else
 void fail_test(void)
@@ -172,5 +1003,14 @@ int main(int argc, char *argv[])
 {
     example();
     test1();
+    test2();
+    test3();
+    test4();
+    test5();
+    test6();
+    test7();
+    test8();
+    test9();
+    test10();
     fail_test();
 }
@@ -26,9 +26,18 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <string.h>
 
+#if defined(_WIN32) || defined(_WIN64)
+    #define SC_ARRAY_NO_MMAP
+#else
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+// Top two bits of capacity are flags, sizes must stay below them.
 #ifndef SC_SIZE_MAX
-    #define SC_SIZE_MAX SIZE_MAX
+    #define SC_SIZE_MAX (SIZE_MAX >> 2u)
 #endif
 
 
@@ -72,46 +81,1509 @@ bool sc_array_init(void **arr, size_t elem_size, size_t cap)
     return true;
 }
 
+#if !defined(SC_ARRAY_NO_MMAP)
+
+/**
+ * Mapped arrays keep the mapping length in front of the array header, the
+ * first element is at SC_ARRAY_MAP_HDR bytes from the start of the mapping.
+ */
+#define SC_ARRAY_MAP_HDR  64
+#define SC_ARRAY_HUGEPAGE (2 * 1024 * 1024)
+
+static char *sc_array_map_base(struct sc_array *meta)
+{
+    return (char *) meta->elems - SC_ARRAY_MAP_HDR;
+}
+
+static size_t sc_array_map_len(size_t bytes)
+{
+    size_t align = (size_t) sysconf(_SC_PAGESIZE);
+
+    if (bytes >= SC_ARRAY_HUGEPAGE) {
+        align = SC_ARRAY_HUGEPAGE;
+    }
+
+    return (bytes + align - 1) & ~(align - 1);
+}
+
+/**
+ * Maps 'len' bytes. Mappings of a huge page or more start on a huge page
+ * boundary, MADV_HUGEPAGE only takes effect on aligned 2 MB extents. The
+ * mapping is one huge page longer than needed and the ends are trimmed.
+ */
+static char *sc_array_mmap(size_t len)
+{
+    const size_t extra = len >= SC_ARRAY_HUGEPAGE ? SC_ARRAY_HUGEPAGE : 0;
+    char *mem, *p;
+
+    mem = mmap(NULL, len + extra, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED || extra == 0) {
+        return mem;
+    }
+
+    p = (char *) (((uintptr_t) mem + SC_ARRAY_HUGEPAGE - 1) &
+                  ~((uintptr_t) SC_ARRAY_HUGEPAGE - 1));
+    if (p != mem) {
+        munmap(mem, (size_t) (p - mem));
+    }
+
+    if (p != mem + extra) {
+        munmap(p + len, (size_t) (mem + extra - p));
+    }
+
+    return p;
+}
+
+#if defined(__linux__) && defined(MREMAP_MAYMOVE)
+
+/**
+ * Grows in place if possible. Otherwise, pages are moved without copying, to
+ * a huge page aligned address if the new mapping is a huge page or more.
+ */
+static char *sc_array_mremap(char *base, size_t prev_len, size_t len)
+{
+    char *mem, *dst;
+    const bool huge = len >= SC_ARRAY_HUGEPAGE;
+
+    if (!huge || ((uintptr_t) base & (SC_ARRAY_HUGEPAGE - 1)) == 0) {
+        mem = mremap(base, prev_len, len, 0);
+        if (mem != MAP_FAILED) {
+            return mem;
+        }
+    }
+
+    if (!huge) {
+        return mremap(base, prev_len, len, MREMAP_MAYMOVE);
+    }
+
+    dst = sc_array_mmap(len);
+    if (dst == MAP_FAILED) {
+        return MAP_FAILED;
+    }
+
+    // Replaces the mapping at 'dst', which is reserved for it.
+    mem = mremap(base, prev_len, len, MREMAP_MAYMOVE | MREMAP_FIXED, dst);
+    if (mem == MAP_FAILED) {
+        munmap(dst, len);
+    }
+
+    return mem;
+}
+
+#endif
+
+/**
+ * Maps or remaps array memory for at least 'cap' elements. Capacity is set to
+ * what fits in the mapping. On Linux, mremap() moves pages without copying.
+ */
+static struct sc_array *sc_array_map(struct sc_array *prev, size_t elem_size,
+                                     size_t cap)
+{
+    const size_t max = SC_SIZE_MAX / elem_size;
+    const size_t len = sc_array_map_len(SC_ARRAY_MAP_HDR + elem_size * cap);
+    size_t prev_len = 0;
+    char *mem, *base = NULL;
+    struct sc_array *meta;
+
+    if (prev != NULL) {
+        base = sc_array_map_base(prev);
+        memcpy(&prev_len, base, sizeof(prev_len));
+    }
+
+#if defined(__linux__) && defined(MREMAP_MAYMOVE)
+    if (base != NULL) {
+        mem = sc_array_mremap(base, prev_len, len);
+    } else
+#endif
+    {
+        mem = sc_array_mmap(len);
+        if (mem != MAP_FAILED && base != NULL) {
+            memcpy(mem, base, prev_len);
+            munmap(base, prev_len);
+        }
+    }
+
+    if (mem == MAP_FAILED) {
+        sc_array_on_error("Failed to map %zu bytes. ", len);
+        return NULL;
+    }
+
+#if defined(MADV_HUGEPAGE)
+    if (len >= SC_ARRAY_HUGEPAGE) {
+        // Only a hint, fails if transparent huge pages are disabled
+        madvise(mem, len, MADV_HUGEPAGE);
+    }
+#endif
+
+    memcpy(mem, &len, sizeof(len));
+    meta = (struct sc_array *) (mem + SC_ARRAY_MAP_HDR - sizeof(*meta));
+    cap = (len - SC_ARRAY_MAP_HDR) / elem_size;
+    meta->cap = (cap < max ? cap : max) | SC_ARRAY_MAPPED;
+
+    return meta;
+}
+
+static void sc_array_unmap(struct sc_array *meta)
+{
+    char *base = sc_array_map_base(meta);
+    size_t len;
+
+    memcpy(&len, base, sizeof(len));
+    munmap(base, len);
+}
+
+bool sc_array_init_mapped(void **arr, size_t elem_size, size_t cap)
+{
+    const size_t max = SC_SIZE_MAX / elem_size;
+    struct sc_array *meta;
+
+    if (cap > max) {
+        sc_array_on_error("Max capacity(%zu) has been reached. ", max);
+        *arr = NULL;
+        return false;
+    }
+
+    meta = sc_array_map(NULL, elem_size, cap);
+    if (meta == NULL) {
+        *arr = NULL;
+        return false;
+    }
+
+    meta->size = 0;
+    *arr = meta->elems;
+
+    return true;
+}
+
+#else
+
+bool sc_array_init_mapped(void **arr, size_t elem_size, size_t cap)
+{
+    return sc_array_init(arr, elem_size, cap);
+}
+
+#endif
+
 void sc_array_term(void **arr)
 {
     struct sc_array *meta = sc_array_meta(*arr);
 
-    if (meta != &sc_empty) {
+#if !defined(SC_ARRAY_NO_MMAP)
+    if (meta->cap & SC_ARRAY_MAPPED) {
+        sc_array_unmap(meta);
+        *arr = NULL;
+        return;
+    }
+#endif
+
+    if (meta != &sc_empty && !(meta->cap & SC_ARRAY_INLINE)) {
         sc_array_free(meta);
     }
 
     *arr = NULL;
 }
 
+void sc_array_init_inline(void **arr, void *buf, size_t cap)
+{
+    struct sc_array *meta = buf;
+
+    meta->size = 0;
+    meta->cap = cap | SC_ARRAY_INLINE;
+    *arr = meta->elems;
+}
+
+/**
+ * Moves elements to heap memory of 'cap' elements. Heap arrays are resized,
+ * others are copied to a new allocation, so the array is unchanged on failure.
+ */
+static bool sc_array_move(void **arr, size_t elem_size, size_t cap)
+{
+    size_t bytes = sizeof(struct sc_array) + (elem_size * cap);
+    struct sc_array *meta = sc_array_meta(*arr);
+    struct sc_array *prev = meta;
+    bool heap = meta != &sc_empty && !(meta->cap & SC_ARRAY_INLINE);
+
+#if !defined(SC_ARRAY_NO_MMAP)
+    if (meta->cap & SC_ARRAY_MAPPED) {
+        meta = sc_array_map(prev, elem_size, cap);
+        if (meta == NULL) {
+            return false;
+        }
+
+        *arr = meta->elems;
+        return true;
+    }
+#endif
+
+    meta = sc_array_realloc(heap ? prev : NULL, bytes);
+    if (meta == NULL) {
+        sc_array_on_error("Failed to allocate %zu bytes. ", bytes);
+        return false;
+    }
+
+    if (!heap) {
+        memcpy(meta->elems, prev->elems, prev->size * elem_size);
+        meta->size = prev->size;
+    }
+
+    meta->cap = cap;
+    *arr = meta->elems;
+
+    return true;
+}
+
 bool sc_array_expand(void **arr, size_t elem_size)
 {
     const size_t max = SC_SIZE_MAX / elem_size;
-    size_t size, cap, bytes;
-    struct sc_array *prev, *meta = sc_array_meta(*arr);
+    struct sc_array *meta = sc_array_meta(*arr);
+    size_t cap = meta->cap & ~SC_ARRAY_FLAGS;
 
-    if (meta->size == meta->cap) {
+    if (meta->size == cap) {
 
         // Check overflow
-        if (meta->cap > max / 2) {
+        if (cap > max / 2) {
             sc_array_on_error("Max capacity(%zu) has been reached. ", max / 2);
             return false;
         }
 
-        size = meta->size;
-        cap = (meta != &sc_empty) ? meta->cap * 2 : 2;
-        prev = (meta != &sc_empty) ? meta : NULL;
+        return sc_array_move(arr, elem_size, cap != 0 ? cap * 2 : 2);
+    }
 
-        bytes =  sizeof(*meta) + (elem_size * cap);
-        meta = sc_array_realloc(prev, bytes);
-        if (meta == NULL) {
-            sc_array_on_error("Failed to allocate %zu bytes. ", bytes);
+    return true;
+}
+
+bool sc_array_grow(void **arr, size_t elem_size, size_t cap)
+{
+    const size_t max = SC_SIZE_MAX / elem_size;
+
+    if (cap <= sc_array_cap(*arr)) {
+        return true;
+    }
+
+    if (cap > max) {
+        sc_array_on_error("Max capacity(%zu) has been reached. ", max);
+        return false;
+    }
+
+    return sc_array_move(arr, elem_size, cap);
+}
+
+/**
+ * Makes room for 'n' more elements, grows to at least twice the capacity.
+ */
+static bool sc_array_room(void **arr, size_t elem_size, size_t n)
+{
+    const size_t max = SC_SIZE_MAX / elem_size;
+    const size_t size = sc_array_size(*arr);
+    const size_t cap = sc_array_cap(*arr);
+
+    if (cap - size >= n) {
+        return true;
+    }
+
+    if (n > max - size) {
+        sc_array_on_error("Max capacity(%zu) has been reached. ", max);
+        return false;
+    }
+
+    if (cap <= max / 2 && size + n < cap * 2) {
+        return sc_array_move(arr, elem_size, cap * 2);
+    }
+
+    return sc_array_move(arr, elem_size, size + n);
+}
+
+bool sc_array_resize_n(void **arr, size_t elem_size, size_t n)
+{
+    const size_t size = sc_array_size(*arr);
+    char *p;
+
+    if (n > size) {
+        if (!sc_array_room(arr, elem_size, n - size)) {
             return false;
         }
 
-        meta->size = size;
-        meta->cap = cap;
-        *arr = meta->elems;
+        p = *arr;
+        memset(p + size * elem_size, 0, (n - size) * elem_size);
+    }
+
+    if (sc_array_meta(*arr) != &sc_empty) {
+        sc_array_size(*arr) = n;
+    }
+
+    return true;
+}
+
+bool sc_array_insert_n(void **arr, size_t elem_size, size_t i, const void *src,
+                       size_t n)
+{
+    const size_t size = sc_array_size(*arr);
+    char *p;
+
+    assert(i <= size);
+
+    if (n == 0) {
+        return true;
+    }
+
+    if (!sc_array_room(arr, elem_size, n)) {
+        return false;
+    }
+
+    p = *arr;
+    if (i < size) {
+        memmove(p + (i + n) * elem_size, p + i * elem_size,
+                (size - i) * elem_size);
+    }
+
+    memcpy(p + i * elem_size, src, n * elem_size);
+    sc_array_size(*arr) = size + n;
+
+    return true;
+}
+
+bool sc_array_seg_init(struct sc_array_seg *s, size_t elem_size, size_t first)
+{
+    size_t shift;
+
+    if (elem_size == 0 || first == 0 || first > SC_SIZE_MAX / elem_size) {
+        sc_array_on_error("Invalid element size(%zu) or first chunk(%zu). ",
+                          elem_size, first);
+        return false;
+    }
+
+    shift = sc_array_seg_log2(first);
+    shift += (first & (first - 1)) != 0;
+    if (shift >= SC_ARRAY_SEG_CHUNKS - 1 ||
+        ((size_t) 1 << shift) > SC_SIZE_MAX / elem_size) {
+        sc_array_on_error("First chunk(%zu) is too large. ", first);
+        return false;
     }
 
+    *s = (struct sc_array_seg){
+            .elem_size = elem_size,
+            .shift = shift,
+    };
+
     return true;
 }
+
+void sc_array_seg_term(struct sc_array_seg *s)
+{
+    for (size_t i = 0; i < s->chunks; i++) {
+        sc_array_free(s->chunk[i]);
+    }
+
+    s->size = 0;
+    s->cap = 0;
+    s->chunks = 0;
+}
+
+void *sc_array_seg_push(struct sc_array_seg *s)
+{
+    size_t n, bytes;
+    void *chunk;
+
+    if (s->size == s->cap) {
+        // Indexes are offset by the first chunk size, they must fit too.
+        n = (size_t) 1 << (s->shift + s->chunks);
+        if (s->shift + s->chunks >= SC_ARRAY_SEG_CHUNKS - 1 ||
+            n > SC_SIZE_MAX / s->elem_size) {
+            sc_array_on_error("Max capacity(%zu) has been reached. ", s->cap);
+            return NULL;
+        }
+
+        bytes = n * s->elem_size;
+        chunk = sc_array_realloc(NULL, bytes);
+        if (chunk == NULL) {
+            sc_array_on_error("Failed to allocate %zu bytes. ", bytes);
+            return NULL;
+        }
+
+        s->chunk[s->chunks++] = chunk;
+        s->cap += n;
+    }
+
+    s->size++;
+    return sc_array_seg_at(s, s->size - 1);
+}
+
+void sc_array_seg_truncate(struct sc_array_seg *s, size_t n)
+{
+    if (n < s->size) {
+        s->size = n;
+    }
+}
+
+void sc_array_seg_trim(struct sc_array_seg *s)
+{
+    size_t n;
+
+    while (s->chunks > 0) {
+        n = (size_t) 1 << (s->shift + s->chunks - 1);
+        if (s->cap - n < s->size) {
+            break;
+        }
+
+        sc_array_free(s->chunk[--s->chunks]);
+        s->cap -= n;
+    }
+}
+
+#if defined(_WIN32) || defined(_WIN64)
+    #include <process.h>
+    #include <windows.h>
+
+struct sc_array_thread
+{
+    HANDLE id;
+    void (*fn)(void *);
+    void *arg;
+};
+
+static unsigned int __stdcall sc_array_thread_fn(void *arg)
+{
+    struct sc_array_thread *t = arg;
+
+    t->fn(t->arg);
+    return 0;
+}
+
+static bool sc_array_thread_start(struct sc_array_thread *t)
+{
+    t->id = (HANDLE) _beginthreadex(NULL, 0, sc_array_thread_fn, t, 0, NULL);
+    return t->id != 0;
+}
+
+static void sc_array_thread_join(struct sc_array_thread *t)
+{
+    WaitForSingleObject(t->id, INFINITE);
+    CloseHandle(t->id);
+}
+
+#else
+    #include <pthread.h>
+
+struct sc_array_thread
+{
+    pthread_t id;
+    void (*fn)(void *);
+    void *arg;
+};
+
+static void *sc_array_thread_fn(void *arg)
+{
+    struct sc_array_thread *t = arg;
+
+    t->fn(t->arg);
+    return NULL;
+}
+
+static bool sc_array_thread_start(struct sc_array_thread *t)
+{
+    return pthread_create(&t->id, NULL, sc_array_thread_fn, t) == 0;
+}
+
+static void sc_array_thread_join(struct sc_array_thread *t)
+{
+    int rc;
+
+    rc = pthread_join(t->id, NULL);
+    assert(rc == 0);
+    (void) rc;
+}
+
+#endif
+
+void sc_array_run(void (*fn)(void *), void *args, size_t size, size_t n)
+{
+    bool started[SC_ARRAY_THREADS_MAX] = {false};
+    struct sc_array_thread t[SC_ARRAY_THREADS_MAX];
+
+    assert(n <= SC_ARRAY_THREADS_MAX);
+
+    for (size_t i = 1; i < n; i++) {
+        t[i].fn = fn;
+        t[i].arg = (char *) args + i * size;
+        started[i] = sc_array_thread_start(&t[i]);
+    }
+
+    fn(args);
+
+    for (size_t i = 1; i < n; i++) {
+        if (started[i]) {
+            sc_array_thread_join(&t[i]);
+        } else {
+            fn(t[i].arg);
+        }
+    }
+}
+
+/**
+ * Scan kernels. Each kernel starts at index '*i', processes whole vectors
+ * while they fit before 'n' and leaves '*i' at the first element it did not
+ * process. Public functions run the widest kernel the CPU supports, then the
+ * narrower ones and the scalar loop finish the tail.
+ */
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) ||             \
+        (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define SC_ARRAY_SSE2
+
+    #if defined(__GNUC__) || defined(__clang__)
+        #include <immintrin.h>
+        #define SC_ARRAY_AVX2
+        #define sc_array_avx2 __attribute__((target("avx2")))
+    #endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    #include <arm_neon.h>
+    #define SC_ARRAY_NEON
+#endif
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+// Elements filtered between checks of the destination capacity.
+#define SC_ARRAY_FILTER_BLOCK 4096
+
+static inline uint32_t sc_array_ctz(uint32_t x)
+{
+#if defined(_MSC_VER)
+    unsigned long r;
+
+    _BitScanForward(&r, x);
+    return (uint32_t) r;
+#else
+    return (uint32_t) __builtin_ctz(x);
+#endif
+}
+
+static inline uint32_t sc_array_popcount(uint32_t x)
+{
+    x = x - ((x >> 1u) & 0x55555555u);
+    x = (x & 0x33333333u) + ((x >> 2u) & 0x33333333u);
+    x = (x + (x >> 4u)) & 0x0F0F0F0Fu;
+
+    return (x * 0x01010101u) >> 24u;
+}
+
+#define sc_array_scalar_of(sfx, T, S)                                          \
+    static size_t sc_array_find_##sfx##_c(const T *a, size_t i, size_t n,      \
+                                           T v)                                \
+    {                                                                          \
+        for (; i < n; i++) {                                                   \
+            if (a[i] == v) {                                                   \
+                return i;                                                      \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        return SIZE_MAX;                                                       \
+    }                                                                          \
+                                                                               \
+    static size_t sc_array_count_##sfx##_c(const T *a, size_t i, size_t n,     \
+                                            T v)                               \
+    {                                                                          \
+        size_t c = 0;                                                          \
+                                                                               \
+        for (; i < n; i++) {                                                   \
+            c += (a[i] == v);                                                  \
+        }                                                                      \
+                                                                               \
+        return c;                                                              \
+    }                                                                          \
+                                                                               \
+    static void sc_array_minmax_##sfx##_c(const T *a, size_t i, size_t n,      \
+                                          T *min, T *max)                      \
+    {                                                                          \
+        for (; i < n; i++) {                                                   \
+            *min = a[i] < *min ? a[i] : *min;                                  \
+            *max = a[i] > *max ? a[i] : *max;                                  \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    static S sc_array_sum_##sfx##_c(const T *a, size_t i, size_t n)            \
+    {                                                                          \
+        S s = 0;                                                               \
+                                                                               \
+        for (; i < n; i++) {                                                   \
+            s += a[i];                                                         \
+        }                                                                      \
+                                                                               \
+        return s;                                                              \
+    }                                                                          \
+                                                                               \
+    static size_t sc_array_filter_##sfx##_c(const T *a, size_t i, size_t n,    \
+                                             T lo, T hi, T *out)               \
+    {                                                                          \
+        size_t c = 0;                                                          \
+                                                                               \
+        for (; i < n; i++) {                                                   \
+            out[c] = a[i];                                                     \
+            c += (a[i] >= lo && a[i] <= hi);                                   \
+        }                                                                      \
+                                                                               \
+        return c;                                                              \
+    }
+
+sc_array_scalar_of(i32, int32_t, int64_t)
+sc_array_scalar_of(u64, uint64_t, uint64_t)
+sc_array_scalar_of(f64, double, double)
+
+// Appends lanes set in 'mask' (one bit per lane) to 'out'.
+#define sc_array_mask_out(a, i, mask, out, c)                                  \
+    do {                                                                       \
+        uint32_t _m = (mask);                                                  \
+        while (_m != 0) {                                                      \
+            (out)[(c)++] = (a)[(i) + sc_array_ctz(_m)];                        \
+            _m &= _m - 1;                                                      \
+        }                                                                      \
+    } while (0)
+
+#if defined(SC_ARRAY_AVX2)
+
+static bool sc_array_has_avx2(void)
+{
+    return __builtin_cpu_supports("avx2");
+}
+
+sc_array_avx2 static size_t sc_array_find_i32_avx2(const int32_t *a, size_t *i,
+                                                   size_t n, int32_t v)
+{
+    const __m256i x = _mm256_set1_epi32(v);
+    uint32_t m;
+
+    for (; *i + 8 <= n; *i += 8) {
+        __m256i y = _mm256_loadu_si256((const __m256i *) (a + *i));
+        m = (uint32_t) _mm256_movemask_ps(
+                _mm256_castsi256_ps(_mm256_cmpeq_epi32(y, x)));
+        if (m != 0) {
+            return *i + sc_array_ctz(m);
+        }
+    }
+
+    return SIZE_MAX;
+}
+
+sc_array_avx2 static size_t sc_array_count_i32_avx2(const int32_t *a,
+                                                    size_t *i, size_t n,
+                                                    int32_t v)
+{
+    const __m256i x = _mm256_set1_epi32(v);
+    size_t c = 0;
+
+    for (; *i + 8 <= n; *i += 8) {
+        __m256i y = _mm256_loadu_si256((const __m256i *) (a + *i));
+        c += sc_array_popcount((uint32_t) _mm256_movemask_ps(
+                _mm256_castsi256_ps(_mm256_cmpeq_epi32(y, x))));
+    }
+
+    return c;
+}
+
+sc_array_avx2 static void sc_array_minmax_i32_avx2(const int32_t *a, size_t *i,
+                                                   size_t n, int32_t *min,
+                                                   int32_t *max)
+{
+    __m256i lo = _mm256_set1_epi32(*min), hi = _mm256_set1_epi32(*max);
+    int32_t t[8];
+
+    for (; *i + 8 <= n; *i += 8) {
+        __m256i y = _mm256_loadu_si256((const __m256i *) (a + *i));
+        lo = _mm256_min_epi32(lo, y);
+        hi = _mm256_max_epi32(hi, y);
+    }
+
+    _mm256_storeu_si256((__m256i *) t, lo);
+    sc_array_minmax_i32_c(t, 0, 8, min, max);
+    _mm256_storeu_si256((__m256i *) t, hi);
+    sc_array_minmax_i32_c(t, 0, 8, min, max);
+}
+
+sc_array_avx2 static int64_t sc_array_sum_i32_avx2(const int32_t *a, size_t *i,
+                                                   size_t n)
+{
+    __m256i s = _mm256_setzero_si256();
+    int64_t t[4];
+
+    for (; *i + 8 <= n; *i += 8) {
+        __m256i y = _mm256_loadu_si256((const __m256i *) (a + *i));
+        s = _mm256_add_epi64(
+                s, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(y)));
+        s = _mm256_add_epi64(
+                s, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(y, 1)));
+    }
+
+    _mm256_storeu_si256((__m256i *) t, s);
+    return t[0] + t[1] + t[2] + t[3];
+}
+
+sc_array_avx2 static size_t sc_array_filter_i32_avx2(const int32_t *a,
+                                                     size_t *i, size_t n,
+                                                     int32_t lo, int32_t hi,
+                                                     int32_t *out)
+{
+    const __m256i l = _mm256_set1_epi32(lo), h = _mm256_set1_epi32(hi);
+    size_t c = 0;
+    uint32_t m;
+
+    for (; *i + 8 <= n; *i += 8) {
+        __m256i y = _mm256_loadu_si256((const __m256i *) (a + *i));
+        __m256i r = _mm256_or_si256(_mm256_cmpgt_epi32(l, y),
+                                    _mm256_cmpgt_epi32(y, h));
+        m = ~(uint32_t) _mm256_movemask_ps(_mm256_castsi256_ps(r)) & 0xffu;
+        sc_array_mask_out(a, *i, m, out, c);
+    }
+
+    return c;
+}
+
+sc_array_avx2 static size_t sc_array_find_u64_avx2(const uint64_t *a,
+                                                   size_t *i, size_t n,
+                                                   uint64_t v)
+{
+    const __m256i x = _mm256_set1_epi64x((long long) v);
+    uint32_t m;
+
+    for (; *i + 4 <= n; *i += 4) {
+        __m256i y = _mm256_loadu_si256((const __m256i *) (a + *i));
+        m = (uint32_t) _mm256_movemask_pd(
+                _mm256_castsi256_pd(_mm256_cmpeq_epi64(y, x)));
+        if (m != 0) {
+            return *i + sc_array_ctz(m);
+        }
+    }
+
+    return SIZE_MAX;
+}
+
+sc_array_avx2 static size_t sc_array_count_u64_avx2(const uint64_t *a,
+                                                    size_t *i, size_t n,
+                                                    uint64_t v)
+{
+    const __m256i x = _mm256_set1_epi64x((long long) v);
+    size_t c = 0;
+
+    for (; *i + 4 <= n; *i += 4) {
+        __m256i y = _mm256_loadu_si256((const __m256i *) (a + *i));
+        c += sc_array_popcount((uint32_t) _mm256_movemask_pd(
+                _mm256_castsi256_pd(_mm256_cmpeq_epi64(y, x))));
+    }
+
+    return c;
+}
+
+// AVX2 compares 64-bit lanes as signed, flipping the sign bit fixes it.
+sc_array_avx2 static void sc_array_minmax_u64_avx2(const uint64_t *a,
+                                                   size_t *i, size_t n,
+                                                   uint64_t *min,
+                                                   uint64_t *max)
+{
+    const __m256i f = _mm256_set1_epi64x((long long) (UINT64_C(1) << 63u));
+    __m256i lo = _mm256_set1_epi64x((long long) (*min ^ (UINT64_C(1) << 63u)));
+    __m256i hi = _mm256_set1_epi64x((long long) (*max ^ (UINT64_C(1) << 63u)));
+    uint64_t t[4];
+
+    for (; *i + 4 <= n; *i += 4) {
+        __m256i y = _mm256_xor_si256(
+                _mm256_loadu_si256((const __m256i *) (a + *i)), f);
+        lo = _mm256_blendv_epi8(lo, y, _mm256_cmpgt_epi64(lo, y));
+        hi = _mm256_blendv_epi8(hi, y, _mm256_cmpgt_epi64(y, hi));
+    }
+
+    _mm256_storeu_si256((__m256i *) t, _mm256_xor_si256(lo, f));
+    sc_array_minmax_u64_c(t, 0, 4, min, max);
+    _mm256_storeu_si256((__m256i *) t, _mm256_xor_si256(hi, f));
+    sc_array_minmax_u64_c(t, 0, 4, min, max);
+}
+
+sc_array_avx2 static uint64_t sc_array_sum_u64_avx2(const uint64_t *a,
+                                                    size_t *i, size_t n)
+{
+    __m256i s = _mm256_setzero_si256();
+    uint64_t t[4];
+
+    for (; *i + 4 <= n; *i += 4) {
+        s = _mm256_add_epi64(s,
+                             _mm256_loadu_si256((const __m256i *) (a + *i)));
+    }
+
+    _mm256_storeu_si256((__m256i *) t, s);
+    return t[0] + t[1] + t[2] + t[3];
+}
+
+sc_array_avx2 static size_t sc_array_filter_u64_avx2(const uint64_t *a,
+                                                     size_t *i, size_t n,
+                                                     uint64_t lo, uint64_t hi,
+                                                     uint64_t *out)
+{
+    const uint64_t s = UINT64_C(1) << 63u;
+    const __m256i f = _mm256_set1_epi64x((long long) s);
+    const __m256i l = _mm256_set1_epi64x((long long) (lo ^ s));
+    const __m256i h = _mm256_set1_epi64x((long long) (hi ^ s));
+    size_t c = 0;
+    uint32_t m;
+
+    for (; *i + 4 <= n; *i += 4) {
+        __m256i y = _mm256_xor_si256(
+                _mm256_loadu_si256((const __m256i *) (a + *i)), f);
+        __m256i r = _mm256_or_si256(_mm256_cmpgt_epi64(l, y),
+                                    _mm256_cmpgt_epi64(y, h));
+        m = ~(uint32_t) _mm256_movemask_pd(_mm256_castsi256_pd(r)) & 0xfu;
+        sc_array_mask_out(a, *i, m, out, c);
+    }
+
+    return c;
+}
+
+sc_array_avx2 static size_t sc_array_find_f64_avx2(const double *a, size_t *i,
+                                                   size_t n, double v)
+{
+    const __m256d x = _mm256_set1_pd(v);
+    uint32_t m;
+
+    for (; *i + 4 <= n; *i += 4) {
+        __m256d y = _mm256_loadu_pd(a + *i);
+        m = (uint32_t) _mm256_movemask_pd(_mm256_cmp_pd(y, x, _CMP_EQ_OQ));
+        if (m != 0) {
+            return *i + sc_array_ctz(m);
+        }
+    }
+
+    return SIZE_MAX;
+}
+
+sc_array_avx2 static size_t sc_array_count_f64_avx2(const double *a,
+                                                    size_t *i, size_t n,
+                                                    double v)
+{
+    const __m256d x = _mm256_set1_pd(v);
+    size_t c = 0;
+
+    for (; *i + 4 <= n; *i += 4) {
+        __m256d y = _mm256_loadu_pd(a + *i);
+        c += sc_array_popcount(
+                (uint32_t) _mm256_movemask_pd(_mm256_cmp_pd(y, x, _CMP_EQ_OQ)));
+    }
+
+    return c;
+}
+
+sc_array_avx2 static void sc_array_minmax_f64_avx2(const double *a, size_t *i,
+                                                   size_t n, double *min,
+                                                   double *max)
+{
+    __m256d lo = _mm256_set1_pd(*min), hi = _mm256_set1_pd(*max);
+    double t[4];
+
+    for (; *i + 4 <= n; *i += 4) {
+        __m256d y = _mm256_loadu_pd(a + *i);
+        lo = _mm256_min_pd(lo, y);
+        hi = _mm256_max_pd(hi, y);
+    }
+
+    _mm256_storeu_pd(t, lo);
+    sc_array_minmax_f64_c(t, 0, 4, min, max);
+    _mm256_storeu_pd(t, hi);
+    sc_array_minmax_f64_c(t, 0, 4, min, max);
+}
+
+sc_array_avx2 static double sc_array_sum_f64_avx2(const double *a, size_t *i,
+                                                  size_t n)
+{
+    __m256d s = _mm256_setzero_pd();
+    double t[4];
+
+    for (; *i + 4 <= n; *i += 4) {
+        s = _mm256_add_pd(s, _mm256_loadu_pd(a + *i));
+    }
+
+    _mm256_storeu_pd(t, s);
+    return (t[0] + t[1]) + (t[2] + t[3]);
+}
+
+sc_array_avx2 static size_t sc_array_filter_f64_avx2(const double *a,
+                                                     size_t *i, size_t n,
+                                                     double lo, double hi,
+                                                     double *out)
+{
+    const __m256d l = _mm256_set1_pd(lo), h = _mm256_set1_pd(hi);
+    size_t c = 0;
+    uint32_t m;
+
+    for (; *i + 4 <= n; *i += 4) {
+        __m256d y = _mm256_loadu_pd(a + *i);
+        __m256d r = _mm256_and_pd(_mm256_cmp_pd(y, l, _CMP_GE_OQ),
+                                  _mm256_cmp_pd(y, h, _CMP_LE_OQ));
+        m = (uint32_t) _mm256_movemask_pd(r);
+        sc_array_mask_out(a, *i, m, out, c);
+    }
+
+    return c;
+}
+
+#endif
+
+#if defined(SC_ARRAY_SSE2)
+
+static size_t sc_array_find_i32_v(const int32_t *a, size_t *i, size_t n,
+                                  int32_t v)
+{
+    const __m128i x = _mm_set1_epi32(v);
+    uint32_t m;
+
+    for (; *i + 4 <= n; *i += 4) {
+        __m128i y = _mm_loadu_si128((const __m128i *) (a + *i));
+        m = (uint32_t) _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(y, x)));
+        if (m != 0) {
+            return *i + sc_array_ctz(m);
+        }
+    }
+
+    return SIZE_MAX;
+}
+
+static size_t sc_array_count_i32_v(const int32_t *a, size_t *i, size_t n,
+                                   int32_t v)
+{
+    const __m128i x = _mm_set1_epi32(v);
+    size_t c = 0;
+
+    for (; *i + 4 <= n; *i += 4) {
+        __m128i y = _mm_loadu_si128((const __m128i *) (a + *i));
+        c += sc_array_popcount((uint32_t) _mm_movemask_ps(
+                _mm_castsi128_ps(_mm_cmpeq_epi32(y, x))));
+    }
+
+    return c;
+}
+
+// SSE2 has no 32-bit min/max, select with a compare mask.
+static void sc_array_minmax_i32_v(const int32_t *a, size_t *i, size_t n,
+                                  int32_t *min, int32_t *max)
+{
+    __m128i lo = _mm_set1_epi32(*min), hi = _mm_set1_epi32(*max), m;
+    int32_t t[4];
+
+    for (; *i + 4 <= n; *i += 4) {
+        __m128i y = _mm_loadu_si128((const __m128i *) (a + *i));
+
+        m = _mm_cmpgt_epi32(lo, y);
+        lo = _mm_or_si128(_mm_and_si128(m, y), _mm_andnot_si128(m, lo));
+        m = _mm_cmpgt_epi32(y, hi);
+        hi = _mm_or_si128(_mm_and_si128(m, y), _mm_andnot_si128(m, hi));
+    }
+
+    _mm_storeu_si128((__m128i *) t, lo);
+    sc_array_minmax_i32_c(t, 0, 4, min, max);
+    _mm_storeu_si128((__m128i *) t, hi);
+    sc_array_minmax_i32_c(t, 0, 4, min, max);
+}
+
+static int64_t sc_array_sum_i32_v(const int32_t *a, size_t *i, size_t n)
+{
+    const __m128i z = _mm_setzero_si128();
+    __m128i s = _mm_setzero_si128();
+    int64_t t[2];
+
+    for (; *i + 4 <= n; *i += 4) {
+        __m128i y = _mm_loadu_si128((const __m128i *) (a + *i));
+        __m128i sign = _mm_cmpgt_epi32(z, y);
+
+        s = _mm_add_epi64(s, _mm_unpacklo_epi32(y, sign));
+        s = _mm_add_epi64(s, _mm_unpackhi_epi32(y, sign));
+    }
+
+    _mm_storeu_si128((__m128i *) t, s);
+    return t[0] + t[1];
+}
+
+static size_t sc_array_filter_i32_v(const int32_t *a, size_t *i, size_t n,
+                                    int32_t lo, int32_t hi, int32_t *out)
+{
+    const __m128i l = _mm_set1_epi32(lo), h = _mm_set1_epi32(hi);
+    size_t c = 0;
+    uint32_t m;
+
+    for (; *i + 4 <= n; *i += 4) {
+        __m128i y = _mm_loadu_si128((const __m128i *) (a + *i));
+        __m128i r = _mm_or_si128(_mm_cmplt_epi32(y, l), _mm_cmpgt_epi32(y, h));
+
+        m = ~(uint32_t) _mm_movemask_ps(_mm_castsi128_ps(r)) & 0xfu;
+        sc_array_mask_out(a, *i, m, out, c);
+    }
+
+    return c;
+}
+
+// 64-bit equality from 32-bit compares, both halves must match.
+static inline uint32_t sc_array_eq64_v(__m128i y, __m128i x)
+{
+    __m128i e = _mm_cmpeq_epi32(y, x);
+
+    e = _mm_and_si128(e, _mm_shuffle_epi32(e, _MM_SHUFFLE(2, 3, 0, 1)));
+    return (uint32_t) _mm_movemask_pd(_mm_castsi128_pd(e));
+}
+
+static size_t sc_array_find_u64_v(const uint64_t *a, size_t *i, size_t n,
+                                  uint64_t v)
+{
+    const __m128i x = _mm_set1_epi64x((long long) v);
+    uint32_t m;
+
+    for (; *i + 2 <= n; *i += 2) {
+        m = sc_array_eq64_v(_mm_loadu_si128((const __m128i *) (a + *i)), x);
+        if (m != 0) {
+            return *i + sc_array_ctz(m);
+        }
+    }
+
+    return SIZE_MAX;
+}
+
+static size_t sc_array_count_u64_v(const uint64_t *a, size_t *i, size_t n,
+                                   uint64_t v)
+{
+    const __m128i x = _mm_set1_epi64x((long long) v);
+    size_t c = 0;
+
+    for (; *i + 2 <= n; *i += 2) {
+        c += sc_array_popcount(sc_array_eq64_v(
+                _mm_loadu_si128((const __m128i *) (a + *i)), x));
+    }
+
+    return c;
+}
+
+static uint64_t sc_array_sum_u64_v(const uint64_t *a, size_t *i, size_t n)
+{
+    __m128i s = _mm_setzero_si128();
+    uint64_t t[2];
+
+    for (; *i + 2 <= n; *i += 2) {
+        s = _mm_add_epi64(s, _mm_loadu_si128((const __m128i *) (a + *i)));
+    }
+
+    _mm_storeu_si128((__m128i *) t, s);
+    return t[0] + t[1];
+}
+
+static size_t sc_array_find_f64_v(const double *a, size_t *i, size_t n,
+                                  double v)
+{
+    const __m128d x = _mm_set1_pd(v);
+    uint32_t m;
+
+    for (; *i + 2 <= n; *i += 2) {
+        m = (uint32_t) _mm_movemask_pd(_mm_cmpeq_pd(_mm_loadu_pd(a + *i), x));
+        if (m != 0) {
+            return *i + sc_array_ctz(m);
+        }
+    }
+
+    return SIZE_MAX;
+}
+
+static size_t sc_array_count_f64_v(const double *a, size_t *i, size_t n,
+                                   double v)
+{
+    const __m128d x = _mm_set1_pd(v);
+    size_t c = 0;
+
+    for (; *i + 2 <= n; *i += 2) {
+        c += sc_array_popcount((uint32_t) _mm_movemask_pd(
+                _mm_cmpeq_pd(_mm_loadu_pd(a + *i), x)));
+    }
+
+    return c;
+}
+
+static void sc_array_minmax_f64_v(const double *a, size_t *i, size_t n,
+                                  double *min, double *max)
+{
+    __m128d lo = _mm_set1_pd(*min), hi = _mm_set1_pd(*max);
+    double t[2];
+
+    for (; *i + 2 <= n; *i += 2) {
+        __m128d y = _mm_loadu_pd(a + *i);
+        lo = _mm_min_pd(lo, y);
+        hi = _mm_max_pd(hi, y);
+    }
+
+    _mm_storeu_pd(t, lo);
+    sc_array_minmax_f64_c(t, 0, 2, min, max);
+    _mm_storeu_pd(t, hi);
+    sc_array_minmax_f64_c(t, 0, 2, min, max);
+}
+
+static double sc_array_sum_f64_v(const double *a, size_t *i, size_t n)
+{
+    __m128d s = _mm_setzero_pd();
+    double t[2];
+
+    for (; *i + 2 <= n; *i += 2) {
+        s = _mm_add_pd(s, _mm_loadu_pd(a + *i));
+    }
+
+    _mm_storeu_pd(t, s);
+    return t[0] + t[1];
+}
+
+static size_t sc_array_filter_f64_v(const double *a, size_t *i, size_t n,
+                                    double lo, double hi, double *out)
+{
+    const __m128d l = _mm_set1_pd(lo), h = _mm_set1_pd(hi);
+    size_t c = 0;
+    uint32_t m;
+
+    for (; *i + 2 <= n; *i += 2) {
+        __m128d y = _mm_loadu_pd(a + *i);
+
+        m = (uint32_t) _mm_movemask_pd(
+                _mm_and_pd(_mm_cmpge_pd(y, l), _mm_cmple_pd(y, h)));
+        sc_array_mask_out(a, *i, m, out, c);
+    }
+
+    return c;
+}
+
+#elif defined(SC_ARRAY_NEON)
+
+static size_t sc_array_find_i32_v(const int32_t *a, size_t *i, size_t n,
+                                  int32_t v)
+{
+    const int32x4_t x = vdupq_n_s32(v);
+
+    for (; *i + 4 <= n; *i += 4) {
+        if (vmaxvq_u32(vceqq_s32(vld1q_s32(a + *i), x)) != 0) {
+            return sc_array_find_i32_c(a, *i, *i + 4, v);
+        }
+    }
+
+    return SIZE_MAX;
+}
+
+static size_t sc_array_count_i32_v(const int32_t *a, size_t *i, size_t n,
+                                   int32_t v)
+{
+    const int32x4_t x = vdupq_n_s32(v);
+    size_t c = 0;
+
+    for (; *i + 4 <= n; *i += 4) {
+        c += vaddvq_u32(vshrq_n_u32(vceqq_s32(vld1q_s32(a + *i), x), 31));
+    }
+
+    return c;
+}
+
+static void sc_array_minmax_i32_v(const int32_t *a, size_t *i, size_t n,
+                                  int32_t *min, int32_t *max)
+{
+    int32x4_t lo = vdupq_n_s32(*min), hi = vdupq_n_s32(*max);
+
+    for (; *i + 4 <= n; *i += 4) {
+        int32x4_t y = vld1q_s32(a + *i);
+        lo = vminq_s32(lo, y);
+        hi = vmaxq_s32(hi, y);
+    }
+
+    *min = vminvq_s32(lo);
+    *max = vmaxvq_s32(hi);
+}
+
+static int64_t sc_array_sum_i32_v(const int32_t *a, size_t *i, size_t n)
+{
+    int64x2_t s = vdupq_n_s64(0);
+
+    for (; *i + 4 <= n; *i += 4) {
+        s = vpadalq_s32(s, vld1q_s32(a + *i));
+    }
+
+    return vaddvq_s64(s);
+}
+
+static size_t sc_array_filter_i32_v(const int32_t *a, size_t *i, size_t n,
+                                    int32_t lo, int32_t hi, int32_t *out)
+{
+    const int32x4_t l = vdupq_n_s32(lo), h = vdupq_n_s32(hi);
+    size_t c = 0;
+
+    for (; *i + 4 <= n; *i += 4) {
+        int32x4_t y = vld1q_s32(a + *i);
+        if (vmaxvq_u32(vandq_u32(vcgeq_s32(y, l), vcleq_s32(y, h))) != 0) {
+            c += sc_array_filter_i32_c(a, *i, *i + 4, lo, hi, out + c);
+        }
+    }
+
+    return c;
+}
+
+static size_t sc_array_find_u64_v(const uint64_t *a, size_t *i, size_t n,
+                                  uint64_t v)
+{
+    const uint64x2_t x = vdupq_n_u64(v);
+
+    for (; *i + 2 <= n; *i += 2) {
+        uint64x2_t e = vceqq_u64(vld1q_u64(a + *i), x);
+        if (vmaxvq_u32(vreinterpretq_u32_u64(e)) != 0) {
+            return sc_array_find_u64_c(a, *i, *i + 2, v);
+        }
+    }
+
+    return SIZE_MAX;
+}
+
+static size_t sc_array_count_u64_v(const uint64_t *a, size_t *i, size_t n,
+                                   uint64_t v)
+{
+    const uint64x2_t x = vdupq_n_u64(v);
+    size_t c = 0;
+
+    for (; *i + 2 <= n; *i += 2) {
+        c += vaddvq_u64(vshrq_n_u64(vceqq_u64(vld1q_u64(a + *i), x), 63));
+    }
+
+    return c;
+}
+
+static void sc_array_minmax_u64_v(const uint64_t *a, size_t *i, size_t n,
+                                  uint64_t *min, uint64_t *max)
+{
+    uint64x2_t lo = vdupq_n_u64(*min), hi = vdupq_n_u64(*max);
+    uint64_t t[2];
+
+    for (; *i + 2 <= n; *i += 2) {
+        uint64x2_t y = vld1q_u64(a + *i);
+        lo = vbslq_u64(vcgtq_u64(lo, y), y, lo);
+        hi = vbslq_u64(vcgtq_u64(y, hi), y, hi);
+    }
+
+    vst1q_u64(t, lo);
+    sc_array_minmax_u64_c(t, 0, 2, min, max);
+    vst1q_u64(t, hi);
+    sc_array_minmax_u64_c(t, 0, 2, min, max);
+}
+
+static uint64_t sc_array_sum_u64_v(const uint64_t *a, size_t *i, size_t n)
+{
+    uint64x2_t s = vdupq_n_u64(0);
+
+    for (; *i + 2 <= n; *i += 2) {
+        s = vaddq_u64(s, vld1q_u64(a + *i));
+    }
+
+    return vaddvq_u64(s);
+}
+
+static size_t sc_array_filter_u64_v(const uint64_t *a, size_t *i, size_t n,
+                                    uint64_t lo, uint64_t hi, uint64_t *out)
+{
+    const uint64x2_t l = vdupq_n_u64(lo), h = vdupq_n_u64(hi);
+    size_t c = 0;
+
+    for (; *i + 2 <= n; *i += 2) {
+        uint64x2_t y = vld1q_u64(a + *i);
+        uint64x2_t r = vandq_u64(vcgeq_u64(y, l), vcleq_u64(y, h));
+        if (vmaxvq_u32(vreinterpretq_u32_u64(r)) != 0) {
+            c += sc_array_filter_u64_c(a, *i, *i + 2, lo, hi, out + c);
+        }
+    }
+
+    return c;
+}
+
+static size_t sc_array_find_f64_v(const double *a, size_t *i, size_t n,
+                                  double v)
+{
+    const float64x2_t x = vdupq_n_f64(v);
+
+    for (; *i + 2 <= n; *i += 2) {
+        uint64x2_t e = vceqq_f64(vld1q_f64(a + *i), x);
+        if (vmaxvq_u32(vreinterpretq_u32_u64(e)) != 0) {
+            return sc_array_find_f64_c(a, *i, *i + 2, v);
+        }
+    }
+
+    return SIZE_MAX;
+}
+
+static size_t sc_array_count_f64_v(const double *a, size_t *i, size_t n,
+                                   double v)
+{
+    const float64x2_t x = vdupq_n_f64(v);
+    size_t c = 0;
+
+    for (; *i + 2 <= n; *i += 2) {
+        c += vaddvq_u64(vshrq_n_u64(vceqq_f64(vld1q_f64(a + *i), x), 63));
+    }
+
+    return c;
+}
+
+static void sc_array_minmax_f64_v(const double *a, size_t *i, size_t n,
+                                  double *min, double *max)
+{
+    float64x2_t lo = vdupq_n_f64(*min), hi = vdupq_n_f64(*max);
+
+    for (; *i + 2 <= n; *i += 2) {
+        float64x2_t y = vld1q_f64(a + *i);
+        lo = vminq_f64(lo, y);
+        hi = vmaxq_f64(hi, y);
+    }
+
+    *min = vminvq_f64(lo);
+    *max = vmaxvq_f64(hi);
+}
+
+static double sc_array_sum_f64_v(const double *a, size_t *i, size_t n)
+{
+    float64x2_t s = vdupq_n_f64(0);
+
+    for (; *i + 2 <= n; *i += 2) {
+        s = vaddq_f64(s, vld1q_f64(a + *i));
+    }
+
+    return vaddvq_f64(s);
+}
+
+static size_t sc_array_filter_f64_v(const double *a, size_t *i, size_t n,
+                                    double lo, double hi, double *out)
+{
+    const float64x2_t l = vdupq_n_f64(lo), h = vdupq_n_f64(hi);
+    size_t c = 0;
+
+    for (; *i + 2 <= n; *i += 2) {
+        float64x2_t y = vld1q_f64(a + *i);
+        uint64x2_t r = vandq_u64(vcgeq_f64(y, l), vcleq_f64(y, h));
+        if (vmaxvq_u32(vreinterpretq_u32_u64(r)) != 0) {
+            c += sc_array_filter_f64_c(a, *i, *i + 2, lo, hi, out + c);
+        }
+    }
+
+    return c;
+}
+
+#endif
+
+#if defined(SC_ARRAY_AVX2)
+    #define sc_array_call_avx2(ret, fn, ...)                                   \
+        if (sc_array_has_avx2()) {                                             \
+            ret fn##_avx2(__VA_ARGS__);                                        \
+        }
+#else
+    #define sc_array_call_avx2(ret, fn, ...)
+#endif
+
+#if defined(SC_ARRAY_SSE2) || defined(SC_ARRAY_NEON)
+    #define sc_array_call_v(ret, fn, ...) ret fn##_v(__VA_ARGS__);
+#else
+    #define sc_array_call_v(ret, fn, ...)
+#endif
+
+#define sc_array_call_none(ret, fn, ...)
+
+// SSE2 has no 64-bit compare, u64 min/max and filter use the scalar loop.
+#if defined(SC_ARRAY_SSE2)
+    #define sc_array_call_v_u64 sc_array_call_none
+#else
+    #define sc_array_call_v_u64 sc_array_call_v
+#endif
+
+/**
+ * 'call_cmp_v' dispatches the min/max and filter kernels, it is
+ * sc_array_call_none for types that have none on the target.
+ */
+#define sc_array_scan_impl(sfx, T, S, call_cmp_v)                              \
+    size_t sc_array_find_##sfx(const T *arr, T v)                              \
+    {                                                                          \
+        const size_t n = sc_array_size(arr);                                   \
+        size_t i = 0, r = SIZE_MAX;                                            \
+                                                                               \
+        sc_array_call_avx2(r =, sc_array_find_##sfx, arr, &i, n, v);           \
+        if (r != SIZE_MAX) {                                                   \
+            return r;                                                          \
+        }                                                                      \
+                                                                               \
+        sc_array_call_v(r =, sc_array_find_##sfx, arr, &i, n, v);              \
+        if (r != SIZE_MAX) {                                                   \
+            return r;                                                          \
+        }                                                                      \
+                                                                               \
+        return sc_array_find_##sfx##_c(arr, i, n, v);                          \
+    }                                                                          \
+                                                                               \
+    size_t sc_array_count_##sfx(const T *arr, T v)                             \
+    {                                                                          \
+        const size_t n = sc_array_size(arr);                                   \
+        size_t i = 0, c = 0;                                                   \
+                                                                               \
+        sc_array_call_avx2(c +=, sc_array_count_##sfx, arr, &i, n, v);         \
+        sc_array_call_v(c +=, sc_array_count_##sfx, arr, &i, n, v);            \
+                                                                               \
+        return c + sc_array_count_##sfx##_c(arr, i, n, v);                     \
+    }                                                                          \
+                                                                               \
+    bool sc_array_minmax_##sfx(const T *arr, T *min, T *max)                   \
+    {                                                                          \
+        const size_t n = sc_array_size(arr);                                   \
+        size_t i = 0;                                                          \
+                                                                               \
+        if (n == 0) {                                                          \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        *min = arr[0];                                                         \
+        *max = arr[0];                                                         \
+                                                                               \
+        sc_array_call_avx2(, sc_array_minmax_##sfx, arr, &i, n, min, max);     \
+        call_cmp_v(, sc_array_minmax_##sfx, arr, &i, n, min, max);             \
+        sc_array_minmax_##sfx##_c(arr, i, n, min, max);                        \
+                                                                               \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    S sc_array_sum_##sfx(const T *arr)                                         \
+    {                                                                          \
+        const size_t n = sc_array_size(arr);                                   \
+        size_t i = 0;                                                          \
+        S s = 0;                                                               \
+                                                                               \
+        sc_array_call_avx2(s +=, sc_array_sum_##sfx, arr, &i, n);              \
+        sc_array_call_v(s +=, sc_array_sum_##sfx, arr, &i, n);                 \
+                                                                               \
+        return s + sc_array_sum_##sfx##_c(arr, i, n);                          \
+    }                                                                          \
+                                                                               \
+    bool sc_array_filter_##sfx(T **dst, const T *src, T lo, T hi)              \
+    {                                                                          \
+        const size_t n = sc_array_size(src);                                   \
+        size_t i = 0, end, c;                                                  \
+        T *out;                                                                \
+                                                                               \
+        while (i < n) {                                                        \
+            end = n - i < SC_ARRAY_FILTER_BLOCK ? n                            \
+                                                : i + SC_ARRAY_FILTER_BLOCK;   \
+            if (!sc_array_room((void **) dst, sizeof(T), end - i)) {           \
+                return false;                                                  \
+            }                                                                  \
+                                                                               \
+            c = 0;                                                             \
+            out = *dst + sc_array_size(*dst);                                  \
+                                                                               \
+            sc_array_call_avx2(c +=, sc_array_filter_##sfx, src, &i, end, lo,  \
+                               hi, out + c);                                   \
+            call_cmp_v(c +=, sc_array_filter_##sfx, src, &i, end, lo, hi,      \
+                       out + c);                                               \
+            c += sc_array_filter_##sfx##_c(src, i, end, lo, hi, out + c);      \
+                                                                               \
+            sc_array_meta(*dst)->size += c;                                    \
+            i = end;                                                           \
+        }                                                                      \
+                                                                               \
+        return true;                                                           \
+    }
+
+sc_array_scan_impl(i32, int32_t, int64_t, sc_array_call_v)
+sc_array_scan_impl(u64, uint64_t, uint64_t, sc_array_call_v_u64)
+sc_array_scan_impl(f64, double, double, sc_array_call_v)
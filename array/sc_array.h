@@ -32,6 +32,10 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
 /**
  * Internals, do not use
  */
@@ -45,9 +49,29 @@ struct sc_array
 #define sc_array_meta(arr)                                                     \
     ((struct sc_array *) ((char *) (arr) -offsetof(struct sc_array, elems)))
 
+// Capacity bits of arrays on inline storage and on mapped memory.
+#define SC_ARRAY_INLINE ((size_t) 1 << (sizeof(size_t) * 8 - 1))
+#define SC_ARRAY_MAPPED ((size_t) 1 << (sizeof(size_t) * 8 - 2))
+#define SC_ARRAY_FLAGS  (SC_ARRAY_INLINE | SC_ARRAY_MAPPED)
+
 bool sc_array_init(void **arr, size_t elem_size, size_t cap);
+void sc_array_init_inline(void **arr, void *buf, size_t cap);
+bool sc_array_init_mapped(void **arr, size_t elem_size, size_t cap);
 void sc_array_term(void **arr);
 bool sc_array_expand(void **arr, size_t elem_size);
+bool sc_array_grow(void **arr, size_t elem_size, size_t cap);
+bool sc_array_resize_n(void **arr, size_t elem_size, size_t n);
+bool sc_array_insert_n(void **arr, size_t elem_size, size_t i, const void *src,
+                       size_t n);
+
+/**
+ * Calls fn() for each of the 'n' structs in 'args', each struct is 'size'
+ * bytes. The first one runs in the calling thread, the others in new threads,
+ * returns when all calls are done. If a thread cannot be started, its call
+ * runs in the calling thread. 'n' must not exceed SC_ARRAY_THREADS_MAX.
+ */
+#define SC_ARRAY_THREADS_MAX 256
+void sc_array_run(void (*fn)(void *), void *args, size_t size, size_t n);
 
 /**
  * Internal End.
@@ -79,6 +103,61 @@ bool sc_array_expand(void **arr, size_t elem_size);
 #define sc_array_create(arr, cap)                                              \
     sc_array_init((void **) &(arr), sizeof(*(arr)), cap)
 
+/**
+ * Small buffer storage. Declares a struct type with room for 'n' elements of
+ * type T, put it in the struct that owns the array or on the stack :
+ *
+ *      struct request {
+ *          sc_array_inline(int, 8) buf;
+ *          int *ids;
+ *      };
+ *
+ *      sc_array_create_inline(req->ids, req->buf);
+ *      sc_array_add(req->ids, 3);
+ *      ...
+ *      sc_array_destroy(req->ids);
+ */
+#define sc_array_inline(T, n)                                                  \
+    struct {                                                                   \
+        size_t size;                                                           \
+        size_t cap;                                                            \
+        T elems[n];                                                            \
+    }
+
+/**
+ *   Creates the array on 'buf', no memory allocation is made until the array
+ *   grows past the capacity of 'buf', then elements are moved to the heap and
+ *   'buf' is no longer used. All other macros work as usual, destroy is still
+ *   required as the array may have moved to the heap. 'buf' must not be moved
+ *   or go out of scope while the array is on it.
+ *
+ *   @param arr Array pointer
+ *   @param buf Storage declared with sc_array_inline(), for the same type
+ */
+#define sc_array_create_inline(arr, buf)                                       \
+    do {                                                                       \
+        assert(sizeof((buf).elems[0]) == sizeof(*(arr)));                      \
+        assert((size_t) ((char *) (buf).elems - (char *) &(buf)) ==            \
+               offsetof(struct sc_array, elems));                              \
+        sc_array_init_inline((void **) &(arr), &(buf),                         \
+                             sizeof((buf).elems) / sizeof((buf).elems[0]));    \
+    } while (0)
+
+/**
+ *   Creates a large array on memory from mmap() rather than the allocator, for
+ *   arrays of hundreds of megabytes or more. Memory is requested in 2 MB steps
+ *   once it is past 2 MB and is advised for transparent huge pages, which
+ *   cuts TLB misses on random access. On Linux, growth remaps pages instead of
+ *   copying them. All other macros work as usual, capacity may be larger than
+ *   requested. Falls back to sc_array_create() on Windows.
+ *
+ *   @param arr Array pointer
+ *   @param cap Initial capacity
+ *   @return    'true' on success, 'false' on out of memory
+ */
+#define sc_array_create_mapped(arr, cap)                                       \
+    sc_array_init_mapped((void **) &(arr), sizeof(*(arr)), cap)
+
 /**
  *   @param arr Array pointer
  */
@@ -88,7 +167,7 @@ bool sc_array_expand(void **arr, size_t elem_size);
  *   @param arr Array pointer
  *   @return    Current allocated capacity
  */
-#define sc_array_cap(arr) (sc_array_meta((arr))->cap)
+#define sc_array_cap(arr) (sc_array_meta((arr))->cap & ~SC_ARRAY_FLAGS)
 
 /**
  *   @param arr Array pointer
@@ -110,9 +189,63 @@ bool sc_array_expand(void **arr, size_t elem_size);
  *               to expand underlying memory.
  */
 #define sc_array_add(arr, elem)                                                \
-    sc_array_expand((void **) &((arr)), sizeof(*(arr))) == true ?              \
-            (arr)[sc_array_meta(arr)->size++] = (elem),                        \
-            true : false
+    (sc_array_expand((void **) &((arr)), sizeof(*(arr))) == true ?             \
+             (arr)[sc_array_meta(arr)->size++] = (elem),                       \
+             true : false)
+
+/**
+ *   Grows capacity to at least 'cap' elements, does not change size.
+ *
+ *   @param arr Array pointer
+ *   @param cap Capacity
+ *   @return    'true' on success, 'false' on out of memory, array is not
+ *              modified then.
+ */
+#define sc_array_reserve(arr, cap)                                             \
+    sc_array_grow((void **) &(arr), sizeof(*(arr)), cap)
+
+/**
+ *   Sets element count to 'n'. New elements are zero filled, capacity is kept
+ *   if the array shrinks.
+ *
+ *   @param arr Array pointer
+ *   @param n   Element count
+ *   @return    'true' on success, 'false' on out of memory, array is not
+ *              modified then.
+ */
+#define sc_array_resize(arr, n)                                                \
+    sc_array_resize_n((void **) &(arr), sizeof(*(arr)), n)
+
+/**
+ *   Appends 'n' elements from 'src' with a single capacity check and copy.
+ *
+ *   @param arr Array pointer
+ *   @param src Elements of the same type, must not point into 'arr'
+ *   @param n   Element count
+ *   @return    'true' on success, 'false' on out of memory, array is not
+ *              modified then.
+ */
+#define sc_array_add_all(arr, src, n)                                          \
+    sc_array_insert_n((void **) &(arr), sizeof(*(arr)), sc_array_size(arr),    \
+                      (src), (n))
+
+/**
+ *   Inserts 'n' elements from 'src' before index 'i', moves the elements after
+ *   'i' once.
+ *
+ *   vec[a,b,c] -> sc_array_insert_range(vec, 1, [x,y], 2) -> vec[a,x,y,b,c]
+ *
+ *   @param arr Array pointer
+ *   @param i   Index, 'i' == size appends
+ *   @param src Elements of the same type, must not point into 'arr'
+ *   @param n   Element count
+ *   @return    'true' on success, 'false' on out of memory, array is not
+ *              modified then.
+ *
+ *   If 'i' is out of the range, result is undefined.
+ */
+#define sc_array_insert_range(arr, i, src, n)                                  \
+    sc_array_insert_n((void **) &(arr), sizeof(*(arr)), (i), (src), (n))
 
 
 /**
@@ -173,6 +306,652 @@ bool sc_array_expand(void **arr, size_t elem_size);
 #define sc_array_sort(arr, cmp)                                                \
     (qsort((arr), sc_array_size((arr)), sizeof(*(arr)), cmp))
 
+/**
+ * Typed sorts. qsort() calls the comparator through a function pointer and
+ * swaps elements byte by byte, these are generated for an element type, so
+ * comparisons are inlined and elements are moved with plain assignment.
+ *
+ * sc_array_sort_of(name, T, less) :
+ *
+ * Defines sc_array_sort_##name(arr), an introsort: quicksort with a median of
+ * three pivot, insertion sort for short ranges and heapsort if recursion gets
+ * too deep, so worst case is O(n log n). Not stable. less(x, y) is called with
+ * two elements of type T and returns true if 'x' goes before 'y'. It can be a
+ * macro or a static function, e.g:
+ *
+ *      #define point_less(a, b) ((a).x < (b).x)
+ *      sc_array_sort_of(point, struct point, point_less)
+ *
+ *      sc_array_sort_point(points);
+ *
+ * sc_array_radix_of(name, T, K, key) :
+ *
+ * Defines sc_array_radix_##name(arr), a stable LSD radix sort, one pass per
+ * byte of the key. Passes where all keys have the same byte are skipped, so
+ * small keys in a wide type cost less. key(x) is called with an element of type
+ * T and returns its key as unsigned integer type K (uint32_t or uint64_t),
+ * larger keys go after smaller ones. Use sc_array_key_* functions below to turn
+ * signed integers and floats into such keys. Allocates a temporary array of the
+ * same size, returns false on out of memory, array is not modified then.
+ *
+ *      #define point_key(a) sc_array_key_i64((a).x)
+ *      sc_array_radix_of(point, struct point, uint64_t, point_key)
+ *
+ *      if (!sc_array_radix_point(points)) { ...out of memory }
+ */
+
+// Ranges shorter than this are sorted with insertion sort.
+#define SC_ARRAY_SORT_SMALL 16
+
+#define sc_array_swap(T, a, b)                                                 \
+    do {                                                                       \
+        T _t = (a);                                                            \
+        (a) = (b);                                                             \
+        (b) = _t;                                                              \
+    } while (0)
+
+#define sc_array_sort_of(name, T, less)                                        \
+    static inline void sc_array_isort_##name(T *a, size_t n)                   \
+    {                                                                          \
+        for (size_t i = 1; i < n; i++) {                                       \
+            T t = a[i];                                                        \
+            size_t j = i;                                                      \
+                                                                               \
+            for (; j > 0 && less(t, a[j - 1]); j--) {                          \
+                a[j] = a[j - 1];                                               \
+            }                                                                  \
+            a[j] = t;                                                          \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    static inline void sc_array_sift_##name(T *a, size_t i, size_t n)          \
+    {                                                                          \
+        T t = a[i];                                                            \
+        size_t c;                                                              \
+                                                                               \
+        while ((c = 2 * i + 1) < n) {                                          \
+            if (c + 1 < n && less(a[c], a[c + 1])) {                           \
+                c++;                                                           \
+            }                                                                  \
+            if (!less(t, a[c])) {                                              \
+                break;                                                         \
+            }                                                                  \
+            a[i] = a[c];                                                       \
+            i = c;                                                             \
+        }                                                                      \
+        a[i] = t;                                                              \
+    }                                                                          \
+                                                                               \
+    static inline void sc_array_hsort_##name(T *a, size_t n)                   \
+    {                                                                          \
+        for (size_t i = n / 2; i > 0; i--) {                                   \
+            sc_array_sift_##name(a, i - 1, n);                                 \
+        }                                                                      \
+                                                                               \
+        for (size_t i = n - 1; i > 0; i--) {                                   \
+            sc_array_swap(T, a[0], a[i]);                                      \
+            sc_array_sift_##name(a, 0, i);                                     \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    static inline void sc_array_qsort_##name(T *a, size_t n, size_t depth)     \
+    {                                                                          \
+        size_t i, j, m;                                                        \
+        T p;                                                                   \
+                                                                               \
+        while (n > SC_ARRAY_SORT_SMALL) {                                      \
+            if (depth-- == 0) {                                                \
+                sc_array_hsort_##name(a, n);                                   \
+                return;                                                        \
+            }                                                                  \
+                                                                               \
+            /* Median of three, also bounds the scans below. */                \
+            m = (n - 1) / 2;                                                   \
+            if (less(a[m], a[0])) {                                            \
+                sc_array_swap(T, a[m], a[0]);                                  \
+            }                                                                  \
+            if (less(a[n - 1], a[m])) {                                        \
+                sc_array_swap(T, a[n - 1], a[m]);                              \
+                if (less(a[m], a[0])) {                                        \
+                    sc_array_swap(T, a[m], a[0]);                              \
+                }                                                              \
+            }                                                                  \
+                                                                               \
+            p = a[m];                                                          \
+            i = 0;                                                             \
+            j = n - 1;                                                         \
+                                                                               \
+            while (true) {                                                     \
+                while (less(a[i], p)) {                                        \
+                    i++;                                                       \
+                }                                                              \
+                while (less(p, a[j])) {                                        \
+                    j--;                                                       \
+                }                                                              \
+                if (i >= j) {                                                  \
+                    break;                                                     \
+                }                                                              \
+                sc_array_swap(T, a[i], a[j]);                                  \
+                i++;                                                           \
+                j--;                                                           \
+            }                                                                  \
+                                                                               \
+            /* Recurse into the smaller side, loop on the larger one. */       \
+            j++;                                                               \
+            if (j < n - j) {                                                   \
+                sc_array_qsort_##name(a, j, depth);                            \
+                a += j;                                                        \
+                n -= j;                                                        \
+            } else {                                                           \
+                sc_array_qsort_##name(a + j, n - j, depth);                    \
+                n = j;                                                         \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        sc_array_isort_##name(a, n);                                           \
+    }                                                                          \
+                                                                               \
+    /* Sorts 'n' elements at 'a', 'a' does not have to be an sc_array. */      \
+    static inline void sc_array_sort_range_##name(T *a, size_t n)              \
+    {                                                                          \
+        size_t depth = 0;                                                      \
+                                                                               \
+        for (size_t i = n; i > 1; i >>= 1) {                                   \
+            depth += 2;                                                        \
+        }                                                                      \
+                                                                               \
+        sc_array_qsort_##name(a, n, depth);                                    \
+    }                                                                          \
+                                                                               \
+    static inline void sc_array_sort_##name(T *arr)                            \
+    {                                                                          \
+        sc_array_sort_range_##name(arr, sc_array_size(arr));                   \
+    }
+
+/**
+ * sc_array_sort_parallel_of(name, T, less) :
+ *
+ * Defines sc_array_sort_parallel_##name(arr, threads, min), a parallel merge
+ * sort. Must come after sc_array_sort_of() with the same 'name', 'T' and
+ * 'less'. The array is split into one part per thread and parts are sorted
+ * with sc_array_sort_##name() at the same time. Sorted runs are then merged
+ * pairwise in rounds, each round splits its output evenly between all threads,
+ * so the last merges keep all threads busy too. Not stable.
+ *
+ * 'threads' is capped at SC_ARRAY_THREADS_MAX and so that each thread gets at
+ * least 'min' elements, '0' means SC_ARRAY_PARALLEL_MIN. If that leaves one
+ * thread, or the temporary array of the same size cannot be allocated, the
+ * array is sorted in the calling thread.
+ */
+#define SC_ARRAY_PARALLEL_MIN 65536
+
+#define sc_array_sort_parallel_of(name, T, less)                               \
+    struct sc_array_job_##name                                                 \
+    {                                                                          \
+        T *src;                                                                \
+        T *dst;                                                                \
+        size_t *bounds;                                                        \
+        size_t n;                                                              \
+        size_t parts;                                                          \
+        size_t part;                                                           \
+        size_t width;                                                          \
+    };                                                                         \
+                                                                               \
+    /* Sorts its part in 'src', copies it to 'dst' if 'dst' is set. */         \
+    static inline void sc_array_psort_##name(void *arg)                        \
+    {                                                                          \
+        struct sc_array_job_##name *j = arg;                                   \
+        size_t lo = j->bounds[j->part], hi = j->bounds[j->part + 1];           \
+                                                                               \
+        sc_array_sort_range_##name(j->src + lo, hi - lo);                      \
+        if (j->dst != NULL) {                                                  \
+            memcpy(j->dst + lo, j->src + lo, (hi - lo) * sizeof(T));           \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    /* Returns how many of the first 'k' merged elements come from 'a'. */     \
+    static inline size_t sc_array_corank_##name(const T *a, size_t la,         \
+                                                const T *b, size_t lb,         \
+                                                size_t k)                      \
+    {                                                                          \
+        size_t mid, lo = k > lb ? k - lb : 0, hi = k < la ? k : la;            \
+                                                                               \
+        while (lo < hi) {                                                      \
+            mid = lo + (hi - lo) / 2;                                          \
+            if (less(b[k - mid - 1], a[mid])) {                                \
+                hi = mid;                                                      \
+            } else {                                                           \
+                lo = mid + 1;                                                  \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        return lo;                                                             \
+    }                                                                          \
+                                                                               \
+    /* Writes its share of the output of all merges in this round. */          \
+    static inline void sc_array_pmerge_##name(void *arg)                       \
+    {                                                                          \
+        struct sc_array_job_##name *j = arg;                                   \
+        const size_t w = j->width, p = j->parts;                               \
+        const size_t lo = j->bounds[j->part], hi = j->bounds[j->part + 1];     \
+        size_t s, m, e, la, lb, ks, ke, i, ie, k, ke_b;                        \
+        const T *a, *b;                                                        \
+        T *out;                                                                \
+                                                                               \
+        for (size_t r = 0; r < p; r += 2 * w) {                                \
+            s = j->bounds[r];                                                  \
+            m = j->bounds[r + w < p ? r + w : p];                              \
+            e = j->bounds[r + 2 * w < p ? r + 2 * w : p];                      \
+            if (e <= lo || s >= hi) {                                          \
+                continue;                                                      \
+            }                                                                  \
+                                                                               \
+            a = j->src + s;                                                    \
+            b = j->src + m;                                                    \
+            la = m - s;                                                        \
+            lb = e - m;                                                        \
+            ks = (lo > s ? lo : s) - s;                                        \
+            ke = (hi < e ? hi : e) - s;                                        \
+                                                                               \
+            i = sc_array_corank_##name(a, la, b, lb, ks);                      \
+            ie = sc_array_corank_##name(a, la, b, lb, ke);                     \
+            k = ks - i;                                                        \
+            ke_b = ke - ie;                                                    \
+            out = j->dst + s + ks;                                             \
+                                                                               \
+            while (i < ie && k < ke_b) {                                       \
+                *out++ = less(b[k], a[i]) ? b[k++] : a[i++];                   \
+            }                                                                  \
+            while (i < ie) {                                                   \
+                *out++ = a[i++];                                               \
+            }                                                                  \
+            while (k < ke_b) {                                                 \
+                *out++ = b[k++];                                               \
+            }                                                                  \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    static inline void sc_array_sort_parallel_##name(T *arr, uint32_t threads, \
+                                                     size_t min)               \
+    {                                                                          \
+        const size_t n = sc_array_size(arr);                                   \
+        size_t parts = threads, rounds = 0;                                    \
+        size_t bounds[SC_ARRAY_THREADS_MAX + 1];                               \
+        struct sc_array_job_##name jobs[SC_ARRAY_THREADS_MAX];                 \
+        T *buf = NULL, *src, *dst, *tmp;                                       \
+                                                                               \
+        min = min == 0 ? SC_ARRAY_PARALLEL_MIN : min;                          \
+        parts = parts < n / min ? parts : n / min;                             \
+        parts = parts < SC_ARRAY_THREADS_MAX ? parts : SC_ARRAY_THREADS_MAX;   \
+                                                                               \
+        if (parts > 1 && n <= SIZE_MAX / sizeof(T)) {                          \
+            buf = sc_array_realloc(NULL, n * sizeof(T));                       \
+        }                                                                      \
+                                                                               \
+        if (buf == NULL) {                                                     \
+            sc_array_sort_##name(arr);                                         \
+            return;                                                            \
+        }                                                                      \
+                                                                               \
+        for (size_t w = 1; w < parts; w *= 2) {                                \
+            rounds++;                                                          \
+        }                                                                      \
+                                                                               \
+        for (size_t i = 0; i <= parts; i++) {                                  \
+            bounds[i] = (size_t) ((uint64_t) n * i / parts);                   \
+        }                                                                      \
+                                                                               \
+        /* Start from the buffer if rounds are odd, so they end in 'arr'. */   \
+        src = (rounds % 2) ? buf : arr;                                        \
+        dst = (rounds % 2) ? arr : buf;                                        \
+                                                                               \
+        for (size_t i = 0; i < parts; i++) {                                   \
+            jobs[i] = (struct sc_array_job_##name){                            \
+                    .src = arr,                                                \
+                    .dst = (rounds % 2) ? buf : NULL,                          \
+                    .bounds = bounds,                                          \
+                    .n = n,                                                    \
+                    .parts = parts,                                            \
+                    .part = i,                                                 \
+            };                                                                 \
+        }                                                                      \
+        sc_array_run(sc_array_psort_##name, jobs, sizeof(*jobs), parts);       \
+                                                                               \
+        for (size_t w = 1; w < parts; w *= 2) {                                \
+            for (size_t i = 0; i < parts; i++) {                               \
+                jobs[i].src = src;                                             \
+                jobs[i].dst = dst;                                             \
+                jobs[i].width = w;                                             \
+            }                                                                  \
+            sc_array_run(sc_array_pmerge_##name, jobs, sizeof(*jobs), parts);  \
+                                                                               \
+            tmp = src;                                                         \
+            src = dst;                                                         \
+            dst = tmp;                                                         \
+        }                                                                      \
+                                                                               \
+        sc_array_free(buf);                                                    \
+    }
+
+/**
+ * Keys for sc_array_radix_of(). Signed integers have their sign bit flipped,
+ * floats have all bits flipped if negative and the sign bit flipped otherwise,
+ * so unsigned order of keys is the numeric order. -0.0 goes before 0.0, NaNs
+ * go to the ends depending on their sign bit.
+ */
+static inline uint32_t sc_array_key_i32(int32_t v)
+{
+    return (uint32_t) v ^ UINT32_C(0x80000000);
+}
+
+static inline uint64_t sc_array_key_i64(int64_t v)
+{
+    return (uint64_t) v ^ UINT64_C(0x8000000000000000);
+}
+
+static inline uint32_t sc_array_key_f32(float v)
+{
+    uint32_t u;
+
+    memcpy(&u, &v, sizeof(u));
+    return u ^ ((uint32_t) -(int32_t)(u >> 31u) | UINT32_C(0x80000000));
+}
+
+static inline uint64_t sc_array_key_f64(double v)
+{
+    uint64_t u;
+
+    memcpy(&u, &v, sizeof(u));
+    return u ^ ((uint64_t) -(int64_t)(u >> 63u) | UINT64_C(0x8000000000000000));
+}
+
+#define sc_array_radix_of(name, T, K, key)                                     \
+    static inline bool sc_array_radix_##name(T *arr)                           \
+    {                                                                          \
+        const size_t n = sc_array_size(arr);                                   \
+        size_t count[sizeof(K)][256] = {{0}};                                  \
+        size_t sum, c, bytes;                                                  \
+        unsigned int b;                                                        \
+        K k;                                                                   \
+        T *buf, *src = arr, *dst, *tmp;                                        \
+                                                                               \
+        if (n < 2) {                                                           \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        if (n > SIZE_MAX / sizeof(T)) {                                        \
+            sc_array_on_error("Max capacity(%zu) has been reached. ", n);      \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        bytes = n * sizeof(T);                                                 \
+        buf = sc_array_realloc(NULL, bytes);                                   \
+        if (buf == NULL) {                                                     \
+            sc_array_on_error("Failed to allocate %zu bytes. ", bytes);        \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        /* Histograms of all bytes in one pass. */                             \
+        for (size_t i = 0; i < n; i++) {                                       \
+            k = key(arr[i]);                                                   \
+            for (size_t d = 0; d < sizeof(K); d++) {                           \
+                count[d][(k >> (d * 8)) & 0xffu]++;                            \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        dst = buf;                                                             \
+        for (size_t d = 0; d < sizeof(K); d++) {                               \
+            b = (unsigned int) ((key(src[0]) >> (d * 8)) & 0xffu);             \
+            if (count[d][b] == n) {                                            \
+                continue;                                                      \
+            }                                                                  \
+                                                                               \
+            sum = 0;                                                           \
+            for (b = 0; b < 256; b++) {                                        \
+                c = count[d][b];                                               \
+                count[d][b] = sum;                                             \
+                sum += c;                                                      \
+            }                                                                  \
+                                                                               \
+            for (size_t i = 0; i < n; i++) {                                   \
+                b = (unsigned int) ((key(src[i]) >> (d * 8)) & 0xffu);         \
+                dst[count[d][b]++] = src[i];                                   \
+            }                                                                  \
+                                                                               \
+            tmp = src;                                                         \
+            src = dst;                                                         \
+            dst = tmp;                                                         \
+        }                                                                      \
+                                                                               \
+        if (src != arr) {                                                      \
+            memcpy(arr, src, bytes);                                           \
+        }                                                                      \
+                                                                               \
+        sc_array_free(buf);                                                    \
+        return true;                                                           \
+    }
+
+/**
+ * Sorted arrays as sets and maps. An array sorted by sc_array_sort_##name()
+ * with unique elements is a set, an array of key value structs compared by
+ * key is a map, probe with a struct that has only the key filled.
+ *
+ * sc_array_set_of(name, T, less) :
+ *
+ * Must come after sc_array_sort_of() with the same 'name', 'T' and 'less'.
+ * Two elements are equal if neither is less than the other. Defines :
+ *
+ * void   sc_array_unique_##name(arr)       : Sorts and removes duplicates,
+ *                                            keeps one of equal elements.
+ * size_t sc_array_lower_bound_##name(arr,v): Index of the first element not
+ *                                            less than 'v', size if none.
+ *                                            Branchless binary search.
+ * size_t sc_array_bsearch_##name(arr, v)   : Index of 'v' or SIZE_MAX.
+ *
+ * bool sc_array_union_##name(dst, a, b)     : Appends elements of sets 'a'
+ * bool sc_array_intersect_##name(dst, a, b)   and 'b' to '*dst' in order,
+ * bool sc_array_difference_##name(dst, a, b)  in linear time. Difference is
+ *                                             'a' minus 'b'. 'dst' must not
+ *                                             be 'a' or 'b'. Returns false on
+ *                                             out of memory, '*dst' is not
+ *                                             modified then.
+ *
+ * bool   sc_array_eytzinger_##name(dst, a)     : Copies sorted 'a' to '*dst'
+ *                                                in Eytzinger (BFS) order,
+ *                                                '*dst' gets size(a) + 1
+ *                                                elements, index 0 is unused,
+ *                                                or none if 'a' is empty.
+ *                                                Previous contents of '*dst'
+ *                                                are discarded.
+ * size_t sc_array_eytzinger_find_##name(e, v)  : Index in 'e' of the first
+ *                                                element not less than 'v',
+ *                                                0 if none.
+ *
+ * Binary search jumps across the array and each step is a likely cache miss
+ * on large arrays. Eytzinger order keeps the top of the search tree packed at
+ * the start of the array and the next levels are prefetched, so it is faster
+ * for arrays that do not fit in cache.
+ */
+static inline size_t sc_array_ffs(size_t x)
+{
+#if defined(_MSC_VER) && defined(_WIN64)
+    unsigned long r;
+
+    _BitScanForward64(&r, x);
+    return (size_t) r + 1;
+#elif defined(_MSC_VER)
+    unsigned long r;
+
+    _BitScanForward(&r, x);
+    return (size_t) r + 1;
+#else
+    return (size_t) __builtin_ctzll((unsigned long long) x) + 1;
+#endif
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+    #define sc_array_prefetch(p) __builtin_prefetch(p)
+#else
+    #define sc_array_prefetch(p)
+#endif
+
+#define sc_array_set_of(name, T, less)                                         \
+    static inline void sc_array_unique_##name(T *arr)                          \
+    {                                                                          \
+        const size_t n = sc_array_size(arr);                                   \
+        size_t w = 1;                                                          \
+                                                                               \
+        if (n < 2) {                                                           \
+            return;                                                            \
+        }                                                                      \
+                                                                               \
+        sc_array_sort_##name(arr);                                             \
+        for (size_t i = 1; i < n; i++) {                                       \
+            if (less(arr[w - 1], arr[i])) {                                    \
+                arr[w++] = arr[i];                                             \
+            }                                                                  \
+        }                                                                      \
+        sc_array_meta(arr)->size = w;                                          \
+    }                                                                          \
+                                                                               \
+    static inline size_t sc_array_lower_bound_##name(const T *arr, T v)        \
+    {                                                                          \
+        size_t lo = 0, half, n = sc_array_size(arr);                           \
+                                                                               \
+        while (n > 1) {                                                        \
+            half = n / 2;                                                      \
+            lo = less(arr[lo + half - 1], v) ? lo + half : lo;                 \
+            n -= half;                                                         \
+        }                                                                      \
+                                                                               \
+        return lo + (n == 1 && less(arr[lo], v));                              \
+    }                                                                          \
+                                                                               \
+    static inline size_t sc_array_bsearch_##name(const T *arr, T v)            \
+    {                                                                          \
+        size_t i = sc_array_lower_bound_##name(arr, v);                        \
+                                                                               \
+        if (i < sc_array_size(arr) && !less(v, arr[i])) {                      \
+            return i;                                                          \
+        }                                                                      \
+                                                                               \
+        return SIZE_MAX;                                                       \
+    }                                                                          \
+                                                                               \
+    static inline bool sc_array_merge_##name(T **dst, const T *a, const T *b,  \
+                                             int op)                           \
+    {                                                                          \
+        const size_t na = sc_array_size(a), nb = sc_array_size(b);             \
+        size_t i = 0, j = 0, n = sc_array_size(*dst), room;                    \
+        T *d;                                                                  \
+                                                                               \
+        room = op == 0 ? na + nb : op == 1 ? (na < nb ? na : nb) : na;         \
+        if (room == 0) {                                                       \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        if (!sc_array_reserve(*dst, n + room)) {                               \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        d = *dst;                                                              \
+        while (i < na && j < nb) {                                             \
+            if (less(a[i], b[j])) {                                            \
+                if (op != 1) {                                                 \
+                    d[n++] = a[i];                                             \
+                }                                                              \
+                i++;                                                           \
+            } else if (less(b[j], a[i])) {                                     \
+                if (op == 0) {                                                 \
+                    d[n++] = b[j];                                             \
+                }                                                              \
+                j++;                                                           \
+            } else {                                                           \
+                if (op != 2) {                                                 \
+                    d[n++] = a[i];                                             \
+                }                                                              \
+                i++;                                                           \
+                j++;                                                           \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        for (; op != 1 && i < na; i++) {                                       \
+            d[n++] = a[i];                                                     \
+        }                                                                      \
+                                                                               \
+        for (; op == 0 && j < nb; j++) {                                       \
+            d[n++] = b[j];                                                     \
+        }                                                                      \
+                                                                               \
+        sc_array_meta(d)->size = n;                                            \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    static inline bool sc_array_union_##name(T **dst, const T *a, const T *b)  \
+    {                                                                          \
+        return sc_array_merge_##name(dst, a, b, 0);                            \
+    }                                                                          \
+                                                                               \
+    static inline bool sc_array_intersect_##name(T **dst, const T *a,          \
+                                                 const T *b)                   \
+    {                                                                          \
+        return sc_array_merge_##name(dst, a, b, 1);                            \
+    }                                                                          \
+                                                                               \
+    static inline bool sc_array_difference_##name(T **dst, const T *a,         \
+                                                  const T *b)                  \
+    {                                                                          \
+        return sc_array_merge_##name(dst, a, b, 2);                            \
+    }                                                                          \
+                                                                               \
+    static inline size_t sc_array_eyt_fill_##name(T *e, const T *a, size_t i,  \
+                                                  size_t k, size_t n)          \
+    {                                                                          \
+        if (k <= n) {                                                          \
+            i = sc_array_eyt_fill_##name(e, a, i, 2 * k, n);                   \
+            e[k] = a[i++];                                                     \
+            i = sc_array_eyt_fill_##name(e, a, i, 2 * k + 1, n);               \
+        }                                                                      \
+                                                                               \
+        return i;                                                              \
+    }                                                                          \
+                                                                               \
+    static inline bool sc_array_eytzinger_##name(T **dst, const T *a)          \
+    {                                                                          \
+        const size_t n = sc_array_size(a);                                     \
+                                                                               \
+        if (n == 0) {                                                          \
+            if (sc_array_size(*dst) > 0) {                                     \
+                sc_array_clear(*dst);                                          \
+            }                                                                  \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        if (!sc_array_reserve(*dst, n + 1)) {                                  \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        sc_array_meta(*dst)->size = n + 1;                                     \
+                                                                               \
+        (*dst)[0] = a[0];                                                      \
+        sc_array_eyt_fill_##name(*dst, a, 0, 1, n);                            \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    static inline size_t sc_array_eytzinger_find_##name(const T *e, T v)       \
+    {                                                                          \
+        const size_t n = sc_array_size(e) - (sc_array_size(e) > 0);            \
+        const size_t ahead = sizeof(T) < 64 ? 64 / sizeof(T) : 1;              \
+        size_t k = 1;                                                          \
+                                                                               \
+        while (k <= n) {                                                       \
+            sc_array_prefetch(e + k * ahead);                                  \
+            k = 2 * k + less(e[k], v);                                         \
+        }                                                                      \
+                                                                               \
+        return k >> sc_array_ffs(~k);                                          \
+    }
+
 /**
  *  @param arr   Array Pointer
  *  @param value Value
@@ -189,4 +968,316 @@ bool sc_array_expand(void **arr, size_t elem_size);
 #define sc_array_last(arr)                                                     \
     assert(sc_array_size(arr) > 0), (arr)[sc_array_size(arr) - 1]
 
+/**
+ * Scans over int32_t, uint64_t and double arrays, vectorized with AVX2 (if
+ * the CPU has it), SSE2 or NEON, scalar otherwise.
+ *
+ * sc_array_find_*()   : Index of the first element equal to 'v' or SIZE_MAX.
+ * sc_array_count_*()  : Number of elements equal to 'v'.
+ * sc_array_minmax_*() : Writes min and max elements, false if array is empty.
+ *                       Result is unspecified if the array has NaNs.
+ * sc_array_sum_*()    : Sum of elements. i32 sums into int64_t, u64 wraps
+ *                       around. f64 adds in a different order than a loop
+ *                       does, so the result may differ in the last bits.
+ * sc_array_filter_*() : Appends elements in [lo, hi] to 'dst' in order,
+ *                       'dst' and 'src' must be different arrays. Returns
+ *                       false on out of memory, 'dst' may have some of the
+ *                       elements appended then.
+ */
+size_t sc_array_find_i32(const int32_t *arr, int32_t v);
+size_t sc_array_count_i32(const int32_t *arr, int32_t v);
+bool sc_array_minmax_i32(const int32_t *arr, int32_t *min, int32_t *max);
+int64_t sc_array_sum_i32(const int32_t *arr);
+bool sc_array_filter_i32(int32_t **dst, const int32_t *src, int32_t lo,
+                         int32_t hi);
+
+size_t sc_array_find_u64(const uint64_t *arr, uint64_t v);
+size_t sc_array_count_u64(const uint64_t *arr, uint64_t v);
+bool sc_array_minmax_u64(const uint64_t *arr, uint64_t *min, uint64_t *max);
+uint64_t sc_array_sum_u64(const uint64_t *arr);
+bool sc_array_filter_u64(uint64_t **dst, const uint64_t *src, uint64_t lo,
+                         uint64_t hi);
+
+size_t sc_array_find_f64(const double *arr, double v);
+size_t sc_array_count_f64(const double *arr, double v);
+bool sc_array_minmax_f64(const double *arr, double *min, double *max);
+double sc_array_sum_f64(const double *arr);
+bool sc_array_filter_f64(double **dst, const double *src, double lo,
+                         double hi);
+
+/**
+ * Segmented array. Elements live in chunks whose sizes are powers of two,
+ * chunk 'k' holds 'first << k' elements. Growing allocates the next chunk
+ * and nothing is copied, so element addresses are stable until the element
+ * is removed. Index lookup is O(1), a bit scan and two loads.
+ *
+ *      struct sc_array_seg events;
+ *
+ *      sc_array_seg_init(&events, sizeof(struct event), 1024);
+ *
+ *      struct event *e = sc_array_seg_push(&events);
+ *      if (e == NULL) {
+ *          // out of memory
+ *      }
+ *      e->id = 3;
+ *      ...
+ *      e = sc_array_seg_at(&events, 0);
+ *      sc_array_seg_term(&events);
+ */
+#define SC_ARRAY_SEG_CHUNKS (sizeof(size_t) * 8)
+
+struct sc_array_seg
+{
+    size_t elem_size;
+    size_t size;
+    size_t cap;
+    size_t shift;  // log2 of the first chunk size
+    size_t chunks; // allocated chunk count
+    unsigned char *chunk[SC_ARRAY_SEG_CHUNKS];
+};
+
+/**
+ * @param s          Segmented array
+ * @param elem_size  Element size
+ * @param first      First chunk size, rounded up to a power of two. No memory
+ *                   is allocated until the first push.
+ * @return           'false' if 'first' or 'elem_size' is zero or too large
+ */
+bool sc_array_seg_init(struct sc_array_seg *s, size_t elem_size, size_t first);
+
+/**
+ * Frees all chunks.
+ * @param s Segmented array
+ */
+void sc_array_seg_term(struct sc_array_seg *s);
+
+/**
+ * Appends an uninitialized element, allocates a new chunk if the last one is
+ * full.
+ *
+ * @param s Segmented array
+ * @return  Element address, 'NULL' on out of memory
+ */
+void *sc_array_seg_push(struct sc_array_seg *s);
+
+/**
+ * Removes elements past 'n', does nothing if 'n' is not less than size.
+ * Chunks are kept, call sc_array_seg_trim() to free them.
+ *
+ * @param s Segmented array
+ * @param n New size
+ */
+void sc_array_seg_truncate(struct sc_array_seg *s, size_t n);
+
+/**
+ * Frees trailing chunks that hold no elements.
+ * @param s Segmented array
+ */
+void sc_array_seg_trim(struct sc_array_seg *s);
+
+/**
+ * @param s Segmented array
+ * @return  Element count
+ */
+#define sc_array_seg_size(s) ((s)->size)
+
+static inline size_t sc_array_seg_log2(size_t x)
+{
+#if defined(_MSC_VER) && defined(_WIN64)
+    unsigned long r;
+
+    _BitScanReverse64(&r, x);
+    return r;
+#elif defined(_MSC_VER)
+    unsigned long r;
+
+    _BitScanReverse(&r, x);
+    return r;
+#else
+    return (sizeof(unsigned long long) * 8 - 1) -
+           (size_t) __builtin_clzll((unsigned long long) x);
+#endif
+}
+
+/**
+ * @param s Segmented array
+ * @param i Index, if out of range, result is undefined
+ * @return  Element address
+ */
+static inline void *sc_array_seg_at(const struct sc_array_seg *s, size_t i)
+{
+    const size_t j = i + ((size_t) 1 << s->shift);
+    const size_t b = sc_array_seg_log2(j);
+
+    assert(i < s->size);
+    return s->chunk[b - s->shift] + (j - ((size_t) 1 << b)) * s->elem_size;
+}
+
+/**
+ * Struct of arrays. Stores each field in its own contiguous column so scans
+ * over a field touch only that field's memory. Columns share size and
+ * capacity and live in a single allocation, each starts on a 64 byte boundary.
+ *
+ * Fields are given as a list macro, X(type, name) for each field :
+ *
+ *      #define trade_fields(X)                                                \
+ *          X(uint64_t, time)                                                  \
+ *          X(double, price)                                                   \
+ *          X(uint32_t, qty)
+ *
+ *      sc_soa_of(trade, trade_fields)
+ *
+ *      struct sc_soa_trade t;
+ *      struct sc_soa_trade_row r = {.time = 1, .price = 3.5, .qty = 10};
+ *
+ *      sc_soa_trade_init(&t, 0);
+ *      sc_soa_trade_add(&t, r);
+ *
+ *      for (size_t i = 0; i < t.size; i++) {
+ *          sum += t.price[i];
+ *      }
+ *
+ *      sc_soa_trade_term(&t);
+ *
+ * Defines struct sc_soa_##name with 'size', 'cap' and a typed column pointer
+ * per field, struct sc_soa_##name##_row with one member per field and :
+ *
+ * bool init(s, cap)         : 'false' on out of memory, no allocation if 0.
+ * void term(s)              : Frees columns.
+ * bool reserve(s, cap)      : Grows capacity to at least 'cap' rows.
+ * bool add(s, row)          : Appends a row, 'false' on out of memory.
+ * row  get(s, i)            : Gathers row 'i' from the columns.
+ * void set(s, i, row)       : Scatters 'row' to row 'i'.
+ * void remove_unordered(s,i): Moves the last row to 'i'.
+ * void clear(s)             : Removes all rows, keeps memory.
+ *
+ * Column pointers change when the container grows.
+ */
+#define SC_SOA_ALIGN 64
+
+#define sc_soa_round(n) (((n) + SC_SOA_ALIGN - 1) & ~(size_t) (SC_SOA_ALIGN - 1))
+
+#define sc_soa_member(T, f) T f;
+#define sc_soa_column(T, f) T *f;
+#define sc_soa_bytes(T, f)  bytes += sc_soa_round(sizeof(T) * cap);
+#define sc_soa_get(T, f)    row.f = s->f[i];
+#define sc_soa_set(T, f)    s->f[i] = row.f;
+#define sc_soa_last(T, f)   s->f[i] = s->f[s->size - 1];
+#define sc_soa_move(T, f)                                                      \
+    next.f = (T *) p;                                                          \
+    if (s->size > 0) {                                                         \
+        memcpy(next.f, s->f, s->size * sizeof(T));                             \
+    }                                                                          \
+    p += sc_soa_round(sizeof(T) * cap);
+
+#define sc_soa_of(name, fields)                                                \
+    struct sc_soa_##name##_row                                                 \
+    {                                                                          \
+        fields(sc_soa_member)                                                  \
+    };                                                                         \
+                                                                               \
+    struct sc_soa_##name                                                       \
+    {                                                                          \
+        size_t size;                                                           \
+        size_t cap;                                                            \
+        void *mem;                                                             \
+        fields(sc_soa_column)                                                  \
+    };                                                                         \
+                                                                               \
+    static inline bool sc_soa_##name##_reserve(struct sc_soa_##name *s,        \
+                                               size_t cap)                     \
+    {                                                                          \
+        const size_t max = SIZE_MAX / 2 / sizeof(struct sc_soa_##name##_row);  \
+        struct sc_soa_##name next = *s;                                        \
+        size_t bytes = SC_SOA_ALIGN;                                           \
+        char *p;                                                               \
+                                                                               \
+        if (cap <= s->cap) {                                                   \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        if (cap > max) {                                                       \
+            sc_array_on_error("Max capacity(%zu) has been reached. ", max);    \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        fields(sc_soa_bytes);                                                  \
+                                                                               \
+        next.mem = sc_array_realloc(NULL, bytes);                              \
+        if (next.mem == NULL) {                                                \
+            sc_array_on_error("Failed to allocate %zu bytes. ", bytes);        \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        p = (char *) next.mem;                                                 \
+        p += (SC_SOA_ALIGN - (uintptr_t) p % SC_SOA_ALIGN) % SC_SOA_ALIGN;     \
+        fields(sc_soa_move);                                                   \
+                                                                               \
+        sc_array_free(s->mem);                                                 \
+        next.cap = cap;                                                        \
+        *s = next;                                                             \
+                                                                               \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    static inline bool sc_soa_##name##_init(struct sc_soa_##name *s,           \
+                                            size_t cap)                        \
+    {                                                                          \
+        *s = (struct sc_soa_##name){0};                                        \
+        return sc_soa_##name##_reserve(s, cap);                                \
+    }                                                                          \
+                                                                               \
+    static inline void sc_soa_##name##_term(struct sc_soa_##name *s)           \
+    {                                                                          \
+        sc_array_free(s->mem);                                                 \
+        *s = (struct sc_soa_##name){0};                                        \
+    }                                                                          \
+                                                                               \
+    static inline bool sc_soa_##name##_add(struct sc_soa_##name *s,            \
+                                           struct sc_soa_##name##_row row)     \
+    {                                                                          \
+        const size_t i = s->size;                                              \
+                                                                               \
+        if (s->size == s->cap &&                                               \
+            !sc_soa_##name##_reserve(s, s->cap != 0 ? s->cap * 2 : 8)) {       \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        fields(sc_soa_set);                                                    \
+        s->size++;                                                             \
+                                                                               \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    static inline struct sc_soa_##name##_row sc_soa_##name##_get(              \
+            const struct sc_soa_##name *s, size_t i)                           \
+    {                                                                          \
+        struct sc_soa_##name##_row row;                                        \
+                                                                               \
+        assert(i < s->size);                                                   \
+        fields(sc_soa_get);                                                    \
+                                                                               \
+        return row;                                                            \
+    }                                                                          \
+                                                                               \
+    static inline void sc_soa_##name##_set(struct sc_soa_##name *s, size_t i,  \
+                                           struct sc_soa_##name##_row row)     \
+    {                                                                          \
+        assert(i < s->size);                                                   \
+        fields(sc_soa_set);                                                    \
+    }                                                                          \
+                                                                               \
+    static inline void sc_soa_##name##_remove_unordered(                       \
+            struct sc_soa_##name *s, size_t i)                                 \
+    {                                                                          \
+        assert(i < s->size);                                                   \
+        fields(sc_soa_last);                                                   \
+        s->size--;                                                             \
+    }                                                                          \
+                                                                               \
+    static inline void sc_soa_##name##_clear(struct sc_soa_##name *s)          \
+    {                                                                          \
+        s->size = 0;                                                           \
+    }
+
 #endif
@@ -0,0 +1,746 @@
+#include "sc_cmap.h"
+#include "sc_fmap.h"
+#include "sc_lfmap.h"
+#include "sc_map.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_CAP (1u << 22u)
+
+static uint64_t time_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+static uint64_t rand64(uint64_t *state)
+{
+    uint64_t x = *state;
+
+    x ^= x << 13u;
+    x ^= x >> 7u;
+    x ^= x << 17u;
+    *state = x;
+
+    return x;
+}
+
+static uint64_t *keys_create(uint32_t n, uint64_t seed)
+{
+    uint64_t *keys = malloc(sizeof(*keys) * n);
+
+    for (uint32_t i = 0; i < n; i++) {
+        keys[i] = rand64(&seed) | 1u;
+    }
+
+    return keys;
+}
+
+#define bench_get(name, lf)                                                    \
+    do {                                                                       \
+        struct sc_map_##name map;                                              \
+        uint64_t *keys, *miss, start, hit_ns, miss_ns, sum = 0;                \
+        uint32_t n;                                                            \
+        void *v;                                                               \
+                                                                               \
+        sc_map_init_##name(&map, BENCH_CAP, lf);                               \
+        n = map.remap - 1;                                                     \
+        keys = keys_create(n, 0x2545F4914F6CDD1Dull);                          \
+        miss = keys_create(n, 0x9E3779B97F4A7C15ull);                          \
+                                                                               \
+        for (uint32_t i = 0; i < n; i++) {                                     \
+            sc_map_put_##name(&map, keys[i], (void *) (uintptr_t) i);          \
+        }                                                                      \
+                                                                               \
+        start = time_ns();                                                     \
+        for (uint32_t i = 0; i < n; i++) {                                     \
+            sum += sc_map_get_##name(&map, keys[i], &v);                       \
+        }                                                                      \
+        hit_ns = time_ns() - start;                                            \
+                                                                               \
+        start = time_ns();                                                     \
+        for (uint32_t i = 0; i < n; i++) {                                     \
+            sum += sc_map_get_##name(&map, miss[i], &v);                       \
+        }                                                                      \
+        miss_ns = time_ns() - start;                                           \
+                                                                               \
+        printf("%-8s load %u%%  cap %-8u hit %6.2f ns/op  "                    \
+               "miss %6.2f ns/op  (%llu)\n",                                   \
+               #name, lf, map.cap, (double) hit_ns / n,                        \
+               (double) miss_ns / n, (unsigned long long) sum);                \
+                                                                               \
+        free(keys);                                                            \
+        free(miss);                                                            \
+        sc_map_term_##name(&map);                                              \
+    } while (0)
+
+static void bench_swiss(void)
+{
+    const uint32_t factors[] = {75, 85, 90, 95};
+
+    printf("\nLinear probing vs. swiss table lookups \n\n");
+
+    for (size_t i = 0; i < sizeof(factors) / sizeof(factors[0]); i++) {
+        bench_get(64v, factors[i]);
+        bench_get(sw64v, factors[i]);
+    }
+}
+
+static void bench_robin(void)
+{
+    const uint32_t factors[] = {50, 75, 85, 90, 95};
+
+    printf("\nLinear probing vs. robin hood, hit and miss lookups \n\n");
+
+    for (size_t i = 0; i < sizeof(factors) / sizeof(factors[0]); i++) {
+        bench_get(64v, factors[i]);
+        bench_get(r64v, factors[i]);
+    }
+}
+
+static void bench_incremental(void)
+{
+    const uint32_t n = 1u << 23u;
+    const uint32_t steps[] = {0, 4, 16};
+    uint64_t start, max, elapsed, total;
+    uint64_t *keys = keys_create(n, 0x2545F4914F6CDD1Dull);
+    struct sc_map_64 map;
+
+    printf("\nPut latency with and without incremental resize \n\n");
+
+    for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); i++) {
+        max = 0;
+        total = 0;
+
+        sc_map_init_64(&map, 0, 0);
+        sc_map_incremental_64(&map, steps[i]);
+
+        for (uint32_t j = 0; j < n; j++) {
+            start = time_ns();
+            sc_map_put_64(&map, keys[j], j);
+            elapsed = time_ns() - start;
+
+            total += elapsed;
+            max = elapsed > max ? elapsed : max;
+        }
+
+        printf("step %-4u puts %u  avg %6.2f ns/op  max %10.2f us \n",
+               steps[i], n, (double) total / n, (double) max / 1000);
+
+        sc_map_term_64(&map);
+    }
+
+    free(keys);
+}
+
+#define BENCH_THREAD_OPS (1u << 21u)
+#define BENCH_KEYS       (1u << 20u)
+
+static struct sc_cmap_64 bench_cmap;
+static struct sc_map_64 bench_map;
+static pthread_mutex_t bench_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * 90% get, 10% put over random keys. 'arg' selects single lock or sharded.
+ */
+static void *bench_worker(void *arg)
+{
+    bool sharded = *(bool *) arg;
+    uint64_t key, value, seed = time_ns() | 1u;
+
+    for (uint32_t i = 0; i < BENCH_THREAD_OPS; i++) {
+        key = (rand64(&seed) % BENCH_KEYS) + 1;
+
+        if (sharded) {
+            if (i % 10 == 0) {
+                sc_cmap_put_64(&bench_cmap, key, i);
+            } else {
+                sc_cmap_get_64(&bench_cmap, key, &value);
+            }
+            continue;
+        }
+
+        pthread_mutex_lock(&bench_mtx);
+        if (i % 10 == 0) {
+            sc_map_put_64(&bench_map, key, i);
+        } else {
+            sc_map_get_64(&bench_map, key, &value);
+        }
+        pthread_mutex_unlock(&bench_mtx);
+    }
+
+    return NULL;
+}
+
+static void bench_cmap_scaling(void)
+{
+    const uint32_t counts[] = {1, 2, 4, 8, 16};
+    pthread_t threads[16];
+    uint64_t start, elapsed;
+
+    printf("\nSingle mutex sc_map vs sharded sc_cmap, 90%% get 10%% put \n\n");
+
+    for (int sharded = 0; sharded < 2; sharded++) {
+        bool arg = sharded;
+
+        for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+            sc_map_init_64(&bench_map, BENCH_KEYS, 0);
+            sc_cmap_init_64(&bench_cmap, 64, BENCH_KEYS, 0);
+
+            start = time_ns();
+            for (uint32_t j = 0; j < counts[i]; j++) {
+                pthread_create(&threads[j], NULL, bench_worker, &arg);
+            }
+            for (uint32_t j = 0; j < counts[i]; j++) {
+                pthread_join(threads[j], NULL);
+            }
+            elapsed = time_ns() - start;
+
+            printf("%-8s threads %-3u %8.2f Mops/s \n",
+                   sharded ? "sc_cmap" : "sc_map", counts[i],
+                   (double) BENCH_THREAD_OPS * counts[i] * 1000 / elapsed);
+
+            sc_map_term_64(&bench_map);
+            sc_cmap_term_64(&bench_cmap);
+        }
+    }
+}
+
+#define bench_batch(name)                                                      \
+    do {                                                                       \
+        struct sc_map_##name map;                                              \
+        const uint32_t n = BENCH_CAP / 2;                                      \
+        uint64_t *keys, *values, start, single_ns, batch_ns, sum = 0;          \
+        bool *found;                                                           \
+                                                                               \
+        sc_map_init_##name(&map, 0, 0);                                        \
+        keys = keys_create(n, 0x2545F4914F6CDD1Dull);                          \
+        values = malloc(sizeof(*values) * n);                                  \
+        found = malloc(sizeof(*found) * n);                                    \
+                                                                               \
+        for (uint32_t i = 0; i < n; i += 2) {                                  \
+            sc_map_put_##name(&map, keys[i], i);                               \
+        }                                                                      \
+                                                                               \
+        start = time_ns();                                                     \
+        for (uint32_t i = 0; i < n; i++) {                                     \
+            sum += sc_map_get_##name(&map, keys[i], &values[i]);               \
+        }                                                                      \
+        single_ns = time_ns() - start;                                         \
+                                                                               \
+        start = time_ns();                                                     \
+        sum += sc_map_get_batch_##name(&map, keys, n, values, found);          \
+        batch_ns = time_ns() - start;                                          \
+                                                                               \
+        printf("%-8s cap %-8u get %6.2f ns/op  batch %6.2f ns/op  (%llu)\n",   \
+               #name, map.cap, (double) single_ns / n,                         \
+               (double) batch_ns / n, (unsigned long long) sum);               \
+                                                                               \
+        free(keys);                                                            \
+        free(values);                                                          \
+        free(found);                                                           \
+        sc_map_term_##name(&map);                                              \
+    } while (0)
+
+static void bench_batch_get(void)
+{
+    printf("\nOne at a time vs batched lookups, 50%% hit \n\n");
+
+    bench_batch(64);
+    bench_batch(sw64);
+}
+
+/**
+ * String keys with sc_str layout, length header followed by the chars.
+ */
+static char **strkeys_create(uint32_t n, uint32_t len)
+{
+    char **keys = malloc(sizeof(*keys) * n);
+    uint64_t seed = 0x2545F4914F6CDD1Dull;
+
+    for (uint32_t i = 0; i < n; i++) {
+        char *mem = malloc(sizeof(len) + len + 1);
+
+        memcpy(mem, &len, sizeof(len));
+        for (uint32_t j = 0; j < len; j++) {
+            mem[sizeof(len) + j] = (char) ('a' + rand64(&seed) % 26);
+        }
+        mem[sizeof(len) + len] = '\0';
+        keys[i] = mem + sizeof(len);
+    }
+
+    return keys;
+}
+
+static void bench_lenkey(void)
+{
+    const uint32_t n = 1u << 20u, lens[] = {8, 32, 128};
+    uint64_t start, str_ns, len_ns, v, sum = 0;
+    struct sc_map_s64 smap;
+    struct sc_map_ls64 lmap;
+
+    printf("\nString keys, strlen/strcmp vs cached length \n\n");
+
+    for (size_t i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+        char **keys = strkeys_create(n, lens[i]);
+
+        sc_map_init_s64(&smap, 0, 0);
+        sc_map_init_ls64(&lmap, 0, 0);
+
+        for (uint32_t j = 0; j < n; j++) {
+            sc_map_put_s64(&smap, keys[j], j);
+            sc_map_put_ls64(&lmap, keys[j], j);
+        }
+
+        start = time_ns();
+        for (uint32_t j = 0; j < n; j++) {
+            sum += sc_map_get_s64(&smap, keys[j], &v);
+        }
+        str_ns = time_ns() - start;
+
+        start = time_ns();
+        for (uint32_t j = 0; j < n; j++) {
+            sum += sc_map_get_ls64(&lmap, keys[j], &v);
+        }
+        len_ns = time_ns() - start;
+
+        printf("key len %-4u s64 %6.2f ns/op  ls64 %6.2f ns/op  (%llu)\n",
+               lens[i], (double) str_ns / n, (double) len_ns / n,
+               (unsigned long long) sum);
+
+        for (uint32_t j = 0; j < n; j++) {
+            free(keys[j] - sizeof(uint32_t));
+        }
+        free(keys);
+        sc_map_term_s64(&smap);
+        sc_map_term_ls64(&lmap);
+    }
+}
+
+static void bench_inline(void)
+{
+    const uint32_t n = 1u << 20u, lens[] = {8, 16, 24, 40};
+    uint64_t start, str_ns, inl_ns, v, sum = 0, seed = 0x9E3779B97F4A7C15ull;
+    char **probe = malloc(sizeof(*probe) * n);
+    struct sc_map_s64 smap;
+    struct sc_map_is64 imap;
+
+    printf("\nString keys, referenced vs inline short keys \n\n");
+
+    for (size_t i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+        char **keys = strkeys_create(n, lens[i]);
+
+        sc_map_init_s64(&smap, 0, 0);
+        sc_map_init_is64(&imap, 0, 0);
+
+        for (uint32_t j = 0; j < n; j++) {
+            sc_map_put_s64(&smap, keys[j], j);
+            sc_map_put_is64(&imap, keys[j], j);
+        }
+
+        // Look up with copies in random order, like keys parsed from input.
+        for (uint32_t j = 0; j < n; j++) {
+            probe[j] = strdup(keys[rand64(&seed) % n]);
+        }
+
+        start = time_ns();
+        for (uint32_t j = 0; j < n; j++) {
+            sum += sc_map_get_s64(&smap, probe[j], &v);
+        }
+        str_ns = time_ns() - start;
+
+        start = time_ns();
+        for (uint32_t j = 0; j < n; j++) {
+            sum += sc_map_get_is64(&imap, probe[j], &v);
+        }
+        inl_ns = time_ns() - start;
+
+        printf("key len %-4u s64 %6.2f ns/op  is64 %6.2f ns/op  (%llu)\n",
+               lens[i], (double) str_ns / n, (double) inl_ns / n,
+               (unsigned long long) sum);
+
+        for (uint32_t j = 0; j < n; j++) {
+            free(keys[j] - sizeof(uint32_t));
+            free(probe[j]);
+        }
+        free(keys);
+        sc_map_term_s64(&smap);
+        sc_map_term_is64(&imap);
+    }
+
+    free(probe);
+}
+
+static void bench_frozen(void)
+{
+    const uint32_t n = 1u << 21u;
+    const char *path = "sc_map_bench.bin";
+    char **keys = strkeys_create(n, 16);
+    uint64_t start, build_ns, open_ns, get_ns, fget_ns[2], v, sum = 0;
+    struct sc_map_s64 map;
+    struct sc_fmap_s64 fmap;
+
+    printf("\nRebuilding sc_map vs opening a frozen image \n\n");
+
+    start = time_ns();
+    sc_map_init_s64(&map, 0, 0);
+    for (uint32_t i = 0; i < n; i++) {
+        sc_map_put_s64(&map, keys[i], i);
+    }
+    build_ns = time_ns() - start;
+
+    sc_fmap_save_s64(&map, path);
+
+    start = time_ns();
+    sc_fmap_open_mmap_s64(&fmap, path);
+    open_ns = time_ns() - start;
+
+    start = time_ns();
+    for (uint32_t i = 0; i < n; i++) {
+        sum += sc_map_get_s64(&map, keys[i], &v);
+    }
+    get_ns = time_ns() - start;
+
+    // First pass maps the pages in, second one runs on mapped pages.
+    for (int pass = 0; pass < 2; pass++) {
+        start = time_ns();
+        for (uint32_t i = 0; i < n; i++) {
+            sum += sc_fmap_get_s64(&fmap, keys[i], &v);
+        }
+        fget_ns[pass] = time_ns() - start;
+    }
+
+    printf("keys %u  build %8.2f ms  open %8.3f ms \n", n,
+           (double) build_ns / 1e6, (double) open_ns / 1e6);
+    printf("get sc_map %6.2f ns/op  sc_fmap first %6.2f ns/op  "
+           "sc_fmap %6.2f ns/op  (%llu) \n",
+           (double) get_ns / n, (double) fget_ns[0] / n,
+           (double) fget_ns[1] / n, (unsigned long long) sum);
+
+    sc_fmap_close_s64(&fmap);
+    sc_map_term_s64(&map);
+    remove(path);
+
+    for (uint32_t i = 0; i < n; i++) {
+        free(keys[i] - sizeof(uint32_t));
+    }
+    free(keys);
+}
+
+static void bench_ordered(void)
+{
+    const uint32_t n = 1u << 20u, keeps[] = {100, 50, 10};
+    uint64_t start, map_ns, ord_ns, k, v, sum = 0, *keys = keys_create(n, 11);
+    struct sc_map_64 map;
+    struct sc_map_o64 omap;
+
+    printf("\nIteration, sc_map_64 vs insertion ordered o64 \n\n");
+
+    for (size_t i = 0; i < sizeof(keeps) / sizeof(keeps[0]); i++) {
+        sc_map_init_64(&map, 0, 0);
+        sc_map_init_o64(&omap, 0, 0);
+
+        for (uint32_t j = 0; j < n; j++) {
+            sc_map_put_64(&map, keys[j], j);
+            sc_map_put_o64(&omap, keys[j], j);
+        }
+
+        // Keep 'keeps[i]' percent of the items
+        for (uint32_t j = 0; j < n; j++) {
+            if (j % 100 >= keeps[i]) {
+                sc_map_del_64(&map, keys[j], &v);
+                sc_map_del_o64(&omap, keys[j], &v);
+            }
+        }
+
+        start = time_ns();
+        for (int r = 0; r < 10; r++) {
+            sc_map_foreach (&map, k, v) {
+                sum += k ^ v;
+            }
+        }
+        map_ns = time_ns() - start;
+
+        start = time_ns();
+        for (int r = 0; r < 10; r++) {
+            sc_map_foreach (&omap, k, v) {
+                sum += k ^ v;
+            }
+        }
+        ord_ns = time_ns() - start;
+
+        printf("kept %3u%%  64 %6.2f ns/item  o64 %6.2f ns/item  "
+               "mem %6.1f MB vs %6.1f MB (%llu)\n",
+               keeps[i], (double) map_ns / (10.0 * map.size),
+               (double) ord_ns / (10.0 * omap.size),
+               (double) map.cap * sizeof(*map.mem) / (1024 * 1024),
+               ((double) omap.mem_cap * sizeof(*omap.mem) +
+                (double) omap.index_cap * sizeof(*omap.index)) /
+                       (1024 * 1024),
+               (unsigned long long) sum);
+
+        sc_map_term_64(&map);
+        sc_map_term_o64(&omap);
+    }
+
+    free(keys);
+}
+
+/**
+ * Inserts keys into a linear probing table at 75% load, like scalar maps do,
+ * and reports probe lengths of successful lookups. Table is kept small, a bad
+ * hash makes inserts quadratic.
+ */
+#define PROBE_CAP (1u << 16u)
+
+static void probe_report(const char *name, uint32_t (*hash)(uint64_t),
+                         const uint64_t *keys, uint32_t n, uint64_t *slots)
+{
+    const uint32_t cap = PROBE_CAP, mod = cap - 1;
+    uint32_t pos, len, max = 0;
+    uint64_t total = 0, start, sum = 0;
+
+    memset(slots, 0, sizeof(*slots) * cap);
+
+    for (uint32_t i = 0; i < n; i++) {
+        len = 1;
+        pos = hash(keys[i]) & mod;
+        while (slots[pos] != 0) {
+            pos = (pos + 1) & mod;
+            len++;
+        }
+
+        slots[pos] = keys[i];
+        total += len;
+        max = len > max ? len : max;
+    }
+
+    start = time_ns();
+    for (uint32_t i = 0; i < n; i++) {
+        sum += hash(keys[i]);
+    }
+
+    printf("  %-8s avg probe %8.2f  max probe %8u  hash %5.2f ns (%llu)\n",
+           name, (double) total / n, max, (double) (time_ns() - start) / n,
+           (unsigned long long) sum & 1);
+}
+
+static void bench_probe(void)
+{
+    const uint32_t n = PROBE_CAP / 4 * 3;
+    uint64_t seed = 0x9E3779B97F4A7C15ull;
+    uint64_t *keys = malloc(sizeof(*keys) * n);
+    uint64_t *slots = malloc(sizeof(*slots) * PROBE_CAP);
+    const char *dists[] = {"sequential", "stride 64", "stride 2^20",
+                           "hi|lo (i<<32|i)", "random"};
+
+    printf("\nProbe lengths of integer hash functions, %u keys \n", n);
+
+    for (size_t d = 0; d < sizeof(dists) / sizeof(dists[0]); d++) {
+        for (uint64_t i = 0; i < n; i++) {
+            switch (d) {
+            case 0: keys[i] = i + 1; break;
+            case 1: keys[i] = (i + 1) * 64; break;
+            case 2: keys[i] = (i + 1) << 20u; break;
+            case 3: keys[i] = ((i + 1) << 32u) | (i + 1); break;
+            default: keys[i] = rand64(&seed) | 1u; break;
+            }
+        }
+
+        printf("\n%s \n", dists[d]);
+        probe_report("64", sc_map_hash_64, keys, n, slots);
+        probe_report("fmix64", sc_map_hash_fmix64, keys, n, slots);
+        probe_report("wyhash", sc_map_hash_wyhash, keys, n, slots);
+        probe_report("rrmxmx", sc_map_hash_rrmxmx, keys, n, slots);
+    }
+
+    free(keys);
+    free(slots);
+}
+
+static inline bool bench_u64_eq(uint64_t a, uint64_t b)
+{
+    return a == b;
+}
+
+sc_map_of_pod(p64v, uint64_t, void *, sc_map_hash_fmix64, bench_u64_eq)
+
+static void bench_pod(void)
+{
+    struct sc_map_p64v map;
+    uint64_t *keys, *miss, start, hit_ns, miss_ns, sum = 0;
+    uint32_t n;
+    void *v;
+
+    printf("\nBuilt-in maps vs header-only sc_map_of_pod() map \n\n");
+
+    bench_get(64v, 75);
+    bench_get(sw64v, 75);
+
+    // Same table size and item count as bench_get() at 75% load
+    sc_map_init_p64v(&map, BENCH_CAP / 4 * 3 - 1, 75);
+    n = map.remap - 1;
+    keys = keys_create(n, 0x2545F4914F6CDD1Dull);
+    miss = keys_create(n, 0x9E3779B97F4A7C15ull);
+
+    for (uint32_t i = 0; i < n; i++) {
+        sc_map_put_p64v(&map, keys[i], (void *) (uintptr_t) i);
+    }
+
+    start = time_ns();
+    for (uint32_t i = 0; i < n; i++) {
+        sum += sc_map_get_p64v(&map, keys[i], &v);
+    }
+    hit_ns = time_ns() - start;
+
+    start = time_ns();
+    for (uint32_t i = 0; i < n; i++) {
+        sum += sc_map_get_p64v(&map, miss[i], &v);
+    }
+    miss_ns = time_ns() - start;
+
+    printf("%-8s load %u%%  cap %-8u hit %6.2f ns/op  "
+           "miss %6.2f ns/op  (%llu)\n",
+           "p64v", 75, map.cap, (double) hit_ns / n, (double) miss_ns / n,
+           (unsigned long long) sum);
+
+    free(keys);
+    free(miss);
+    sc_map_term_p64v(&map);
+}
+
+static struct sc_lfmap_64 bench_lfmap;
+
+/**
+ * Read only lookups. 'arg' selects lock-free map or sharded map.
+ */
+static void *bench_reader(void *arg)
+{
+    bool lockfree = *(bool *) arg;
+    uint64_t key, value, sum = 0, seed = time_ns() | 1u;
+
+    for (uint32_t i = 0; i < BENCH_THREAD_OPS; i++) {
+        key = (rand64(&seed) % BENCH_KEYS) + 1;
+
+        if (lockfree) {
+            sum += sc_lfmap_get_64(&bench_lfmap, key, &value);
+        } else {
+            sum += sc_cmap_get_64(&bench_cmap, key, &value);
+        }
+    }
+
+    return (void *) (uintptr_t) sum;
+}
+
+static void bench_lfmap_scaling(void)
+{
+    const uint32_t counts[] = {1, 2, 4, 8, 16};
+    pthread_t threads[16];
+    uint64_t start, elapsed;
+
+    printf("\nRead scaling, sharded sc_cmap vs lock-free sc_lfmap \n\n");
+
+    for (int lockfree = 0; lockfree < 2; lockfree++) {
+        bool arg = lockfree;
+
+        sc_cmap_init_64(&bench_cmap, 64, BENCH_KEYS, 0);
+        sc_lfmap_init_64(&bench_lfmap, 0, 0, 0);
+
+        for (uint64_t i = 1; i <= BENCH_KEYS; i++) {
+            sc_cmap_put_64(&bench_cmap, i, i);
+            sc_lfmap_put_64(&bench_lfmap, i, i);
+        }
+
+        for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+            start = time_ns();
+            for (uint32_t j = 0; j < counts[i]; j++) {
+                pthread_create(&threads[j], NULL, bench_reader, &arg);
+            }
+            for (uint32_t j = 0; j < counts[i]; j++) {
+                pthread_join(threads[j], NULL);
+            }
+            elapsed = time_ns() - start;
+
+            printf("%-8s threads %-3u %8.2f Mops/s \n",
+                   lockfree ? "sc_lfmap" : "sc_cmap", counts[i],
+                   (double) BENCH_THREAD_OPS * counts[i] * 1000 / elapsed);
+        }
+
+        sc_cmap_term_64(&bench_cmap);
+        sc_lfmap_term_64(&bench_lfmap);
+    }
+}
+
+static void bench_build(void)
+{
+    const uint32_t n = 1u << 23u;
+    const uint32_t threads[] = {1, 2, 4, 8};
+    uint64_t start, elapsed;
+    uint64_t *keys = keys_create(n, 0x2545F4914F6CDD1Dull);
+    struct sc_map_64 map;
+
+    printf("\nBulk build, put loop vs. sc_map_build() \n\n");
+
+    sc_map_init_64(&map, 0, 0);
+    start = time_ns();
+    for (uint32_t i = 0; i < n; i++) {
+        sc_map_put_64(&map, keys[i], keys[i]);
+    }
+    elapsed = time_ns() - start;
+    printf("put       pairs %u  %8.2f ms  %6.2f ns/op \n", n,
+           (double) elapsed / 1e6, (double) elapsed / n);
+    sc_map_term_64(&map);
+
+    for (size_t i = 0; i < sizeof(threads) / sizeof(threads[0]); i++) {
+        sc_map_init_64(&map, 0, 0);
+        start = time_ns();
+        sc_map_build_64(&map, keys, keys, n, threads[i]);
+        elapsed = time_ns() - start;
+        printf("build %-2u  pairs %u  %8.2f ms  %6.2f ns/op \n", threads[i],
+               n, (double) elapsed / 1e6, (double) elapsed / n);
+        sc_map_term_64(&map);
+    }
+
+    free(keys);
+}
+
+// clang-format off
+static const struct bench
+{
+    const char *name;
+    void (*fn)(void);
+} benches[] = {
+        {"swiss",       bench_swiss       },
+        {"incremental", bench_incremental },
+        {"cmap",        bench_cmap_scaling},
+        {"lfmap",       bench_lfmap_scaling},
+        {"batch",       bench_batch_get   },
+        {"lenkey",      bench_lenkey      },
+        {"inline",      bench_inline      },
+        {"frozen",      bench_frozen      },
+        {"ordered",     bench_ordered     },
+        {"probe",       bench_probe       },
+        {"pod",         bench_pod         },
+        {"robin",       bench_robin       },
+        {"build",       bench_build       },
+};
+// clang-format on
+
+/**
+ * Usage : sc_map_bench [name]   Runs all benchmarks if name is not given.
+ */
+int main(int argc, char *argv[])
+{
+    for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+        if (argc < 2 || strcmp(argv[1], benches[i].name) == 0) {
+            benches[i].fn();
+        }
+    }
+
+    return 0;
+}
@@ -1,3 +1,6 @@
+#include "sc_cmap.h"
+#include "sc_fmap.h"
+#include "sc_lfmap.h"
 #include "sc_map.h"
 
 #include <assert.h>
@@ -425,6 +428,1550 @@ void test4()
     }
 }
 
+void test5()
+{
+    uint64_t key, value;
+    void *v;
+    struct sc_map_sw64 map;
+    struct sc_map_sw64v map64v;
+
+    assert(!sc_map_init_sw64(&map, 0, 24));
+    assert(!sc_map_init_sw64(&map, 0, 96));
+    assert(sc_map_init_sw64(&map, 0, 0));
+    assert(sc_map_size_sw64(&map) == 0);
+    assert(!sc_map_get_sw64(&map, 3, &value));
+    assert(!sc_map_del_sw64(&map, 3, &value));
+    sc_map_clear_sw64(&map);
+
+    sc_map_foreach (&map, key, value) {
+        assert(false);
+    }
+
+    assert(sc_map_put_sw64(&map, 0, 100));
+    assert(sc_map_get_sw64(&map, 0, &value));
+    assert(value == 100);
+    assert(sc_map_size_sw64(&map) == 1);
+    assert(sc_map_del_sw64(&map, 0, &value));
+    assert(value == 100);
+    assert(!sc_map_del_sw64(&map, 0, NULL));
+    assert(sc_map_size_sw64(&map) == 0);
+
+    // Clear while storage is still the shared empty instance
+    struct sc_map_sw64 m;
+
+    sc_map_init_sw64(&m, 0, 0);
+    sc_map_put_sw64(&m, 0, 5);
+    sc_map_clear_sw64(&m);
+    assert(sc_map_size_sw64(&m) == 0);
+    assert(!sc_map_get_sw64(&m, 0, &value));
+    assert(sc_map_put_sw64(&m, 0, 6));
+    sc_map_term_sw64(&m);
+
+    for (uint64_t i = 1; i <= 10000; i++) {
+        assert(sc_map_put_sw64(&map, i, i * 2));
+    }
+
+    assert(sc_map_size_sw64(&map) == 10000);
+    assert(sc_map_put_sw64(&map, 5, 5));
+    assert(sc_map_size_sw64(&map) == 10000);
+    assert(sc_map_get_sw64(&map, 5, &value));
+    assert(value == 5);
+    assert(sc_map_put_sw64(&map, 5, 10));
+
+    for (uint64_t i = 1; i <= 10000; i++) {
+        assert(sc_map_get_sw64(&map, i, &value));
+        assert(value == i * 2);
+    }
+
+    assert(!sc_map_get_sw64(&map, 10001, &value));
+
+    for (uint64_t i = 1; i <= 10000; i += 2) {
+        assert(sc_map_del_sw64(&map, i, &value));
+        assert(value == i * 2);
+        assert(!sc_map_del_sw64(&map, i, NULL));
+    }
+
+    assert(sc_map_size_sw64(&map) == 5000);
+
+    for (uint64_t i = 1; i <= 10000; i++) {
+        assert(sc_map_get_sw64(&map, i, &value) == (i % 2 == 0));
+    }
+
+    uint64_t total = 0;
+    sc_map_foreach (&map, key, value) {
+        assert(key % 2 == 0 && value == key * 2);
+        total++;
+    }
+    assert(total == 5000);
+
+    // Churn on tombstones, table should not grow indefinitely.
+    uint32_t cap = map.cap;
+    for (uint64_t i = 0; i < 100000; i++) {
+        assert(sc_map_put_sw64(&map, 20000 + i, i));
+        assert(sc_map_del_sw64(&map, 20000 + i, NULL));
+    }
+    assert(map.cap == cap);
+    assert(sc_map_size_sw64(&map) == 5000);
+
+    sc_map_clear_sw64(&map);
+    assert(sc_map_size_sw64(&map) == 0);
+    assert(!sc_map_get_sw64(&map, 2, &value));
+    sc_map_term_sw64(&map);
+
+    assert(sc_map_init_sw64v(&map64v, 100, 95));
+    for (uint64_t i = 0; i < 1000; i++) {
+        assert(sc_map_put_sw64v(&map64v, i * 1024, (void *) (uintptr_t) i));
+    }
+    for (uint64_t i = 0; i < 1000; i++) {
+        assert(sc_map_get_sw64v(&map64v, i * 1024, &v));
+        assert(v == (void *) (uintptr_t) i);
+        assert(!sc_map_get_sw64v(&map64v, i * 1024 + 1, &v));
+    }
+    assert(sc_map_size_sw64v(&map64v) == 1000);
+    sc_map_term_sw64v(&map64v);
+}
+
+#define test_incremental_of(name)                                              \
+    static void test_incremental_##name(uint32_t step)                         \
+    {                                                                          \
+        const uint64_t n = 20000;                                              \
+        bool *exists = calloc(n, sizeof(*exists));                             \
+        bool resized = false;                                                  \
+        uint64_t key, value, count, k;                                         \
+        struct sc_map_##name map;                                              \
+                                                                               \
+        assert(sc_map_init_##name(&map, 0, 0));                                \
+        sc_map_incremental_##name(&map, step);                                 \
+                                                                               \
+        for (uint64_t i = 0; i < n * 4; i++) {                                 \
+            k = ((uint64_t) rand()) % n;                                       \
+                                                                               \
+            switch (rand() % 4) {                                              \
+            case 0:                                                            \
+                assert(sc_map_del_##name(&map, k, &value) == exists[k]);       \
+                assert(!exists[k] || value == k * 3);                          \
+                exists[k] = false;                                             \
+                break;                                                         \
+            case 1:                                                            \
+                assert(sc_map_get_##name(&map, k, &value) == exists[k]);       \
+                assert(!exists[k] || value == k * 3);                          \
+                break;                                                         \
+            default:                                                           \
+                assert(sc_map_put_##name(&map, k, k * 3));                     \
+                exists[k] = true;                                              \
+                break;                                                         \
+            }                                                                  \
+                                                                               \
+            if (map.old != NULL && i % 64 == 0) {                              \
+                resized = true;                                                \
+                count = 0;                                                     \
+                sc_map_foreach (&map, key, value) {                            \
+                    assert(exists[key] && value == key * 3);                   \
+                    count++;                                                   \
+                }                                                              \
+                assert(count + exists[0] == sc_map_size_##name(&map));         \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        assert(resized == (step != 0));                                        \
+                                                                               \
+        count = 0;                                                             \
+        for (uint64_t i = 0; i < n; i++) {                                     \
+            assert(sc_map_get_##name(&map, i, &value) == exists[i]);           \
+            count += exists[i];                                                \
+        }                                                                      \
+        assert(count == sc_map_size_##name(&map));                             \
+                                                                               \
+        sc_map_clear_##name(&map);                                             \
+        assert(sc_map_size_##name(&map) == 0);                                 \
+        assert(!sc_map_get_##name(&map, 1, &value));                           \
+        assert(sc_map_put_##name(&map, 1, 1));                                 \
+        sc_map_term_##name(&map);                                              \
+        free(exists);                                                          \
+    }
+
+test_incremental_of(64)
+test_incremental_of(sw64)
+
+void test6()
+{
+    uint32_t steps[] = {0, 1, 2, 16};
+
+    for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); i++) {
+        test_incremental_64(steps[i]);
+        test_incremental_sw64(steps[i]);
+    }
+
+    char *key, *value;
+    char keys[512][16];
+    struct sc_map_str map;
+
+    assert(sc_map_init_str(&map, 0, 0));
+    sc_map_incremental_str(&map, 1);
+
+    for (int i = 0; i < 512; i++) {
+        snprintf(keys[i], sizeof(keys[i]), "key-%d", i);
+        assert(sc_map_put_str(&map, keys[i], keys[i]));
+    }
+
+    for (int i = 0; i < 512; i++) {
+        assert(sc_map_get_str(&map, keys[i], &value));
+        assert(value == keys[i]);
+    }
+
+    int count = 0;
+    sc_map_foreach (&map, key, value) {
+        assert(key == value);
+        count++;
+    }
+    assert(count == 512);
+
+    for (int i = 0; i < 512; i += 2) {
+        assert(sc_map_del_str(&map, keys[i], &value));
+        assert(value == keys[i]);
+    }
+    assert(sc_map_size_str(&map) == 256);
+    sc_map_term_str(&map);
+}
+
+static uint64_t compute_cb(uint64_t key, void *arg)
+{
+    (*(int *) arg)++;
+    return key * 10;
+}
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <pthread.h>
+
+static struct sc_cmap_64 shared;
+
+static void *cmap_worker(void *arg)
+{
+    uint64_t value, id = (uint64_t) (uintptr_t) arg;
+    int calls = 0;
+
+    for (uint64_t i = 0; i < 10000; i++) {
+        uint64_t key = (id * 10000) + i + 1;
+
+        assert(sc_cmap_put_64(&shared, key, key));
+        assert(sc_cmap_get_64(&shared, key, &value));
+        assert(value == key);
+        assert(sc_cmap_compute_64(&shared, i + 1, compute_cb, &calls, &value));
+        assert(value == (i + 1) * 10);
+
+        if (i % 2 == 0) {
+            assert(sc_cmap_del_64(&shared, key, &value));
+            assert(value == key);
+        }
+    }
+
+    return NULL;
+}
+
+static void cmap_thread_test(void)
+{
+    pthread_t threads[4];
+
+    assert(sc_cmap_init_64(&shared, 8, 0, 0));
+
+    for (uintptr_t i = 0; i < 4; i++) {
+        void *arg = (void *) (i + 1);
+        assert(pthread_create(&threads[i], NULL, cmap_worker, arg) == 0);
+    }
+
+    for (int i = 0; i < 4; i++) {
+        assert(pthread_join(threads[i], NULL) == 0);
+    }
+
+    // 4 threads * 5000 keys left + 10000 keys from compute.
+    assert(sc_cmap_size_64(&shared) == 30000);
+    sc_cmap_term_64(&shared);
+}
+#else
+static void cmap_thread_test(void)
+{
+}
+#endif
+
+void test7()
+{
+    int calls = 0;
+    uint64_t key, value, total = 0;
+    char *s;
+    struct sc_cmap_64 map;
+    struct sc_cmap_str strmap;
+
+    assert(!sc_cmap_init_64(&map, 0, 0, 99));
+    assert(sc_cmap_init_64(&map, 0, 0, 0));
+    assert(map.count == 16);
+    assert(((uintptr_t) map.shards % SC_CMAP_CACHE_LINE) == 0);
+    sc_cmap_term_64(&map);
+
+    assert(sc_cmap_init_64(&map, 5, 1000, 0));
+    assert(map.count == 8);
+    assert(sc_cmap_size_64(&map) == 0);
+
+    for (uint64_t i = 0; i < 1000; i++) {
+        assert(sc_cmap_put_64(&map, i, i + 1));
+    }
+    assert(sc_cmap_size_64(&map) == 1000);
+
+    for (uint64_t i = 0; i < 1000; i++) {
+        assert(sc_cmap_get_64(&map, i, &value));
+        assert(value == i + 1);
+    }
+    assert(!sc_cmap_get_64(&map, 1000, &value));
+
+    assert(sc_cmap_compute_64(&map, 5, compute_cb, &calls, &value));
+    assert(value == 6 && calls == 0);
+    assert(sc_cmap_compute_64(&map, 5000, compute_cb, &calls, &value));
+    assert(value == 50000 && calls == 1);
+    assert(sc_cmap_compute_64(&map, 5000, compute_cb, &calls, NULL));
+    assert(calls == 1);
+    assert(sc_cmap_del_64(&map, 5000, &value));
+    assert(value == 50000);
+    assert(!sc_cmap_del_64(&map, 5000, NULL));
+
+    for (uint32_t i = 0; i < map.count; i++) {
+        struct sc_map_64 *m = sc_cmap_lock_64(&map, i);
+        sc_map_foreach (m, key, value) {
+            assert(value == key + 1);
+            total++;
+        }
+        total += m->used;
+        sc_cmap_unlock_64(&map, i);
+    }
+    assert(total == 1000);
+
+    sc_cmap_clear_64(&map);
+    assert(sc_cmap_size_64(&map) == 0);
+    sc_cmap_term_64(&map);
+
+    assert(sc_cmap_init_str(&strmap, 4, 0, 0));
+    assert(sc_cmap_put_str(&strmap, "key", "value"));
+    assert(sc_cmap_put_str(&strmap, NULL, "null"));
+    assert(sc_cmap_get_str(&strmap, "key", &s));
+    assert(strcmp(s, "value") == 0);
+    assert(sc_cmap_get_str(&strmap, NULL, &s));
+    assert(strcmp(s, "null") == 0);
+    assert(sc_cmap_size_str(&strmap) == 2);
+    sc_cmap_term_str(&strmap);
+
+    // Shards are probed with the hash used to pick them
+    struct sc_map_str plain;
+    uint32_t h = sc_map_key_hash_str("key");
+
+    assert(sc_map_key_hash_str(NULL) == 0);
+    assert(sc_map_init_str(&plain, 0, 0));
+    assert(sc_map_put_hash_str(&plain, "key", "value", h));
+    assert(sc_map_put_hash_str(&plain, NULL, "null", 0));
+    assert(sc_map_get_str(&plain, "key", &s));
+    assert(strcmp(s, "value") == 0);
+    assert(sc_map_get_hash_str(&plain, NULL, &s, 0));
+    assert(strcmp(s, "null") == 0);
+    assert(sc_map_del_hash_str(&plain, "key", &s, h));
+    assert(!sc_map_get_hash_str(&plain, "key", &s, h));
+    assert(sc_map_size_str(&plain) == 1);
+    sc_map_term_str(&plain);
+
+    cmap_thread_test();
+}
+
+#if !defined(_WIN32) && !defined(_WIN64)
+static struct sc_lfmap_64 lf_shared;
+static int lf_done;
+
+static void *lfmap_writer(void *arg)
+{
+    uint32_t id = (uint32_t) (uintptr_t) arg;
+    uint64_t value;
+
+    for (uint64_t i = 1; i <= 1500; i++) {
+        uint64_t key = (id * 1500) + i;
+
+        assert(sc_lfmap_put_64(&lf_shared, key, key * 2));
+        assert(sc_lfmap_get_64(&lf_shared, key, &value));
+        assert(value == key * 2);
+
+        if (i % 2 == 0) {
+            assert(sc_lfmap_del_64(&lf_shared, key - 1, &value));
+            assert(value == (key - 1) * 2);
+        }
+
+        if (i % 64 == 0) {
+            sc_lfmap_quiescent_64(&lf_shared, id);
+        }
+    }
+
+    sc_lfmap_offline_64(&lf_shared, id);
+
+    return NULL;
+}
+
+static void *lfmap_reader(void *arg)
+{
+    uint32_t id = (uint32_t) (uintptr_t) arg;
+    uint64_t value;
+
+    while (!__atomic_load_n(&lf_done, __ATOMIC_ACQUIRE)) {
+        for (uint64_t key = 1; key <= 3000; key++) {
+            if (sc_lfmap_get_64(&lf_shared, key, &value)) {
+                assert(value == key * 2);
+            }
+        }
+        sc_lfmap_quiescent_64(&lf_shared, id);
+    }
+
+    sc_lfmap_offline_64(&lf_shared, id);
+
+    return NULL;
+}
+
+static void lfmap_thread_test(void)
+{
+    uint64_t value;
+    pthread_t threads[4];
+
+    assert(sc_lfmap_init_64(&lf_shared, 0, 0, 4));
+
+    for (uintptr_t i = 0; i < 4; i++) {
+        void *(*fn)(void *) = i < 2 ? lfmap_writer : lfmap_reader;
+        assert(pthread_create(&threads[i], NULL, fn, (void *) i) == 0);
+    }
+
+    for (int i = 0; i < 2; i++) {
+        assert(pthread_join(threads[i], NULL) == 0);
+    }
+
+    __atomic_store_n(&lf_done, 1, __ATOMIC_RELEASE);
+
+    for (int i = 2; i < 4; i++) {
+        assert(pthread_join(threads[i], NULL) == 0);
+    }
+
+    assert(sc_lfmap_size_64(&lf_shared) == 1500);
+    for (uint64_t key = 1; key <= 3000; key++) {
+        assert(sc_lfmap_get_64(&lf_shared, key, &value) == (key % 2 == 0));
+    }
+
+    // All threads are offline, retired tables must be freed by now.
+    assert(lf_shared.lf.retired == NULL);
+    sc_lfmap_term_64(&lf_shared);
+}
+#else
+static void lfmap_thread_test(void)
+{
+}
+#endif
+
+void test8()
+{
+    void *ptr;
+    uint64_t value;
+    struct sc_lfmap_64 map;
+    struct sc_lfmap_64v mapv;
+
+    assert(!sc_lfmap_init_64(&map, 0, 99, 1));
+    assert(!sc_lfmap_init_64(&map, 0, 10, 1));
+    assert(sc_lfmap_init_64(&map, 0, 0, 1));
+    assert(map.lf.table->cap == 16);
+
+    // Lookup fields, writer counters and slots are on separate cache lines
+    assert(offsetof(struct sc_lfmap, size) == SC_LFMAP_CACHE_LINE);
+    assert(offsetof(struct sc_lfmap, retired) == 2 * SC_LFMAP_CACHE_LINE);
+    assert(offsetof(struct sc_lfmap_table, claimed) == SC_LFMAP_CACHE_LINE);
+    assert(offsetof(struct sc_lfmap_table, slots) == 2 * SC_LFMAP_CACHE_LINE);
+    assert((uintptr_t) &map.lf % SC_LFMAP_CACHE_LINE == 0);
+    assert((uintptr_t) map.lf.table % SC_LFMAP_CACHE_LINE == 0);
+    assert((uintptr_t) map.lf.threads % SC_LFMAP_CACHE_LINE == 0);
+    assert(!sc_lfmap_get_64(&map, 1, &value));
+    assert(!sc_lfmap_del_64(&map, 1, &value));
+    assert(!sc_lfmap_put_64(&map, 1, SC_LFMAP_VALUE_MAX + 1));
+    assert(!sc_lfmap_put_64(&map, 1, UINT64_MAX));
+
+    // Zero key and boundary values
+    assert(!sc_lfmap_get_64(&map, 0, &value));
+    assert(!sc_lfmap_del_64(&map, 0, &value));
+    assert(sc_lfmap_put_64(&map, 0, 0));
+    assert(sc_lfmap_get_64(&map, 0, &value));
+    assert(value == 0);
+    assert(sc_lfmap_put_64(&map, 1, SC_LFMAP_VALUE_MAX));
+    assert(sc_lfmap_get_64(&map, 1, &value));
+    assert(value == SC_LFMAP_VALUE_MAX);
+    assert(sc_lfmap_size_64(&map) == 2);
+    assert(sc_lfmap_del_64(&map, 0, &value));
+    assert(value == 0);
+    assert(!sc_lfmap_get_64(&map, 0, &value));
+    assert(sc_lfmap_del_64(&map, 1, &value));
+    assert(sc_lfmap_size_64(&map) == 0);
+
+    // Value is optional on del
+    assert(sc_lfmap_put_64(&map, 0, 1));
+    assert(sc_lfmap_put_64(&map, 1, 1));
+    assert(sc_lfmap_del_64(&map, 0, NULL));
+    assert(sc_lfmap_del_64(&map, 1, NULL));
+    assert(!sc_lfmap_del_64(&map, 1, NULL));
+    assert(sc_lfmap_size_64(&map) == 0);
+
+    // Grow through several resizes, tables are retired on promotion
+    for (uint64_t i = 1; i <= 3000; i++) {
+        assert(sc_lfmap_put_64(&map, i, i * 3));
+        assert(sc_lfmap_put_64(&map, i, i));
+    }
+    assert(sc_lfmap_size_64(&map) == 3000);
+
+    for (uint64_t i = 1; i <= 3000; i++) {
+        assert(sc_lfmap_get_64(&map, i, &value));
+        assert(value == i);
+    }
+    assert(!sc_lfmap_get_64(&map, 3001, &value));
+
+    sc_lfmap_quiescent_64(&map, 0);
+    assert(map.lf.retired == NULL);
+
+    // Tombstones are dropped by resize, table doesn't grow
+    for (uint64_t i = 1; i <= 3000; i++) {
+        assert(sc_lfmap_del_64(&map, i, &value));
+        assert(value == i);
+        assert(!sc_lfmap_del_64(&map, i, &value));
+    }
+    assert(sc_lfmap_size_64(&map) == 0);
+
+    for (uint64_t i = 0; i < 100000; i++) {
+        assert(sc_lfmap_put_64(&map, i + 5000, i));
+        assert(sc_lfmap_del_64(&map, i + 5000, &value));
+        assert(value == i);
+    }
+    assert(map.lf.table->cap <= 8192);
+    assert(sc_lfmap_size_64(&map) == 0);
+    sc_lfmap_term_64(&map);
+
+    assert(sc_lfmap_init_64v(&mapv, 100, 50, 1));
+    assert(mapv.lf.table->cap == 128);
+    for (uintptr_t i = 1; i < 1000; i++) {
+        assert(sc_lfmap_put_64v(&mapv, i, (void *) (i * 2)));
+    }
+    for (uintptr_t i = 1; i < 1000; i++) {
+        assert(sc_lfmap_get_64v(&mapv, i, &ptr));
+        assert(ptr == (void *) (i * 2));
+    }
+    assert(sc_lfmap_put_64v(&mapv, 7, NULL));
+    assert(sc_lfmap_get_64v(&mapv, 7, &ptr));
+    assert(ptr == NULL);
+    assert(sc_lfmap_del_64v(&mapv, 7, &ptr));
+    assert(!sc_lfmap_get_64v(&mapv, 7, &ptr));
+    assert(sc_lfmap_size_64v(&mapv) == 998);
+
+    // Pointers with the top bit set are out of range
+    if (sizeof(void *) == 8) {
+        uint64_t tagged = UINT64_C(0xB4) << 56u;
+
+        assert(!sc_lfmap_put_64v(&mapv, 8, (void *) (uintptr_t) tagged));
+        assert(sc_lfmap_put_64v(&mapv, 8, (void *) (uintptr_t) (tagged >> 1u)));
+    }
+
+    sc_lfmap_term_64v(&mapv);
+
+    lfmap_thread_test();
+}
+
+
+#define test_batch_of(name)                                                    \
+    static void test_batch_##name(uint32_t step)                               \
+    {                                                                          \
+        bool found[300];                                                       \
+        uint64_t keys[300], values[300];                                       \
+        struct sc_map_##name map;                                              \
+                                                                               \
+        assert(sc_map_init_##name(&map, 0, 0));                                \
+        sc_map_incremental_##name(&map, step);                                 \
+        assert(sc_map_get_batch_##name(&map, keys, 0, values, found) == 0);    \
+                                                                               \
+        for (uint64_t i = 0; i < 300; i++) {                                   \
+            keys[i] = i;                                                       \
+            values[i] = UINT64_MAX;                                            \
+            if (i % 3 != 0) {                                                  \
+                assert(sc_map_put_##name(&map, i, i * 10));                    \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        assert(sc_map_get_batch_##name(&map, keys, 300, values, found) ==      \
+               200);                                                           \
+        for (uint64_t i = 0; i < 300; i++) {                                   \
+            assert(found[i] == (i % 3 != 0));                                  \
+            assert(values[i] == (found[i] ? i * 10 : UINT64_MAX));             \
+        }                                                                      \
+                                                                               \
+        assert(sc_map_put_##name(&map, 0, 7));                                 \
+        assert(sc_map_get_batch_##name(&map, keys, 1, values, found) == 1);    \
+        assert(found[0] && values[0] == 7);                                    \
+                                                                               \
+        sc_map_term_##name(&map);                                              \
+    }
+
+test_batch_of(64)
+test_batch_of(sw64)
+test_batch_of(o64)
+
+void test9()
+{
+    const uint32_t steps[] = {0, 1, 16};
+    bool found[4];
+    char *keys[4] = {"a", "b", NULL, "d"}, *values[4] = {0};
+    struct sc_map_str map;
+
+    for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); i++) {
+        test_batch_64(steps[i]);
+        test_batch_sw64(steps[i]);
+        test_batch_o64(steps[i]);
+    }
+
+    assert(sc_map_init_str(&map, 0, 0));
+    assert(sc_map_put_str(&map, "a", "1"));
+    assert(sc_map_put_str(&map, "d", "4"));
+    assert(sc_map_get_batch_str(&map, keys, 4, values, found) == 2);
+    assert(found[0] && !found[1] && !found[2] && found[3]);
+    assert(strcmp(values[0], "1") == 0 && strcmp(values[3], "4") == 0);
+    assert(values[1] == NULL && values[2] == NULL);
+
+    assert(sc_map_put_str(&map, NULL, "0"));
+    assert(sc_map_get_batch_str(&map, keys, 4, values, found) == 3);
+    assert(found[2] && strcmp(values[2], "0") == 0);
+    sc_map_term_str(&map);
+}
+
+/**
+ * Creates a string with sc_str layout, length header followed by the chars.
+ */
+static char *lkey_create(const char *s)
+{
+    uint32_t len = (uint32_t) strlen(s);
+    char *mem = malloc(sizeof(len) + len + 1);
+
+    memcpy(mem, &len, sizeof(len));
+    memcpy(mem + sizeof(len), s, len + 1);
+
+    return mem + sizeof(len);
+}
+
+static void lkey_destroy(char *key)
+{
+    free(key - sizeof(uint32_t));
+}
+
+void test10()
+{
+    char *keys[512], *value, *ab, *abc, *abd;
+    uint64_t v;
+    struct sc_map_lstr map;
+    struct sc_map_ls64 map64;
+
+    ab = lkey_create("ab");
+    abc = lkey_create("abc");
+    abd = lkey_create("abd");
+
+    assert(sc_map_init_lstr(&map, 0, 0));
+    assert(sc_map_put_lstr(&map, abc, "abc"));
+    assert(sc_map_get_lstr(&map, abc, &value));
+    assert(strcmp(value, "abc") == 0);
+    assert(!sc_map_get_lstr(&map, ab, &value));
+    assert(!sc_map_get_lstr(&map, abd, &value));
+
+    // Key lookup by content, not by pointer
+    char *copy = lkey_create("abc");
+    assert(sc_map_get_lstr(&map, copy, &value));
+    assert(sc_map_put_lstr(&map, copy, "copy"));
+    assert(sc_map_size_lstr(&map) == 1);
+    assert(sc_map_del_lstr(&map, abc, &value));
+    assert(strcmp(value, "copy") == 0);
+    assert(sc_map_size_lstr(&map) == 0);
+
+    assert(sc_map_put_lstr(&map, NULL, "null"));
+    assert(sc_map_get_lstr(&map, NULL, &value));
+    assert(strcmp(value, "null") == 0);
+    sc_map_term_lstr(&map);
+
+    assert(sc_map_init_ls64(&map64, 0, 0));
+    for (int i = 0; i < 512; i++) {
+        char buf[32];
+
+        snprintf(buf, sizeof(buf), "%d", i);
+        keys[i] = lkey_create(buf);
+        assert(sc_map_put_ls64(&map64, keys[i], i));
+    }
+
+    for (int i = 0; i < 512; i++) {
+        assert(sc_map_get_ls64(&map64, keys[i], &v));
+        assert(v == (uint64_t) i);
+    }
+
+    for (int i = 0; i < 512; i += 2) {
+        assert(sc_map_del_ls64(&map64, keys[i], &v));
+        assert(v == (uint64_t) i);
+    }
+    assert(sc_map_size_ls64(&map64) == 256);
+
+    for (int i = 0; i < 512; i++) {
+        assert(sc_map_get_ls64(&map64, keys[i], &v) == (i % 2 == 1));
+        lkey_destroy(keys[i]);
+    }
+    sc_map_term_ls64(&map64);
+
+    lkey_destroy(ab);
+    lkey_destroy(abc);
+    lkey_destroy(abd);
+    lkey_destroy(copy);
+}
+
+void test11()
+{
+    const uint32_t steps[] = {0, 1};
+    char buf[64], *key, *value, *longkeys[100];
+    uint64_t v, count;
+    struct sc_map_is64 map;
+    struct sc_map_istr smap;
+
+    for (size_t s = 0; s < sizeof(steps) / sizeof(steps[0]); s++) {
+        assert(sc_map_init_is64(&map, 0, 0));
+        sc_map_incremental_is64(&map, steps[s]);
+
+        // A slot is one cache line
+        assert(sizeof(void *) != 8 || sizeof(*map.mem) == 64);
+
+        // Short keys are copied, buffer is reused for each key
+        for (int i = 0; i < 1000; i++) {
+            snprintf(buf, sizeof(buf), "key-%d", i);
+            assert(sc_map_put_is64(&map, buf, i));
+        }
+
+        for (int i = 0; i < 100; i++) {
+            longkeys[i] = malloc(64);
+            snprintf(longkeys[i], 64,
+                     "a-long-key-that-does-not-fit-into-the-inline-buf-%d", i);
+            assert(strlen(longkeys[i]) >= SC_MAP_INLINE);
+            assert(sc_map_put_is64(&map, longkeys[i], i + 1000));
+        }
+        assert(sc_map_size_is64(&map) == 1100);
+        assert((uintptr_t) map.mem % 64 == 0);
+
+        // Deletes shift items back, pointers to inline keys must follow
+        for (int i = 0; i < 1000; i += 2) {
+            snprintf(buf, sizeof(buf), "key-%d", i);
+            assert(sc_map_del_is64(&map, buf, &v));
+            assert(v == (uint64_t) i);
+        }
+
+        for (int i = 0; i < 1000; i++) {
+            snprintf(buf, sizeof(buf), "key-%d", i);
+            assert(sc_map_get_is64(&map, buf, &v) == (i % 2 == 1));
+            assert(i % 2 == 0 || v == (uint64_t) i);
+        }
+
+        for (int i = 0; i < 100; i++) {
+            assert(sc_map_get_is64(&map, longkeys[i], &v));
+            assert(v == (uint64_t) i + 1000);
+        }
+
+        count = 0;
+        sc_map_foreach (&map, key, v) {
+            if (v < 1000) {
+                snprintf(buf, sizeof(buf), "key-%d", (int) v);
+                assert(strcmp(key, buf) == 0);
+            } else {
+                assert(key == longkeys[v - 1000]);
+            }
+            count++;
+        }
+        assert(count == 600);
+
+        sc_map_term_is64(&map);
+        for (int i = 0; i < 100; i++) {
+            free(longkeys[i]);
+        }
+    }
+
+    assert(sc_map_init_istr(&smap, 0, 0));
+    assert(sc_map_put_istr(&smap, "", "empty"));
+    assert(sc_map_put_istr(&smap, NULL, "null"));
+    assert(sc_map_get_istr(&smap, "", &value));
+    assert(strcmp(value, "empty") == 0);
+    assert(sc_map_get_istr(&smap, NULL, &value));
+    assert(strcmp(value, "null") == 0);
+    assert(sc_map_size_istr(&smap) == 2);
+    sc_map_term_istr(&smap);
+}
+
+#if !defined(_WIN32) && !defined(_WIN64)
+static const char *fmap_shared_path = "sc_fmap_thread.bin";
+
+static void *fmap_saver(void *arg)
+{
+    struct sc_map_64 *map = arg;
+
+    for (int i = 0; i < 50; i++) {
+        assert(sc_fmap_save_64(map, fmap_shared_path));
+    }
+
+    return NULL;
+}
+
+static void fmap_thread_test(void)
+{
+    uint64_t value;
+    pthread_t threads[2];
+    struct sc_map_64 maps[2];
+    struct sc_fmap_64 fmap;
+
+    // Two threads save different maps to the same path, file must hold one
+    // complete image at the end.
+    for (uint64_t i = 0; i < 2; i++) {
+        assert(sc_map_init_64(&maps[i], 0, 0));
+        for (uint64_t j = 1; j <= (i + 1) * 5000; j++) {
+            assert(sc_map_put_64(&maps[i], j, j + i));
+        }
+    }
+
+    for (int i = 0; i < 2; i++) {
+        assert(pthread_create(&threads[i], NULL, fmap_saver, &maps[i]) == 0);
+    }
+
+    for (int i = 0; i < 2; i++) {
+        assert(pthread_join(threads[i], NULL) == 0);
+    }
+
+    assert(sc_fmap_open_mmap_64(&fmap, fmap_shared_path));
+    uint64_t size = sc_fmap_size_64(&fmap);
+    uint64_t diff = size == 5000 ? 0 : 1;
+
+    assert(size == 5000 || size == 10000);
+    for (uint64_t j = 1; j <= size; j++) {
+        assert(sc_fmap_get_64(&fmap, j, &value) && value == j + diff);
+    }
+    sc_fmap_close_64(&fmap);
+
+    sc_map_term_64(&maps[0]);
+    sc_map_term_64(&maps[1]);
+    assert(remove(fmap_shared_path) == 0);
+}
+#else
+static void fmap_thread_test(void)
+{
+}
+#endif
+
+void test12()
+{
+    char buf[32], *keys[1000];
+    size_t len;
+    void *image;
+    uint64_t value;
+    const char *path = "sc_fmap_test.bin";
+    struct sc_map_s64 map;
+    struct sc_map_64 map64;
+    struct sc_fmap_s64 fmap;
+    struct sc_fmap_64 fmap64;
+
+    // Empty map
+    assert(sc_map_init_s64(&map, 0, 0));
+    assert(sc_fmap_freeze_s64(&map, &image, &len));
+    assert(sc_fmap_open_s64(&fmap, image, len));
+    assert(sc_fmap_size_s64(&fmap) == 0);
+    assert(!sc_fmap_get_s64(&fmap, "a", &value));
+    assert(!sc_fmap_get_s64(&fmap, NULL, &value));
+    sc_fmap_close_s64(&fmap);
+    sc_map_free(image);
+
+    for (int i = 0; i < 1000; i++) {
+        snprintf(buf, sizeof(buf), "key-%d", i);
+        keys[i] = strdup(buf);
+        assert(sc_map_put_s64(&map, keys[i], i));
+    }
+    assert(sc_map_put_s64(&map, NULL, 77));
+
+    assert(sc_fmap_save_s64(&map, path));
+    assert(sc_fmap_open_mmap_s64(&fmap, path));
+    assert(sc_fmap_size_s64(&fmap) == 1001);
+
+    for (int i = 0; i < 1000; i++) {
+        snprintf(buf, sizeof(buf), "key-%d", i);
+        assert(sc_fmap_get_s64(&fmap, buf, &value));
+        assert(value == (uint64_t) i);
+    }
+    assert(!sc_fmap_get_s64(&fmap, "key-1000", &value));
+    assert(!sc_fmap_get_s64(&fmap, "", &value));
+    assert(sc_fmap_get_s64(&fmap, NULL, &value));
+    assert(value == 77);
+
+    // Kind mismatch
+    assert(!sc_fmap_open_mmap_64(&fmap64, path));
+
+    // Saving over a mapped file replaces it, the old mapping stays valid
+    assert(sc_map_put_s64(&map, "new-key", 5000));
+    assert(sc_fmap_save_s64(&map, path));
+    assert(sc_fmap_size_s64(&fmap) == 1001);
+    for (int i = 0; i < 1000; i++) {
+        snprintf(buf, sizeof(buf), "key-%d", i);
+        assert(sc_fmap_get_s64(&fmap, buf, &value));
+        assert(value == (uint64_t) i);
+    }
+    assert(!sc_fmap_get_s64(&fmap, "new-key", &value));
+    sc_fmap_close_s64(&fmap);
+
+    assert(sc_fmap_open_mmap_s64(&fmap, path));
+    assert(sc_fmap_size_s64(&fmap) == 1002);
+    assert(sc_fmap_get_s64(&fmap, "new-key", &value));
+    assert(value == 5000);
+    sc_fmap_close_s64(&fmap);
+
+    // Corrupt images are rejected
+    assert(sc_fmap_freeze_s64(&map, &image, &len));
+    assert(!sc_fmap_open_s64(&fmap, image, 16));
+    assert(!sc_fmap_open_s64(&fmap, (char *) image + 8, len - 8));
+    ((struct sc_fmap_hdr *) image)->cap = 1000;
+    assert(!sc_fmap_open_s64(&fmap, image, len));
+    ((struct sc_fmap_hdr *) image)->magic ^= 1;
+    assert(!sc_fmap_open_s64(&fmap, image, len));
+    sc_map_free(image);
+
+    assert(remove(path) == 0);
+    assert(!sc_fmap_open_mmap_s64(&fmap, path));
+
+    fmap_thread_test();
+
+    assert(!sc_fmap_save_s64(&map, "/nonexistent-dir/x"));
+
+    sc_map_term_s64(&map);
+    for (int i = 0; i < 1000; i++) {
+        free(keys[i]);
+    }
+
+    assert(sc_map_init_64(&map64, 0, 0));
+    sc_map_incremental_64(&map64, 1);
+    for (uint64_t i = 0; i < 5000; i++) {
+        assert(sc_map_put_64(&map64, i * 7, i));
+    }
+
+    assert(sc_fmap_freeze_64(&map64, &image, &len));
+    assert(sc_fmap_open_64(&fmap64, image, len));
+    assert(sc_fmap_size_64(&fmap64) == 5000);
+    for (uint64_t i = 0; i < 5000; i++) {
+        assert(sc_fmap_get_64(&fmap64, i * 7, &value));
+        assert(value == i);
+        assert(!sc_fmap_get_64(&fmap64, i * 7 + 1, &value));
+    }
+    sc_fmap_close_64(&fmap64);
+    sc_map_free(image);
+    sc_map_term_64(&map64);
+}
+
+void test13()
+{
+    char buf[32], *keys[1000], *key, *value;
+    uint32_t count;
+    uint64_t k, v, prev, bkeys[2] = {0, 5}, bvalues[2];
+    bool bfound[2];
+    struct sc_map_o64 map;
+    struct sc_map_ostr smap;
+
+    assert(!sc_map_init_o64(&map, 0, 24));
+    assert(!sc_map_init_o64(&map, 0, 96));
+    assert(sc_map_init_o64(&map, 0, 0));
+    assert(!sc_map_get_o64(&map, 1, &v));
+    assert(!sc_map_del_o64(&map, 1, &v));
+    assert(sc_map_get_batch_o64(&map, bkeys, 2, bvalues, bfound) == 0);
+    assert(!bfound[0] && !bfound[1]);
+    sc_map_term_o64(&map);
+
+    assert(sc_map_init_o64(&map, 16, 50));
+    for (uint64_t i = 1; i <= 2000; i++) {
+        assert(sc_map_put_o64(&map, i * 31, i));
+    }
+    assert(sc_map_put_o64(&map, 0, 0));
+    assert(sc_map_size_o64(&map) == 2001);
+
+    // Overwrite keeps the position
+    assert(sc_map_put_o64(&map, 31, 1));
+
+    // Delete most of the items, iteration must still follow insertion order
+    for (uint64_t i = 1; i <= 2000; i++) {
+        if (i % 10 != 0) {
+            assert(sc_map_del_o64(&map, i * 31, &v));
+            assert(v == i);
+        }
+    }
+    assert(!sc_map_del_o64(&map, 31, &v));
+    assert(sc_map_size_o64(&map) == 201);
+
+    prev = 0;
+    count = 0;
+    sc_map_foreach (&map, k, v) {
+        assert(k == v * 31);
+        assert(v % 10 == 0 && v > prev);
+        prev = v;
+        count++;
+    }
+    assert(count == 200);
+    assert(map.cap <= 2 * 200);
+
+    // Reinserted keys go to the end
+    for (uint64_t i = 1; i <= 2000; i++) {
+        if (i % 10 != 0) {
+            assert(sc_map_put_o64(&map, i * 31, i + 2000));
+        }
+    }
+    assert(sc_map_size_o64(&map) == 2001);
+
+    prev = 0;
+    count = 0;
+    sc_map_foreach (&map, k, v) {
+        assert(v > prev);
+        assert(k == (v > 2000 ? v - 2000 : v) * 31);
+        prev = v;
+        count++;
+    }
+    assert(count == 2000);
+
+    for (uint64_t i = 1; i <= 2000; i++) {
+        assert(sc_map_get_o64(&map, i * 31, &v));
+        assert(v == (i % 10 == 0 ? i : i + 2000));
+        assert(!sc_map_get_o64(&map, i * 31 + 1, &v));
+    }
+    assert(sc_map_get_o64(&map, 0, &v));
+    assert(sc_map_del_o64(&map, 0, &v));
+    assert(sc_map_size_o64(&map) == 2000);
+
+    // Deleting the last item makes room at the end
+    count = map.cap;
+    assert(sc_map_del_o64(&map, 1999 * 31, &v));
+    assert(map.cap == count - 1);
+
+    sc_map_clear_o64(&map);
+    assert(sc_map_size_o64(&map) == 0);
+    assert(!sc_map_get_o64(&map, 310, &v));
+    count = 0;
+    sc_map_foreach_key (&map, k) {
+        count++;
+    }
+    assert(count == 0);
+    assert(sc_map_put_o64(&map, 310, 1));
+    assert(sc_map_get_o64(&map, 310, &v) && v == 1);
+    sc_map_term_o64(&map);
+
+    assert(sc_map_init_ostr(&smap, 0, 0));
+    for (int i = 0; i < 1000; i++) {
+        snprintf(buf, sizeof(buf), "key-%d", 999 - i);
+        keys[i] = strdup(buf);
+        assert(sc_map_put_ostr(&smap, keys[i], keys[i]));
+    }
+
+    for (int i = 0; i < 1000; i += 3) {
+        assert(sc_map_del_ostr(&smap, keys[i], &value));
+        assert(value == keys[i]);
+    }
+
+    count = 0;
+    sc_map_foreach (&smap, key, value) {
+        while (count % 3 == 0) {
+            count++;
+        }
+        assert(key == keys[count] && value == keys[count]);
+        count++;
+    }
+    assert(count == 999);
+    sc_map_term_ostr(&smap);
+
+    for (int i = 0; i < 1000; i++) {
+        free(keys[i]);
+    }
+}
+
+#define test_shrink_of(name)                                                   \
+    static void test_shrink_##name(uint32_t step)                              \
+    {                                                                          \
+        size_t peak;                                                           \
+        uint64_t v;                                                            \
+        struct sc_map_##name map;                                              \
+                                                                               \
+        assert(sc_map_init_##name(&map, 0, 0));                                \
+        sc_map_incremental_##name(&map, step);                                 \
+        assert(sc_map_mem_usage_##name(&map) == 0);                            \
+        assert(sc_map_shrink_##name(&map));                                    \
+        assert(!sc_map_low_water_##name(&map, 38));                            \
+                                                                               \
+        for (uint64_t i = 0; i < 2000; i++) {                                  \
+            assert(sc_map_put_##name(&map, i, i));                             \
+        }                                                                      \
+        peak = sc_map_mem_usage_##name(&map);                                  \
+        assert(peak > 2000 * sizeof(*map.mem));                                \
+                                                                               \
+        for (uint64_t i = 0; i < 2000; i++) {                                  \
+            if (i % 20 != 0) {                                                 \
+                assert(sc_map_del_##name(&map, i, NULL));                      \
+            }                                                                  \
+        }                                                                      \
+        assert(sc_map_mem_usage_##name(&map) <= peak);                         \
+                                                                               \
+        assert(sc_map_shrink_##name(&map));                                    \
+        while (map.old != NULL) {                                              \
+            /* Incremental maps release the old table when it is migrated */   \
+            sc_map_get_##name(&map, 1, &v);                                    \
+        }                                                                      \
+        assert(sc_map_mem_usage_##name(&map) < peak / 4);                      \
+        for (uint64_t i = 0; i < 2000; i++) {                                  \
+            assert(sc_map_get_##name(&map, i, &v) == (i % 20 == 0));           \
+            assert(i % 20 != 0 || v == i);                                     \
+        }                                                                      \
+        assert(sc_map_size_##name(&map) == 100);                               \
+                                                                               \
+        /* Automatic shrink, deletes below 10% load shrink the table */        \
+        assert(sc_map_low_water_##name(&map, 10));                             \
+        for (uint64_t i = 0; i < 2000; i++) {                                  \
+            assert(sc_map_put_##name(&map, i, i + 1));                         \
+        }                                                                      \
+        for (uint64_t i = 0; i < 2000; i++) {                                  \
+            if (i % 50 != 0) {                                                 \
+                assert(sc_map_del_##name(&map, i, &v));                        \
+                assert(v == i + 1);                                            \
+            }                                                                  \
+        }                                                                      \
+        assert(sc_map_size_##name(&map) == 40);                                \
+        while (map.old != NULL) {                                              \
+            sc_map_get_##name(&map, 1, &v);                                    \
+        }                                                                      \
+        assert(sc_map_mem_usage_##name(&map) < peak / 4);                      \
+        for (uint64_t i = 0; i < 2000; i++) {                                  \
+            assert(sc_map_get_##name(&map, i, &v) == (i % 50 == 0));           \
+            assert(i % 50 != 0 || v == i + 1);                                 \
+        }                                                                      \
+                                                                               \
+        /* Clear releases everything when there is a low water mark */         \
+        sc_map_clear_##name(&map);                                             \
+        assert(sc_map_mem_usage_##name(&map) == 0);                            \
+        assert(!sc_map_get_##name(&map, 50, &v));                              \
+        assert(!sc_map_del_##name(&map, 50, &v));                              \
+        assert(sc_map_put_##name(&map, 50, 5));                                \
+        assert(sc_map_get_##name(&map, 50, &v) && v == 5);                     \
+                                                                               \
+        assert(sc_map_del_##name(&map, 50, &v));                               \
+        assert(sc_map_put_##name(&map, 0, 1));                                 \
+        assert(sc_map_shrink_##name(&map));                                    \
+        assert(sc_map_mem_usage_##name(&map) == 0);                            \
+        assert(sc_map_get_##name(&map, 0, &v) && v == 1);                      \
+        assert(sc_map_size_##name(&map) == 1);                                 \
+                                                                               \
+        sc_map_term_##name(&map);                                              \
+    }
+
+test_shrink_of(64)
+test_shrink_of(sw64)
+test_shrink_of(o64)
+
+void test14()
+{
+    uint32_t steps[] = {0, 1, 16};
+    struct sc_map_str map;
+    char *value;
+
+    for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); i++) {
+        test_shrink_64(steps[i]);
+        test_shrink_sw64(steps[i]);
+        test_shrink_o64(steps[i]);
+    }
+
+    // Clear used to keep the zero key
+    assert(sc_map_init_str(&map, 0, 0));
+    assert(sc_map_put_str(&map, NULL, "null"));
+    sc_map_clear_str(&map);
+    assert(!sc_map_get_str(&map, NULL, &value));
+    assert(sc_map_put_str(&map, NULL, "null"));
+    assert(sc_map_size_str(&map) == 1);
+    sc_map_term_str(&map);
+}
+
+void test15()
+{
+    uint32_t buckets[3][64] = {{0}};
+    uint32_t (*hashes[])(uint64_t) = {sc_map_hash_fmix64, sc_map_hash_wyhash,
+                                      sc_map_hash_rrmxmx};
+
+    assert(sc_map_hash_32(7) == 7);
+    assert(sc_map_hash_64(UINT64_C(0x100000001)) == 0);
+    assert(sc_map_hash_fmix32(0) == 0);
+    assert(sc_map_hash_fmix32(1) != sc_map_hash_fmix32(2));
+
+    // Keys that differ only in high bits spread over the low bits
+    for (uint64_t i = 0; i < 64 * 64; i++) {
+        for (int h = 0; h < 3; h++) {
+            buckets[h][hashes[h](i << 40u) & 63]++;
+        }
+    }
+
+    for (int h = 0; h < 3; h++) {
+        for (int i = 0; i < 64; i++) {
+            assert(buckets[h][i] > 16 && buckets[h][i] < 128);
+        }
+    }
+
+    // Each scalar map picks its own hash
+    struct sc_map_64 m64;
+    struct sc_map_64m m64m;
+    uint64_t k = UINT64_C(0x100000001), v;
+
+    assert(sc_map_key_hash_64(k) == sc_map_hash_64(k));
+    assert(sc_map_key_hash_64m(k) == sc_map_hash_wyhash(k));
+    assert(sc_map_key_hash_64(k) != sc_map_key_hash_64m(k));
+    assert(sc_map_key_hash_64m(0) == 0);
+
+    assert(sc_map_init_64(&m64, 0, 0));
+    assert(sc_map_init_64m(&m64m, 0, 0));
+
+    for (uint64_t i = 0; i < 1000; i++) {
+        assert(sc_map_put_64(&m64, i << 32u, i));
+        assert(sc_map_put_64m(&m64m, i << 32u, i));
+    }
+
+    for (uint64_t i = 0; i < 1000; i++) {
+        assert(sc_map_get_64(&m64, i << 32u, &v) && v == i);
+        assert(sc_map_get_64m(&m64m, i << 32u, &v) && v == i);
+    }
+
+    assert(sc_map_size_64m(&m64m) == 1000);
+    assert(sc_map_del_64m(&m64m, 0, &v) && v == 0);
+    assert(!sc_map_get_64m(&m64m, 0, &v));
+
+    sc_map_term_64(&m64);
+    sc_map_term_64m(&m64m);
+}
+
+struct test_id
+{
+    uint32_t tenant;
+    uint64_t object;
+};
+
+static inline uint32_t test_id_hash(struct test_id k)
+{
+    return sc_map_hash_fmix64(k.object ^ ((uint64_t) k.tenant << 48u));
+}
+
+static inline bool test_id_eq(struct test_id a, struct test_id b)
+{
+    return a.tenant == b.tenant && a.object == b.object;
+}
+
+sc_map_of_pod(id, struct test_id, uint64_t, test_id_hash, test_id_eq)
+
+void test16()
+{
+    uint32_t count = 0;
+    uint64_t v, sum = 0;
+    struct test_id k;
+    struct sc_map_id map;
+
+    assert(!sc_map_init_id(&map, 0, 10));
+    assert(sc_map_init_id(&map, 0, 0));
+    assert(sc_map_mem_usage_id(&map) == 0);
+    assert(!sc_map_get_id(&map, (struct test_id){0, 0}, &v));
+    assert(!sc_map_del_id(&map, (struct test_id){0, 0}, &v));
+    assert(sc_map_shrink_id(&map));
+    sc_map_foreach_pod (&map, k, v) {
+        count++;
+    }
+    assert(count == 0);
+
+    // All zero key is a valid key
+    assert(sc_map_put_id(&map, (struct test_id){0, 0}, 100));
+    assert(sc_map_get_id(&map, (struct test_id){0, 0}, &v) && v == 100);
+
+    for (uint32_t t = 1; t <= 4; t++) {
+        for (uint64_t o = 0; o < 500; o++) {
+            assert(sc_map_put_id(&map, (struct test_id){t, o}, t * 1000 + o));
+        }
+    }
+    assert(sc_map_size_id(&map) == 2001);
+    assert(sc_map_put_id(&map, (struct test_id){1, 1}, 7));
+    assert(sc_map_size_id(&map) == 2001);
+
+    for (uint32_t t = 1; t <= 4; t++) {
+        for (uint64_t o = 0; o < 500; o++) {
+            assert(sc_map_get_id(&map, (struct test_id){t, o}, &v));
+            assert(v == ((t == 1 && o == 1) ? 7 : t * 1000 + o));
+            assert(!sc_map_get_id(&map, (struct test_id){t + 4, o}, &v));
+        }
+    }
+
+    // Same object id, different tenants
+    for (uint64_t o = 0; o < 500; o++) {
+        if (o % 5 != 0) {
+            assert(sc_map_del_id(&map, (struct test_id){2, o}, &v));
+            assert(v == 2000 + o);
+            assert(sc_map_del_id(&map, (struct test_id){3, o}, NULL));
+        }
+    }
+    assert(!sc_map_del_id(&map, (struct test_id){2, 1}, &v));
+    assert(sc_map_get_id(&map, (struct test_id){4, 1}, &v) && v == 4001);
+
+    count = 0;
+    sc_map_foreach_pod (&map, k, v) {
+        assert(k.tenant != 2 || k.object % 5 == 0);
+        sum += v;
+        count++;
+    }
+    assert(count == sc_map_size_id(&map) && count == 1201);
+
+    assert(sc_map_shrink_id(&map));
+    assert(sc_map_mem_usage_id(&map) == 2048 * (sizeof(*map.mem) + 1));
+    for (uint64_t o = 0; o < 500; o++) {
+        assert(sc_map_get_id(&map, (struct test_id){3, o}, &v) ==
+               (o % 5 == 0));
+    }
+
+    sc_map_clear_id(&map);
+    assert(sc_map_size_id(&map) == 0);
+    assert(!sc_map_get_id(&map, (struct test_id){0, 0}, &v));
+    assert(sc_map_shrink_id(&map));
+    assert(sc_map_mem_usage_id(&map) == 0);
+    assert(sc_map_put_id(&map, (struct test_id){9, 9}, 9));
+    sc_map_term_id(&map);
+
+    assert(sc_map_init_id(&map, 1000, 50));
+    assert(map.cap == 2048);
+    sc_map_term_id(&map);
+}
+
+#ifdef SC_MAP_STATS
+void test17()
+{
+    uint64_t v;
+    struct sc_map_stats st;
+    struct sc_map_64 map;
+    struct sc_map_s64 smap;
+
+    assert(sc_map_init_64(&map, 0, 0));
+    sc_map_stats_64(&map, &st);
+    assert(st.gets == 0 && st.puts == 0 && st.remaps == 0 && st.bytes == 0);
+
+    // Default hash keeps sequential keys at their home slots
+    for (uint64_t i = 1; i <= 1000; i++) {
+        assert(sc_map_put_64(&map, i, i));
+    }
+    for (uint64_t i = 1; i <= 1000; i++) {
+        assert(sc_map_get_64(&map, i, &v));
+    }
+    assert(sc_map_put_64(&map, 0, 0));
+    assert(sc_map_get_64(&map, 0, &v));
+
+    sc_map_stats_64(&map, &st);
+    assert(st.puts == 1000 && st.put_probes == 1000 && st.put_max == 1);
+    assert(st.gets == 1000 && st.get_probes == 1000 && st.get_max == 1);
+    assert(st.remaps > 0);
+    assert(st.bytes == sc_map_mem_usage_64(&map));
+    assert(st.size == 1001 && st.cap == map.cap);
+    assert(st.hist[0] == 1000);
+
+    assert(sc_map_shrink_64(&map));
+    sc_map_clear_64(&map);
+
+    // Keys with equal halves all hash to zero, a single long cluster
+    for (uint64_t i = 1; i <= 100; i++) {
+        assert(sc_map_put_64(&map, (i << 32u) | i, i));
+    }
+    assert(!sc_map_get_64(&map, (UINT64_C(200) << 32u) | 200, &v));
+
+    sc_map_stats_64(&map, &st);
+    assert(st.put_max == 100);
+    assert(st.get_max == 101);
+    assert(st.hist[SC_MAP_STATS_HIST - 1] == 100 - (SC_MAP_STATS_HIST - 1));
+    for (int i = 0; i < SC_MAP_STATS_HIST - 1; i++) {
+        assert(st.hist[i] == 1);
+    }
+    sc_map_term_64(&map);
+
+    // Incremental resize, items are spread over both tables
+    assert(sc_map_init_s64(&smap, 0, 0));
+    sc_map_incremental_s64(&smap, 1);
+    for (int i = 0; i < 100; i++) {
+        assert(sc_map_put_s64(&smap, (char *) "abc" + (i % 3), i));
+    }
+    assert(sc_map_put_s64(&smap, "x", 1));
+    sc_map_stats_s64(&smap, &st);
+    assert(st.puts == 101 && st.size == 4);
+    assert(st.hist[0] + st.hist[1] + st.hist[2] + st.hist[3] == 4);
+    sc_map_term_s64(&smap);
+}
+#endif
+
+// Items of a cluster must be ordered by distance from their home slot
+static void robin_check(struct sc_map_item_r64 *mem, uint32_t cap)
+{
+    uint32_t mod = cap - 1, prev = 0, dist;
+
+    for (uint32_t i = 0; i < cap * 2 && mem != NULL; i++) {
+        uint32_t pos = i & mod;
+
+        if (mem[pos].key == 0) {
+            prev = 0;
+            continue;
+        }
+
+        dist = (pos - sc_map_hash_fmix64(mem[pos].key)) & mod;
+        assert(i < cap || dist <= prev + 1);
+        assert(dist == 0 || mem[(pos - 1) & mod].key != 0);
+        prev = dist;
+    }
+}
+
+void test18()
+{
+    uint32_t steps[] = {0, 1, 16};
+    uint64_t v;
+    struct sc_map_r64 map;
+
+    for (size_t k = 0; k < sizeof(steps) / sizeof(steps[0]); k++) {
+        assert(sc_map_init_r64(&map, 0, 95));
+        sc_map_incremental_r64(&map, steps[k]);
+
+        for (uint64_t i = 1; i <= 10000; i++) {
+            assert(sc_map_put_r64(&map, i * 7919, i));
+        }
+        assert(sc_map_put_r64(&map, 0, 0));
+        assert(sc_map_put_r64(&map, 7919, 100));
+        assert(sc_map_size_r64(&map) == 10001);
+
+        for (uint64_t i = 1; i <= 10000; i++) {
+            assert(sc_map_get_r64(&map, i * 7919, &v));
+            assert(v == (i == 1 ? 100 : i));
+            assert(!sc_map_get_r64(&map, i * 7919 + 1, &v));
+        }
+        assert(sc_map_get_r64(&map, 0, &v) && v == 0);
+        robin_check(map.mem, map.cap);
+        robin_check(map.old, map.old_cap);
+
+        // Backward shift delete keeps the order
+        for (uint64_t i = 1; i <= 10000; i += 2) {
+            assert(sc_map_del_r64(&map, i * 7919, &v));
+            assert(!sc_map_del_r64(&map, i * 7919, &v));
+        }
+        assert(sc_map_del_r64(&map, 0, &v));
+        assert(sc_map_size_r64(&map) == 5000);
+        robin_check(map.mem, map.cap);
+        robin_check(map.old, map.old_cap);
+
+        for (uint64_t i = 1; i <= 10000; i++) {
+            assert(sc_map_get_r64(&map, i * 7919, &v) == (i % 2 == 0));
+        }
+
+        assert(sc_map_shrink_r64(&map));
+        robin_check(map.mem, map.cap);
+        robin_check(map.old, map.old_cap);
+        for (uint64_t i = 2; i <= 10000; i += 2) {
+            assert(sc_map_get_r64(&map, i * 7919, &v) && v == i);
+        }
+
+        sc_map_clear_r64(&map);
+        assert(sc_map_size_r64(&map) == 0);
+        assert(!sc_map_get_r64(&map, 2 * 7919, &v));
+        sc_map_term_r64(&map);
+    }
+}
+
+#define test_build_of(name, lf, threads)                                       \
+    do {                                                                       \
+        uint32_t n = 30000;                                                    \
+        uint64_t *keys = malloc(sizeof(*keys) * n);                            \
+        uint64_t *values = malloc(sizeof(*values) * n);                        \
+        uint64_t v;                                                            \
+        struct sc_map_##name map, exp;                                         \
+                                                                               \
+        /* Duplicates, key 0 and keys with equal halves clustered at 0 */      \
+        for (uint32_t i = 0; i < n; i++) {                                     \
+            keys[i] = (i % 50 == 0) ? (((uint64_t) i << 32u) | i) : i % 28000; \
+            values[i] = i;                                                     \
+        }                                                                      \
+                                                                               \
+        assert(sc_map_init_##name(&map, 0, lf));                               \
+        assert(sc_map_init_##name(&exp, 0, lf));                               \
+        assert(sc_map_put_##name(&map, 7, 7));                                 \
+        assert(sc_map_put_##name(&map, 1ull << 40u, 1));                       \
+        assert(sc_map_put_##name(&exp, 7, 7));                                 \
+        assert(sc_map_put_##name(&exp, 1ull << 40u, 1));                       \
+                                                                               \
+        assert(sc_map_build_##name(&map, keys, values, n, threads));           \
+        for (uint32_t i = 0; i < n; i++) {                                     \
+            assert(sc_map_put_##name(&exp, keys[i], values[i]));               \
+        }                                                                      \
+                                                                               \
+        assert(sc_map_size_##name(&map) == sc_map_size_##name(&exp));          \
+        for (uint32_t i = 0; i < n; i++) {                                     \
+            assert(sc_map_get_##name(&map, keys[i], &v));                      \
+            assert(sc_map_get_##name(&exp, keys[i], &values[i]));              \
+            assert(v == values[i]);                                            \
+        }                                                                      \
+        assert(sc_map_get_##name(&map, 1ull << 40u, &v) && v == 1);            \
+        assert(!sc_map_get_##name(&map, 28000, &v));                           \
+                                                                               \
+        assert(sc_map_build_##name(&map, keys, values, 0, threads));           \
+        assert(sc_map_size_##name(&map) == sc_map_size_##name(&exp));          \
+                                                                               \
+        free(keys);                                                            \
+        free(values);                                                          \
+        sc_map_term_##name(&map);                                              \
+        sc_map_term_##name(&exp);                                              \
+    } while (0)
+
+void test19()
+{
+    uint32_t threads[] = {0, 1, 3, 8, 1000};
+    uint64_t v;
+    char *s, *keys[] = {"jack", "jane", "janie", "jack", NULL};
+    char *values[] = {"chicago", "new york", "atlanta", "boston", "null"};
+    struct sc_map_64 a, b;
+    struct sc_map_str sa, sb;
+
+    for (size_t i = 0; i < sizeof(threads) / sizeof(threads[0]); i++) {
+        test_build_of(64, 75, threads[i]);
+        test_build_of(64, 95, threads[i]);
+        test_build_of(r64, 95, threads[i]);
+    }
+
+    assert(sc_map_init_str(&sa, 0, 0));
+    assert(sc_map_build_str(&sa, (char *const *) keys,
+                            (char *const *) values, 5, 4));
+    assert(sc_map_size_str(&sa) == 4);
+    assert(sc_map_get_str(&sa, "jack", &s) && strcmp(s, "boston") == 0);
+    assert(sc_map_get_str(&sa, NULL, &s) && strcmp(s, "null") == 0);
+
+    // Merge, values of source win, source is not modified
+    assert(sc_map_init_str(&sb, 0, 0));
+    assert(sc_map_put_str(&sb, "jack", "denver"));
+    assert(sc_map_put_str(&sb, "joe", "austin"));
+    assert(sc_map_merge_str(&sb, &sa));
+    assert(sc_map_merge_str(&sb, &sb));
+    assert(sc_map_size_str(&sb) == 5);
+    assert(sc_map_get_str(&sb, "jack", &s) && strcmp(s, "boston") == 0);
+    assert(sc_map_get_str(&sb, "joe", &s) && strcmp(s, "austin") == 0);
+    assert(sc_map_get_str(&sb, NULL, &s) && strcmp(s, "null") == 0);
+    assert(sc_map_size_str(&sa) == 4);
+    sc_map_term_str(&sa);
+    sc_map_term_str(&sb);
+
+    // Source in the middle of an incremental resize
+    assert(sc_map_init_64(&a, 0, 0));
+    assert(sc_map_init_64(&b, 0, 0));
+    sc_map_incremental_64(&a, 1);
+    for (uint64_t i = 0; i < 1000; i++) {
+        assert(sc_map_put_64(&a, i, i));
+        assert(sc_map_put_64(&b, i + 500, 0));
+    }
+    assert(a.old != NULL);
+    assert(sc_map_merge_64(&b, &a));
+    assert(sc_map_size_64(&b) == 1500);
+    for (uint64_t i = 0; i < 1500; i++) {
+        assert(sc_map_get_64(&b, i, &v) && v == (i < 1000 ? i : 0));
+    }
+    sc_map_term_64(&a);
+    sc_map_term_64(&b);
+}
 
 #ifdef SC_HAVE_WRAP
 
@@ -464,6 +2011,215 @@ void fail_test()
     fail_calloc = false;
 
     sc_map_term_32(&map);
+
+    struct sc_map_sw64 sw;
+
+    fail_calloc = true;
+    assert(!sc_map_init_sw64(&sw, 10, 0));
+    fail_calloc = false;
+    assert(sc_map_init_sw64(&sw, 0, 0));
+    fail_calloc = true;
+    assert(!sc_map_put_sw64(&sw, 1, 1));
+    fail_calloc = false;
+    assert(sc_map_put_sw64(&sw, 1, 1));
+
+    for (uint64_t i = 0; i < SC_SIZE_MAX; i++) {
+        success = sc_map_put_sw64(&sw, i, i);
+    }
+    assert(!success);
+    sc_map_term_sw64(&sw);
+
+    uint64_t ov;
+    struct sc_map_o64 om;
+
+    fail_calloc = true;
+    assert(!sc_map_init_o64(&om, 10, 0));
+    fail_calloc = false;
+    assert(sc_map_init_o64(&om, 0, 0));
+    fail_calloc = true;
+    assert(!sc_map_put_o64(&om, 1, 1));
+    fail_calloc = false;
+    assert(sc_map_put_o64(&om, 1, 1));
+
+    for (uint64_t i = 0; i < SC_SIZE_MAX; i++) {
+        success = sc_map_put_o64(&om, i, i);
+    }
+    assert(!success);
+    assert(sc_map_get_o64(&om, 1, &ov));
+    sc_map_term_o64(&om);
+
+    assert(sc_map_init_o64(&om, 0, 0));
+    assert(sc_map_init_sw64(&sw, 0, 0));
+    assert(sc_map_init_32(&map, 0, 0));
+    for (uint64_t i = 1; i < 1000; i++) {
+        assert(sc_map_put_o64(&om, i, i));
+        assert(sc_map_put_sw64(&sw, i, i));
+        assert(i > 100 || sc_map_put_32(&map, (uint32_t) i, (uint32_t) i));
+    }
+    for (uint64_t i = 1; i < 1000; i++) {
+        assert(i < 10 || sc_map_del_o64(&om, i, NULL));
+        assert(i < 10 || sc_map_del_sw64(&sw, i, NULL));
+        assert(i < 10 || i > 100 || sc_map_del_32(&map, (uint32_t) i, NULL));
+    }
+
+    fail_calloc = true;
+    assert(!sc_map_shrink_o64(&om));
+    assert(!sc_map_shrink_sw64(&sw));
+    assert(!sc_map_shrink_32(&map));
+    fail_calloc = false;
+    for (uint64_t i = 1; i < 10; i++) {
+        assert(sc_map_get_o64(&om, i, &ov) && ov == i);
+        assert(sc_map_get_sw64(&sw, i, &ov) && ov == i);
+    }
+    assert(sc_map_shrink_o64(&om));
+    assert(sc_map_shrink_sw64(&sw));
+    assert(sc_map_shrink_32(&map));
+    sc_map_term_o64(&om);
+    sc_map_term_sw64(&sw);
+    sc_map_term_32(&map);
+
+    struct sc_map_id id;
+
+    fail_calloc = true;
+    assert(!sc_map_init_id(&id, 10, 0));
+    fail_calloc = false;
+    assert(sc_map_init_id(&id, 0, 0));
+    fail_calloc = true;
+    assert(!sc_map_put_id(&id, (struct test_id){1, 1}, 1));
+    fail_calloc = false;
+    for (uint64_t i = 0; i < 100; i++) {
+        assert(sc_map_put_id(&id, (struct test_id){1, i}, i));
+    }
+    fail_calloc = true;
+    for (uint64_t i = 100; i < 1000; i++) {
+        success = sc_map_put_id(&id, (struct test_id){1, i}, i);
+    }
+    assert(!success);
+    fail_calloc = false;
+    for (uint64_t i = 0; i < 100; i++) {
+        assert(sc_map_get_id(&id, (struct test_id){1, i}, &ov) && ov == i);
+    }
+    sc_map_term_id(&id);
+
+    struct sc_map_r64 rm;
+
+    assert(sc_map_init_r64(&rm, 0, 0));
+    fail_calloc = true;
+    assert(!sc_map_put_r64(&rm, 1, 1));
+    fail_calloc = false;
+    for (uint64_t i = 1; i <= 100; i++) {
+        assert(sc_map_put_r64(&rm, i, i));
+    }
+    fail_calloc = true;
+    for (uint64_t i = 101; i < 1000; i++) {
+        success = sc_map_put_r64(&rm, i, i);
+    }
+    assert(!success);
+    fail_calloc = false;
+    for (uint64_t i = 1; i <= 100; i++) {
+        assert(sc_map_get_r64(&rm, i, &ov) && ov == i);
+    }
+    sc_map_term_r64(&rm);
+
+    struct sc_map_64 bm, bs;
+    uint64_t bk[3] = {1, 2, 3};
+
+    assert(sc_map_init_64(&bm, 0, 0));
+    assert(sc_map_init_64(&bs, 0, 0));
+    for (uint64_t i = 1; i <= 100; i++) {
+        assert(sc_map_put_64(&bs, i, i));
+    }
+    fail_calloc = true;
+    assert(!sc_map_build_64(&bm, bk, bk, 3, 2));
+    assert(!sc_map_merge_64(&bm, &bs));
+    fail_calloc = false;
+    assert(sc_map_size_64(&bm) == 0);
+    assert(sc_map_build_64(&bm, bk, bk, 3, 2));
+    assert(sc_map_merge_64(&bm, &bs));
+    assert(sc_map_size_64(&bm) == 100);
+    sc_map_term_64(&bm);
+    sc_map_term_64(&bs);
+
+    struct sc_cmap_64 cmap;
+
+    fail_calloc = true;
+    assert(!sc_cmap_init_64(&cmap, 4, 0, 0));
+    fail_calloc = false;
+    assert(sc_cmap_init_64(&cmap, 4, 0, 0));
+    fail_calloc = true;
+    assert(!sc_cmap_put_64(&cmap, 1, 1));
+    fail_calloc = false;
+    sc_cmap_term_64(&cmap);
+
+    fail_calloc = true;
+    assert(!sc_cmap_init_64(&cmap, 4, 100, 0));
+    fail_calloc = false;
+
+    struct sc_lfmap_64 lf;
+
+    fail_calloc = true;
+    assert(!sc_lfmap_init_64(&lf, 0, 0, 1));
+    fail_calloc = false;
+    assert(!sc_lfmap_init_64(&lf, SC_SIZE_MAX, 0, 1));
+    assert(sc_lfmap_init_64(&lf, 0, 0, 1));
+    fail_calloc = true;
+    for (uint64_t i = 1; i < 100; i++) {
+        success = sc_lfmap_put_64(&lf, i, i);
+    }
+    assert(!success);
+    fail_calloc = false;
+
+    for (uint64_t i = 1; i < SC_SIZE_MAX; i++) {
+        success = sc_lfmap_put_64(&lf, i, i);
+    }
+    assert(!success);
+    sc_lfmap_term_64(&lf);
+
+    // Keys with the same home slot fill the reprobe window. Table is rehashed
+    // at the same capacity, so copying the last one needs another table.
+    uint64_t key = 0, n = 0, value;
+    struct sc_lfmap_table *top;
+
+    assert(sc_lfmap_init_64(&lf, 1024, 95, 1));
+    while (lf.lf.table->next == NULL) {
+        key++;
+        if ((sc_map_hash_fmix64(key) & 1023) != 5) {
+            continue;
+        }
+        assert(sc_lfmap_put_64(&lf, key, key));
+        n++;
+    }
+    top = lf.lf.table;
+
+    fail_calloc = true;
+    assert(!sc_lfmap_put_64(&lf, 1, 1));
+    fail_calloc = false;
+    assert(lf.lf.table == top);
+
+    // Left behind slots are copied by the next writer, table is promoted.
+    assert(sc_lfmap_put_64(&lf, 2, 2));
+    assert(lf.lf.table != top);
+    assert(sc_lfmap_size_64(&lf) == n + 1);
+
+    for (uint64_t i = 1; i <= key; i++) {
+        if ((sc_map_hash_fmix64(i) & 1023) == 5) {
+            assert(sc_lfmap_get_64(&lf, i, &value) && value == i);
+        }
+    }
+
+    sc_lfmap_quiescent_64(&lf, 0);
+    sc_lfmap_term_64(&lf);
+
+    struct sc_map_64 m64;
+    size_t len;
+    void *image;
+
+    assert(sc_map_init_64(&m64, 0, 0));
+    fail_calloc = true;
+    assert(!sc_fmap_freeze_64(&m64, &image, &len));
+    assert(!sc_fmap_save_64(&m64, "sc_fmap_fail.bin"));
+    fail_calloc = false;
+    sc_map_term_64(&m64);
 }
 #else
 void fail_test(void)
@@ -479,6 +2235,23 @@ int main(int argc, char *argv[])
     test2();
     test3();
     test4();
+    test5();
+    test6();
+    test7();
+    test8();
+    test9();
+    test10();
+    test11();
+    test12();
+    test13();
+    test14();
+    test15();
+    test16();
+#ifdef SC_MAP_STATS
+    test17();
+#endif
+    test18();
+    test19();
 
     return 0;
 }
@@ -0,0 +1,290 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "sc_cmap.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef SC_SIZE_MAX
+    #define SC_SIZE_MAX UINT32_MAX
+#endif
+
+#if defined(_WIN32) || defined(_WIN64)
+
+static int sc_cmap_lock_init(struct sc_cmap_lock *lock)
+{
+    InitializeCriticalSection(&lock->mtx);
+    return 0;
+}
+
+static void sc_cmap_lock_term(struct sc_cmap_lock *lock)
+{
+    DeleteCriticalSection(&lock->mtx);
+}
+
+static void sc_cmap_lock(struct sc_cmap_lock *lock)
+{
+    EnterCriticalSection(&lock->mtx);
+}
+
+static void sc_cmap_unlock(struct sc_cmap_lock *lock)
+{
+    LeaveCriticalSection(&lock->mtx);
+}
+
+#else
+
+static int sc_cmap_lock_init(struct sc_cmap_lock *lock)
+{
+    int rc;
+
+    rc = pthread_mutex_init(&lock->mtx, NULL);
+    if (rc != 0) {
+        sc_map_on_error("pthread_mutex_init : errcode(%d) ", rc);
+    }
+
+    return rc;
+}
+
+static void sc_cmap_lock_term(struct sc_cmap_lock *lock)
+{
+    int rc;
+
+    rc = pthread_mutex_destroy(&lock->mtx);
+    assert(rc == 0);
+    (void) rc;
+}
+
+static void sc_cmap_lock(struct sc_cmap_lock *lock)
+{
+    int rc;
+
+    rc = pthread_mutex_lock(&lock->mtx);
+    assert(rc == 0);
+    (void) rc;
+}
+
+static void sc_cmap_unlock(struct sc_cmap_lock *lock)
+{
+    int rc;
+
+    rc = pthread_mutex_unlock(&lock->mtx);
+    assert(rc == 0);
+    (void) rc;
+}
+
+#endif
+
+#define sc_cmap_impl_of(name, K, V)                                            \
+                                                                               \
+    static struct sc_cmap_shard_##name *sc_cmap_shard_##name(                  \
+            struct sc_cmap_##name *map, uint32_t hash)                         \
+    {                                                                          \
+        /* sc_map probes with the low bits of the hash and the default hash of \
+         * scalar maps does not mix, so the shard is picked from the high bits \
+         * of the mixed hash. */                                               \
+        uint64_t i = sc_map_hash_fmix32(hash);                                 \
+                                                                               \
+        return &map->shards[(i * map->count) >> 32u];                          \
+    }                                                                          \
+                                                                               \
+    bool sc_cmap_init_##name(struct sc_cmap_##name *map, uint32_t shards,      \
+                             uint32_t cap, uint32_t load_factor)               \
+    {                                                                          \
+        uint32_t i, v = shards == 0 ? 16 : shards;                             \
+        size_t bytes;                                                          \
+        uintptr_t p;                                                           \
+                                                                               \
+        if (v > SC_SIZE_MAX / sizeof(*map->shards) / 2) {                      \
+            sc_map_on_error("Too many shards. shards(%u).", shards);           \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        /* Find next power of two */                                           \
+        v--;                                                                   \
+        for (i = 1; i < sizeof(v) * 8; i *= 2) {                               \
+            v |= v >> i;                                                       \
+        }                                                                      \
+        v++;                                                                   \
+                                                                               \
+        bytes = (sizeof(*map->shards) * v) + SC_CMAP_CACHE_LINE;               \
+        map->mem = sc_map_calloc(1, bytes);                                    \
+        if (map->mem == NULL) {                                                \
+            sc_map_on_error("Out of memory. bytes(%zu).", bytes);              \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        p = ((uintptr_t) map->mem + SC_CMAP_CACHE_LINE - 1) &                  \
+            ~((uintptr_t) SC_CMAP_CACHE_LINE - 1);                             \
+        map->shards = (struct sc_cmap_shard_##name *) p;                       \
+        map->count = v;                                                        \
+                                                                               \
+        for (i = 0; i < v; i++) {                                              \
+            if (!sc_map_init_##name(&map->shards[i].map, cap / v,              \
+                                    load_factor)) {                            \
+                goto error;                                                    \
+            }                                                                  \
+                                                                               \
+            if (sc_cmap_lock_init(&map->shards[i].lock) != 0) {                \
+                sc_map_term_##name(&map->shards[i].map);                       \
+                goto error;                                                    \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        return true;                                                           \
+                                                                               \
+    error:                                                                     \
+        while (i-- > 0) {                                                      \
+            sc_cmap_lock_term(&map->shards[i].lock);                           \
+            sc_map_term_##name(&map->shards[i].map);                           \
+        }                                                                      \
+                                                                               \
+        sc_map_free(map->mem);                                                 \
+        return false;                                                          \
+    }                                                                          \
+                                                                               \
+    void sc_cmap_term_##name(struct sc_cmap_##name *map)                       \
+    {                                                                          \
+        for (uint32_t i = 0; i < map->count; i++) {                            \
+            sc_cmap_lock_term(&map->shards[i].lock);                           \
+            sc_map_term_##name(&map->shards[i].map);                           \
+        }                                                                      \
+                                                                               \
+        sc_map_free(map->mem);                                                 \
+    }                                                                          \
+                                                                               \
+    uint32_t sc_cmap_size_##name(struct sc_cmap_##name *map)                   \
+    {                                                                          \
+        uint32_t size = 0;                                                     \
+                                                                               \
+        for (uint32_t i = 0; i < map->count; i++) {                            \
+            sc_cmap_lock(&map->shards[i].lock);                                \
+            size += sc_map_size_##name(&map->shards[i].map);                   \
+            sc_cmap_unlock(&map->shards[i].lock);                              \
+        }                                                                      \
+                                                                               \
+        return size;                                                           \
+    }                                                                          \
+                                                                               \
+    void sc_cmap_clear_##name(struct sc_cmap_##name *map)                      \
+    {                                                                          \
+        for (uint32_t i = 0; i < map->count; i++) {                            \
+            sc_cmap_lock(&map->shards[i].lock);                                \
+            sc_map_clear_##name(&map->shards[i].map);                          \
+            sc_cmap_unlock(&map->shards[i].lock);                              \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    bool sc_cmap_put_##name(struct sc_cmap_##name *map, K key, V value)        \
+    {                                                                          \
+        bool rc;                                                               \
+        const uint32_t h = sc_map_key_hash_##name(key);                        \
+        struct sc_cmap_shard_##name *s = sc_cmap_shard_##name(map, h);         \
+                                                                               \
+        sc_cmap_lock(&s->lock);                                                \
+        rc = sc_map_put_hash_##name(&s->map, key, value, h);                   \
+        sc_cmap_unlock(&s->lock);                                              \
+                                                                               \
+        return rc;                                                             \
+    }                                                                          \
+                                                                               \
+    bool sc_cmap_get_##name(struct sc_cmap_##name *map, K key, V *value)       \
+    {                                                                          \
+        bool rc;                                                               \
+        const uint32_t h = sc_map_key_hash_##name(key);                        \
+        struct sc_cmap_shard_##name *s = sc_cmap_shard_##name(map, h);         \
+                                                                               \
+        sc_cmap_lock(&s->lock);                                                \
+        rc = sc_map_get_hash_##name(&s->map, key, value, h);                   \
+        sc_cmap_unlock(&s->lock);                                              \
+                                                                               \
+        return rc;                                                             \
+    }                                                                          \
+                                                                               \
+    bool sc_cmap_del_##name(struct sc_cmap_##name *map, K key, V *value)       \
+    {                                                                          \
+        bool rc;                                                               \
+        const uint32_t h = sc_map_key_hash_##name(key);                        \
+        struct sc_cmap_shard_##name *s = sc_cmap_shard_##name(map, h);         \
+                                                                               \
+        sc_cmap_lock(&s->lock);                                                \
+        rc = sc_map_del_hash_##name(&s->map, key, value, h);                   \
+        sc_cmap_unlock(&s->lock);                                              \
+                                                                               \
+        return rc;                                                             \
+    }                                                                          \
+                                                                               \
+    bool sc_cmap_compute_##name(struct sc_cmap_##name *map, K key,             \
+                                V (*fn)(K key, void *arg), void *arg,          \
+                                V *value)                                      \
+    {                                                                          \
+        bool rc = true;                                                        \
+        V v;                                                                   \
+        const uint32_t h = sc_map_key_hash_##name(key);                        \
+        struct sc_cmap_shard_##name *s = sc_cmap_shard_##name(map, h);         \
+                                                                               \
+        sc_cmap_lock(&s->lock);                                                \
+        if (!sc_map_get_hash_##name(&s->map, key, &v, h)) {                    \
+            v = fn(key, arg);                                                  \
+            rc = sc_map_put_hash_##name(&s->map, key, v, h);                   \
+        }                                                                      \
+        sc_cmap_unlock(&s->lock);                                              \
+                                                                               \
+        if (rc && value != NULL) {                                             \
+            *value = v;                                                        \
+        }                                                                      \
+                                                                               \
+        return rc;                                                             \
+    }                                                                          \
+                                                                               \
+    struct sc_map_##name *sc_cmap_lock_##name(struct sc_cmap_##name *map,      \
+                                              uint32_t shard)                  \
+    {                                                                          \
+        assert(shard < map->count);                                            \
+                                                                               \
+        sc_cmap_lock(&map->shards[shard].lock);                                \
+        return &map->shards[shard].map;                                        \
+    }                                                                          \
+                                                                               \
+    void sc_cmap_unlock_##name(struct sc_cmap_##name *map, uint32_t shard)     \
+    {                                                                          \
+        assert(shard < map->count);                                            \
+                                                                               \
+        sc_cmap_unlock(&map->shards[shard].lock);                              \
+    }
+
+// clang-format off
+
+//             name, key type, value type
+sc_cmap_impl_of(32,  uint32_t, uint32_t)
+sc_cmap_impl_of(64,  uint64_t, uint64_t)
+sc_cmap_impl_of(64v, uint64_t, void *)
+sc_cmap_impl_of(64s, uint64_t, char *)
+sc_cmap_impl_of(str, char *,   char *)
+sc_cmap_impl_of(sv,  char *,   void *)
+sc_cmap_impl_of(s64, char *,   uint64_t)
+
+// clang-format on
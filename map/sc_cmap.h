@@ -0,0 +1,125 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SC_CMAP_H
+#define SC_CMAP_H
+
+#include "sc_map.h"
+
+#if defined(_WIN32) || defined(_WIN64)
+    #include <windows.h>
+#else
+    #include <pthread.h>
+#endif
+
+/**
+ * Concurrent map, keys are split into shards by hash. Each shard is a regular
+ * sc_map guarded by its own lock, so threads only contend when they touch the
+ * same shard. Shards are cache line aligned to avoid false sharing between
+ * locks.
+ */
+
+#define SC_CMAP_CACHE_LINE 64
+
+#if defined(_MSC_VER)
+    #define sc_cmap_aligned __declspec(align(SC_CMAP_CACHE_LINE))
+#else
+    #define sc_cmap_aligned __attribute__((aligned(SC_CMAP_CACHE_LINE)))
+#endif
+
+struct sc_cmap_lock
+{
+#if defined(_WIN32) || defined(_WIN64)
+    CRITICAL_SECTION mtx;
+#else
+    pthread_mutex_t mtx;
+#endif
+};
+
+#define sc_cmap_of(name, K, V)                                                 \
+    struct sc_cmap_aligned sc_cmap_shard_##name                                \
+    {                                                                          \
+        struct sc_cmap_lock lock;                                              \
+        struct sc_map_##name map;                                              \
+    };                                                                         \
+                                                                               \
+    struct sc_cmap_##name                                                      \
+    {                                                                          \
+        struct sc_cmap_shard_##name *shards;                                   \
+        void *mem;                                                             \
+        uint32_t count;                                                        \
+    };                                                                         \
+                                                                               \
+    bool sc_cmap_init_##name(struct sc_cmap_##name *map, uint32_t shards,      \
+                             uint32_t cap, uint32_t load_factor);              \
+    void sc_cmap_term_##name(struct sc_cmap_##name *map);                      \
+    uint32_t sc_cmap_size_##name(struct sc_cmap_##name *map);                  \
+    void sc_cmap_clear_##name(struct sc_cmap_##name *map);                     \
+    bool sc_cmap_put_##name(struct sc_cmap_##name *map, K key, V val);         \
+    bool sc_cmap_get_##name(struct sc_cmap_##name *map, K key, V *value);      \
+    bool sc_cmap_del_##name(struct sc_cmap_##name *map, K key, V *value);      \
+    bool sc_cmap_compute_##name(struct sc_cmap_##name *map, K key,             \
+                                V (*fn)(K key, void *arg), void *arg,          \
+                                V *value);                                     \
+    struct sc_map_##name *sc_cmap_lock_##name(struct sc_cmap_##name *map,      \
+                                              uint32_t shard);                 \
+    void sc_cmap_unlock_##name(struct sc_cmap_##name *map, uint32_t shard);
+
+/**
+ * sc_cmap_init_##name(map, shards, cap, load_factor) :
+ *      'shards' is rounded up to a power of two, '0' means 16 shards. 'cap' is
+ *      the total initial capacity, split evenly between shards.
+ *
+ * sc_cmap_compute_##name(map, key, fn, arg, value) :
+ *      If 'key' is missing, inserts 'fn(key, arg)'. 'fn' is called while the
+ *      shard lock is held. '*value' is set to the value in the map.
+ *      Returns 'false' on out of memory.
+ *
+ * sc_cmap_lock_##name(map, shard), sc_cmap_unlock_##name(map, shard) :
+ *      Per shard iteration. Lock returns the shard's map, any sc_map function
+ *      or foreach macro can be used on it until the shard is unlocked.
+ *
+ *      for (uint32_t i = 0; i < map.count; i++) {
+ *          struct sc_map_sv *m = sc_cmap_lock_sv(&map, i);
+ *          sc_map_foreach (m, key, value) {
+ *              printf("%s \n", key);
+ *          }
+ *          sc_cmap_unlock_sv(&map, i);
+ *      }
+ */
+
+// clang-format off
+
+//         name  key type  value type
+sc_cmap_of(32,  uint32_t, uint32_t)
+sc_cmap_of(64,  uint64_t, uint64_t)
+sc_cmap_of(64v, uint64_t, void *)
+sc_cmap_of(64s, uint64_t, char *)
+sc_cmap_of(str, char *,   char *)
+sc_cmap_of(sv,  char *,   void *)
+sc_cmap_of(s64, char *,   uint64_t)
+
+// clang-format on
+
+#endif
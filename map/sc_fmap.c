@@ -0,0 +1,624 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "sc_fmap.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32) || defined(_WIN64)
+    #define SC_FMAP_NO_MMAP
+    #include <fcntl.h>
+    #include <io.h>
+    #include <process.h>
+    #include <sys/stat.h>
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+// "scfmap" + byte order check, reads differently on the other byte order.
+#define SC_FMAP_MAGIC UINT64_C(0x0102706d61666373)
+
+#define SC_FMAP_KEY_64  1u
+#define SC_FMAP_KEY_STR 2u
+
+/**
+ * Hash functions are part of the image format, they must not change without a
+ * version bump. (murmur3 fmix64 and MurmurHash64A)
+ */
+static uint64_t sc_fmap_hash_64(uint64_t a)
+{
+    a ^= a >> 33u;
+    a *= UINT64_C(0xff51afd7ed558ccd);
+    a ^= a >> 33u;
+    a *= UINT64_C(0xc4ceb9fe1a85ec53);
+    a ^= a >> 33u;
+
+    return a;
+}
+
+// clang-format off
+static uint64_t sc_fmap_hash_str(const char *key, size_t len)
+{
+    const uint64_t m = UINT64_C(0xc6a4a7935bd1e995);
+    const char *end = key + (len & ~(size_t) 0x7);
+    uint64_t h = (len * m);
+
+    while (key != end) {
+        uint64_t k;
+        memcpy(&k, key, sizeof(k));
+
+        k *= m;
+        k ^= k >> 47u;
+        k *= m;
+
+        h ^= k;
+        h *= m;
+        key += 8;
+    }
+
+    switch (len & 7u) {
+    case 7: h ^= (uint64_t) (unsigned char) key[6] << 48ul; /* fall through */
+    case 6: h ^= (uint64_t) (unsigned char) key[5] << 40ul; /* fall through */
+    case 5: h ^= (uint64_t) (unsigned char) key[4] << 32ul; /* fall through */
+    case 4: h ^= (uint64_t) (unsigned char) key[3] << 24ul; /* fall through */
+    case 3: h ^= (uint64_t) (unsigned char) key[2] << 16ul; /* fall through */
+    case 2: h ^= (uint64_t) (unsigned char) key[1] << 8ul;  /* fall through */
+    case 1: h ^= (uint64_t) (unsigned char) key[0];
+        h *= m;
+    };
+
+    h ^= h >> 47u;
+    h *= m;
+    h ^= h >> 47u;
+
+    return h;
+}
+// clang-format on
+
+/**
+ * Key hooks. 64-bit keys are stored in the slot, string keys are stored in the
+ * arena, slot keeps the arena offset. Arena starts with a zero byte, so offset
+ * '0' marks an empty slot for both kinds.
+ */
+static size_t sc_fmap_keylen_64(uint64_t key)
+{
+    (void) key;
+    return 0;
+}
+
+static size_t sc_fmap_keylen_s64(const char *key)
+{
+    return strlen(key) + 1;
+}
+
+static uint64_t sc_fmap_place_64(struct sc_fmap_slot_64 *slots, uint64_t mask,
+                                 char *arena, size_t *pos, uint64_t key,
+                                 uint64_t value)
+{
+    uint64_t i = sc_fmap_hash_64(key) & mask;
+
+    (void) arena;
+    (void) pos;
+
+    while (slots[i].key != 0) {
+        i = (i + 1) & mask;
+    }
+
+    slots[i].key = key;
+    slots[i].value = value;
+
+    return i;
+}
+
+static uint64_t sc_fmap_place_s64(struct sc_fmap_slot_s64 *slots,
+                                  uint64_t mask, char *arena, size_t *pos,
+                                  const char *key, uint64_t value)
+{
+    size_t len = strlen(key);
+    uint64_t hash = sc_fmap_hash_str(key, len);
+    uint64_t i = hash & mask;
+
+    while (slots[i].key != 0) {
+        i = (i + 1) & mask;
+    }
+
+    memcpy(arena + *pos, key, len + 1);
+
+    slots[i].key = *pos;
+    slots[i].value = value;
+    slots[i].hash = (uint32_t) hash;
+    slots[i].len = (uint32_t) len;
+    *pos += len + 1;
+
+    return i;
+}
+
+static bool sc_fmap_find_64(const struct sc_fmap_hdr *hdr,
+                            const struct sc_fmap_slot_64 *slots,
+                            const char *arena, uint64_t key, uint64_t *value)
+{
+    const uint64_t mask = hdr->cap - 1;
+    uint64_t i = sc_fmap_hash_64(key) & mask;
+
+    (void) arena;
+
+    for (uint64_t n = 0; n < hdr->cap; n++) {
+        if (slots[i].key == 0) {
+            return false;
+        }
+
+        if (slots[i].key == key) {
+            *value = slots[i].value;
+            return true;
+        }
+
+        i = (i + 1) & mask;
+    }
+
+    return false;
+}
+
+static bool sc_fmap_find_s64(const struct sc_fmap_hdr *hdr,
+                             const struct sc_fmap_slot_s64 *slots,
+                             const char *arena, const char *key,
+                             uint64_t *value)
+{
+    const uint64_t mask = hdr->cap - 1;
+    const uint64_t arena_len = hdr->len - hdr->arena;
+    const size_t len = strlen(key);
+    const uint64_t hash = sc_fmap_hash_str(key, len);
+    const struct sc_fmap_slot_s64 *s;
+    uint64_t i = hash & mask;
+
+    for (uint64_t n = 0; n < hdr->cap; n++) {
+        s = &slots[i];
+        if (s->key == 0) {
+            return false;
+        }
+
+        // Hash and length are checked before touching the arena.
+        if (s->hash == (uint32_t) hash && s->len == len &&
+            s->key < arena_len && arena_len - s->key > len &&
+            memcmp(arena + s->key, key, len) == 0) {
+            *value = s->value;
+            return true;
+        }
+
+        i = (i + 1) & mask;
+    }
+
+    return false;
+}
+
+#if defined(_WIN32) || defined(_WIN64)
+
+static int sc_fmap_sync(FILE *fp)
+{
+    return _commit(_fileno(fp));
+}
+
+static bool sc_fmap_replace(const char *src, const char *dst)
+{
+    return MoveFileExA(src, dst, MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+static long sc_fmap_pid(void)
+{
+    return (long) _getpid();
+}
+
+static long sc_fmap_next_id(void)
+{
+    static volatile long id;
+    return InterlockedIncrement(&id);
+}
+
+static FILE *sc_fmap_create(const char *path)
+{
+    FILE *fp;
+    int fd = _open(path, _O_CREAT | _O_EXCL | _O_WRONLY | _O_BINARY,
+                   _S_IREAD | _S_IWRITE);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    fp = _fdopen(fd, "wb");
+    if (fp == NULL) {
+        _close(fd);
+        remove(path);
+    }
+
+    return fp;
+}
+
+#else
+
+static int sc_fmap_sync(FILE *fp)
+{
+    return fsync(fileno(fp));
+}
+
+static bool sc_fmap_replace(const char *src, const char *dst)
+{
+    return rename(src, dst) == 0;
+}
+
+static long sc_fmap_pid(void)
+{
+    return (long) getpid();
+}
+
+static long sc_fmap_next_id(void)
+{
+    static long id;
+    return __atomic_add_fetch(&id, 1, __ATOMIC_RELAXED);
+}
+
+static FILE *sc_fmap_create(const char *path)
+{
+    FILE *fp;
+    int fd = open(path, O_CREAT | O_EXCL | O_WRONLY, 0666);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    fp = fdopen(fd, "wb");
+    if (fp == NULL) {
+        close(fd);
+        remove(path);
+    }
+
+    return fp;
+}
+
+#endif
+
+/**
+ * Image is written to a temporary file next to 'path' and renamed over it.
+ * Processes that have the old file mapped keep reading the old image, a file
+ * truncated under a mapping would raise SIGBUS in them. Each call creates its
+ * own temporary file, so concurrent saves to the same path never write into
+ * the same file, the last rename wins.
+ */
+static bool sc_fmap_write(const char *path, const void *image, size_t len)
+{
+    bool rc = false;
+    size_t n;
+    FILE *fp;
+    char *tmp;
+    const size_t size = strlen(path) + 32;
+
+    tmp = sc_map_calloc(1, size);
+    if (tmp == NULL) {
+        sc_map_on_error("Out of memory. size(%zu).", size);
+        return false;
+    }
+
+    // Name is unique per call, a file left by a crashed process is skipped.
+    do {
+        snprintf(tmp, size, "%s.%ld.%ld.tmp", path, sc_fmap_pid(),
+                 sc_fmap_next_id());
+        fp = sc_fmap_create(tmp);
+    } while (fp == NULL && errno == EEXIST);
+
+    if (fp == NULL) {
+        sc_map_on_error("open : %s ", tmp);
+        goto out;
+    }
+
+    n = fwrite(image, 1, len, fp);
+    if (n != len || fflush(fp) != 0 || sc_fmap_sync(fp) != 0) {
+        sc_map_on_error("fwrite : %s ", tmp);
+        fclose(fp);
+        remove(tmp);
+        goto out;
+    }
+
+    if (fclose(fp) != 0) {
+        sc_map_on_error("fclose : %s ", tmp);
+        remove(tmp);
+        goto out;
+    }
+
+    if (!sc_fmap_replace(tmp, path)) {
+        sc_map_on_error("rename : %s ", path);
+        remove(tmp);
+        goto out;
+    }
+
+    rc = true;
+out:
+    sc_map_free(tmp);
+    return rc;
+}
+
+#if defined(SC_FMAP_NO_MMAP)
+
+static void *sc_fmap_map(const char *path, size_t *len)
+{
+    long size;
+    void *mem = NULL;
+    FILE *fp;
+
+    fp = fopen(path, "rb");
+    if (fp == NULL) {
+        sc_map_on_error("fopen : %s ", path);
+        return NULL;
+    }
+
+    if (fseek(fp, 0, SEEK_END) != 0 || (size = ftell(fp)) <= 0 ||
+        fseek(fp, 0, SEEK_SET) != 0) {
+        goto out;
+    }
+
+    mem = sc_map_calloc(1, (size_t) size);
+    if (mem == NULL) {
+        sc_map_on_error("Out of memory. size(%ld).", size);
+        goto out;
+    }
+
+    if (fread(mem, 1, (size_t) size, fp) != (size_t) size) {
+        sc_map_free(mem);
+        mem = NULL;
+        goto out;
+    }
+
+    *len = (size_t) size;
+out:
+    fclose(fp);
+    return mem;
+}
+
+static void sc_fmap_unmap(void *mem, size_t len)
+{
+    (void) len;
+    sc_map_free(mem);
+}
+
+#else
+
+static void *sc_fmap_map(const char *path, size_t *len)
+{
+    int fd;
+    void *mem;
+    struct stat st;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        sc_map_on_error("open : %s ", path);
+        return NULL;
+    }
+
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        sc_map_on_error("fstat : %s ", path);
+        close(fd);
+        return NULL;
+    }
+
+    mem = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (mem == MAP_FAILED) {
+        sc_map_on_error("mmap : %s ", path);
+        return NULL;
+    }
+
+    *len = (size_t) st.st_size;
+
+    return mem;
+}
+
+static void sc_fmap_unmap(void *mem, size_t len)
+{
+    munmap(mem, len);
+}
+
+#endif
+
+static bool sc_fmap_check(const void *image, size_t len, uint32_t kind,
+                          size_t slot_size)
+{
+    const struct sc_fmap_hdr *hdr = image;
+    uint64_t slots;
+
+    if (((uintptr_t) image % 8) != 0 || len < sizeof(*hdr) ||
+        hdr->magic != SC_FMAP_MAGIC || hdr->version != SC_FMAP_VERSION ||
+        hdr->kind != kind || hdr->len > len || hdr->cap == 0 ||
+        (hdr->cap & (hdr->cap - 1)) != 0 ||
+        hdr->cap > (UINT64_MAX - sizeof(*hdr)) / slot_size) {
+        return false;
+    }
+
+    slots = sizeof(*hdr) + (hdr->cap * slot_size);
+
+    return slots <= hdr->arena && hdr->arena <= hdr->len &&
+           hdr->size <= hdr->cap;
+}
+
+#define sc_fmap_impl_of(name, K, V, key_kind)                                  \
+                                                                               \
+    bool sc_fmap_freeze_##name(struct sc_map_##name *map, void **image,        \
+                               size_t *len)                                    \
+    {                                                                          \
+        K key;                                                                 \
+        V value;                                                               \
+        char *mem, *arena;                                                     \
+        size_t pos = 1, keys = 1;                                              \
+        uint64_t cap = 16, count = 0, total;                                   \
+        struct sc_fmap_hdr *hdr;                                               \
+        struct sc_fmap_slot_##name *slots;                                     \
+                                                                               \
+        sc_map_foreach (map, key, value) {                                     \
+            keys += sc_fmap_keylen_##name(key);                                \
+            count++;                                                           \
+            (void) value;                                                      \
+        }                                                                      \
+                                                                               \
+        /* Load factor is at most 50%, so probes stay short. */                \
+        while (cap < count * 2) {                                              \
+            cap *= 2;                                                          \
+        }                                                                      \
+                                                                               \
+        total = sizeof(*hdr) + (cap * sizeof(*slots)) + keys;                  \
+        if (total > SIZE_MAX) {                                                \
+            sc_map_on_error("Image is too large. len(%llu).",                  \
+                            (unsigned long long) total);                       \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        mem = sc_map_calloc(1, (size_t) total);                                \
+        if (mem == NULL) {                                                     \
+            sc_map_on_error("Out of memory. len(%llu).",                       \
+                            (unsigned long long) total);                       \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        hdr = (struct sc_fmap_hdr *) mem;                                      \
+        hdr->magic = SC_FMAP_MAGIC;                                            \
+        hdr->version = SC_FMAP_VERSION;                                        \
+        hdr->kind = key_kind;                                                  \
+        hdr->cap = cap;                                                        \
+        hdr->size = map->size;                                                 \
+        hdr->arena = total - keys;                                             \
+        hdr->len = total;                                                      \
+        hdr->zero_used = map->used;                                            \
+        hdr->zero_value = map->used ? (uint64_t) map->value : 0;               \
+                                                                               \
+        arena = mem + hdr->arena;                                              \
+        slots = (struct sc_fmap_slot_##name *) (hdr + 1);                      \
+        sc_map_foreach (map, key, value) {                                     \
+            sc_fmap_place_##name(slots, cap - 1, arena, &pos, key,             \
+                                 (uint64_t) value);                            \
+        }                                                                      \
+                                                                               \
+        *image = mem;                                                          \
+        *len = (size_t) total;                                                 \
+                                                                               \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    bool sc_fmap_save_##name(struct sc_map_##name *map, const char *path)      \
+    {                                                                          \
+        bool rc;                                                               \
+        size_t len;                                                            \
+        void *image;                                                           \
+                                                                               \
+        if (!sc_fmap_freeze_##name(map, &image, &len)) {                       \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        rc = sc_fmap_write(path, image, len);                                  \
+        sc_map_free(image);                                                    \
+                                                                               \
+        return rc;                                                             \
+    }                                                                          \
+                                                                               \
+    bool sc_fmap_open_##name(struct sc_fmap_##name *fmap, const void *image,   \
+                             size_t len)                                       \
+    {                                                                          \
+        const char *p = image;                                                 \
+                                                                               \
+        *fmap = (struct sc_fmap_##name){0};                                    \
+                                                                               \
+        if (!sc_fmap_check(image, len, key_kind, sizeof(*fmap->slots))) {      \
+            sc_map_on_error("Invalid image. len(%zu).", len);                  \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        fmap->hdr = image;                                                     \
+        fmap->slots = (const struct sc_fmap_slot_##name *) (fmap->hdr + 1);    \
+        fmap->arena = p + fmap->hdr->arena;                                    \
+                                                                               \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    bool sc_fmap_open_mmap_##name(struct sc_fmap_##name *fmap,                 \
+                                  const char *path)                            \
+    {                                                                          \
+        size_t len;                                                            \
+        void *mem;                                                             \
+                                                                               \
+        *fmap = (struct sc_fmap_##name){0};                                    \
+                                                                               \
+        mem = sc_fmap_map(path, &len);                                         \
+        if (mem == NULL) {                                                     \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        if (!sc_fmap_open_##name(fmap, mem, len)) {                            \
+            sc_fmap_unmap(mem, len);                                           \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        fmap->mem = mem;                                                       \
+        fmap->mem_len = len;                                                   \
+                                                                               \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    void sc_fmap_close_##name(struct sc_fmap_##name *fmap)                     \
+    {                                                                          \
+        if (fmap->mem != NULL) {                                               \
+            sc_fmap_unmap(fmap->mem, fmap->mem_len);                           \
+        }                                                                      \
+                                                                               \
+        *fmap = (struct sc_fmap_##name){0};                                    \
+    }                                                                          \
+                                                                               \
+    uint64_t sc_fmap_size_##name(struct sc_fmap_##name *fmap)                  \
+    {                                                                          \
+        return fmap->hdr->size;                                                \
+    }                                                                          \
+                                                                               \
+    bool sc_fmap_get_##name(struct sc_fmap_##name *fmap, K key, V *value)      \
+    {                                                                          \
+        uint64_t v;                                                            \
+                                                                               \
+        if (key == 0) {                                                        \
+            *value = (V) fmap->hdr->zero_value;                                \
+            return fmap->hdr->zero_used;                                       \
+        }                                                                      \
+                                                                               \
+        if (!sc_fmap_find_##name(fmap->hdr, fmap->slots, fmap->arena, key,     \
+                                 &v)) {                                        \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        *value = (V) v;                                                        \
+        return true;                                                           \
+    }
+
+// clang-format off
+
+//              name  key type  value type  key kind
+sc_fmap_impl_of(64,  uint64_t, uint64_t,   SC_FMAP_KEY_64)
+sc_fmap_impl_of(s64, char *,   uint64_t,   SC_FMAP_KEY_STR)
+
+// clang-format on
@@ -0,0 +1,129 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SC_FMAP_H
+#define SC_FMAP_H
+
+#include "sc_map.h"
+
+/**
+ * Frozen map, a read-only snapshot of an sc_map in a flat file image.
+ *
+ * Image is position independent : a header, an open addressing slot array and
+ * for string keys, an arena that holds the key bytes. Slots refer to keys by
+ * arena offset. An image can be served from memory or from a file mapped with
+ * mmap(), lookups work directly on the image, so opening costs the same for
+ * any map size and processes that map the same file share it through the page
+ * cache. On Windows, the file is read into memory instead.
+ *
+ * Images use the byte order of the machine that wrote them, opening an image
+ * from a machine with a different byte order fails.
+ */
+
+#define SC_FMAP_VERSION 1
+
+/**
+ * Internals, do not use
+ */
+struct sc_fmap_hdr
+{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t kind;
+    uint64_t cap;
+    uint64_t size;
+    uint64_t arena;
+    uint64_t len;
+    uint64_t zero_value;
+    uint32_t zero_used;
+    uint32_t reserved;
+};
+
+struct sc_fmap_slot_64
+{
+    uint64_t key;
+    uint64_t value;
+};
+
+struct sc_fmap_slot_s64
+{
+    uint64_t key;
+    uint64_t value;
+    uint32_t hash;
+    uint32_t len;
+};
+
+/**
+ * Internal End.
+ */
+
+#define sc_fmap_of(name, K, V)                                                 \
+    struct sc_fmap_##name                                                      \
+    {                                                                          \
+        const struct sc_fmap_hdr *hdr;                                         \
+        const struct sc_fmap_slot_##name *slots;                               \
+        const char *arena;                                                     \
+        void *mem;                                                             \
+        size_t mem_len;                                                        \
+    };                                                                         \
+                                                                               \
+    bool sc_fmap_freeze_##name(struct sc_map_##name *map, void **image,        \
+                               size_t *len);                                   \
+    bool sc_fmap_save_##name(struct sc_map_##name *map, const char *path);     \
+    bool sc_fmap_open_##name(struct sc_fmap_##name *fmap, const void *image,   \
+                             size_t len);                                      \
+    bool sc_fmap_open_mmap_##name(struct sc_fmap_##name *fmap,                 \
+                                  const char *path);                           \
+    void sc_fmap_close_##name(struct sc_fmap_##name *fmap);                    \
+    uint64_t sc_fmap_size_##name(struct sc_fmap_##name *fmap);                 \
+    bool sc_fmap_get_##name(struct sc_fmap_##name *fmap, K key, V *value);
+
+/**
+ * sc_fmap_freeze_##name(map, image, len) :
+ *      Creates an image of 'map', '*image' must be released with
+ *      sc_map_free().
+ *      Returns 'false' on out of memory.
+ *
+ * sc_fmap_save_##name(map, path) :
+ *      Writes an image of 'map' to the file at 'path'.
+ *
+ * sc_fmap_open_##name(fmap, image, len) :
+ *      Serves lookups from 'image', it is not copied and must stay valid until
+ *      the frozen map is closed. 'image' must be 8 bytes aligned.
+ *      Returns 'false' if the image is invalid.
+ *
+ * sc_fmap_open_mmap_##name(fmap, path) :
+ *      Maps the file at 'path' read-only and serves lookups from it.
+ *      Returns 'false' if the file can't be mapped or it is not a valid image.
+ */
+
+// clang-format off
+
+//         name  key type  value type
+sc_fmap_of(64,  uint64_t, uint64_t)
+sc_fmap_of(s64, char *,   uint64_t)
+
+// clang-format on
+
+#endif
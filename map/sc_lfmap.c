@@ -0,0 +1,748 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "sc_lfmap.h"
+
+#include <stdlib.h>
+
+#ifndef SC_SIZE_MAX
+    #define SC_SIZE_MAX UINT32_MAX
+#endif
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+
+// Plain loads and stores are acquire/release on x86 and x64.
+static uint64_t sc_lfmap_load(uint64_t *p)
+{
+    uint64_t v = *(volatile uint64_t *) p;
+    _ReadWriteBarrier();
+    return v;
+}
+
+static void sc_lfmap_store(uint64_t *p, uint64_t v)
+{
+    _InterlockedExchange64((volatile __int64 *) p, (__int64) v);
+}
+
+static bool sc_lfmap_cas(uint64_t *p, uint64_t *expected, uint64_t v)
+{
+    __int64 prev = _InterlockedCompareExchange64((volatile __int64 *) p,
+                                                 (__int64) v,
+                                                 (__int64) *expected);
+    if ((uint64_t) prev == *expected) {
+        return true;
+    }
+
+    *expected = (uint64_t) prev;
+    return false;
+}
+
+static uint64_t sc_lfmap_add(uint64_t *p, uint64_t v)
+{
+    return (uint64_t) _InterlockedExchangeAdd64((volatile __int64 *) p,
+                                                (__int64) v);
+}
+
+static uint64_t sc_lfmap_xchg(uint64_t *p, uint64_t v)
+{
+    return (uint64_t) _InterlockedExchange64((volatile __int64 *) p,
+                                             (__int64) v);
+}
+
+static void *sc_lfmap_load_ptr(void *p)
+{
+    void *v = *(void *volatile *) p;
+    _ReadWriteBarrier();
+    return v;
+}
+
+static bool sc_lfmap_cas_ptr(void *p, void *expected, void *v)
+{
+    void **exp = expected;
+    void *prev = _InterlockedCompareExchangePointer(p, v, *exp);
+    if (prev == *exp) {
+        return true;
+    }
+
+    *exp = prev;
+    return false;
+}
+
+static void *sc_lfmap_xchg_ptr(void *p, void *v)
+{
+    return _InterlockedExchangePointer(p, v);
+}
+
+#else
+
+    #define sc_lfmap_load(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+    #define sc_lfmap_store(p, v) __atomic_store_n((p), (v), __ATOMIC_SEQ_CST)
+    #define sc_lfmap_add(p, v)   __atomic_fetch_add((p), (v), __ATOMIC_SEQ_CST)
+    #define sc_lfmap_cas(p, exp, v)                                            \
+        __atomic_compare_exchange_n((p), (exp), (v), false, __ATOMIC_ACQ_REL,  \
+                                    __ATOMIC_ACQUIRE)
+
+    #define sc_lfmap_xchg(p, v)  __atomic_exchange_n((p), (v), __ATOMIC_SEQ_CST)
+
+    #define sc_lfmap_load_ptr(p)        sc_lfmap_load(p)
+    #define sc_lfmap_cas_ptr(p, exp, v) sc_lfmap_cas(p, exp, v)
+    #define sc_lfmap_xchg_ptr(p, v)                                            \
+        __atomic_exchange_n((p), (v), __ATOMIC_ACQ_REL)
+
+#endif
+
+/**
+ * Value encoding. Slots are zeroed on allocation, so '0' means the slot never
+ * had a value. User values are stored with an offset above the markers.
+ * During resize, a value is frozen by setting the top bit, a frozen value is
+ * still valid for readers but writers must help copying it into the next table
+ * and retry there. Once copied, the slot holds the forwarding marker.
+ */
+#define SC_LFMAP_NONE   UINT64_C(0)
+#define SC_LFMAP_TOMB   UINT64_C(1)
+#define SC_LFMAP_MOVED  UINT64_C(2)
+#define SC_LFMAP_FROZEN (UINT64_C(1) << 63u)
+
+#define sc_lfmap_enc(v)  ((v) + 3)
+#define sc_lfmap_dec(v)  (((v) & ~SC_LFMAP_FROZEN) - 3)
+#define sc_lfmap_live(v) ((v) > SC_LFMAP_MOVED)
+
+// Slots copied by a writer each time it helps an ongoing resize.
+#define SC_LFMAP_COPY_CHUNK 1024
+
+// Thread epoch value for offline threads.
+#define SC_LFMAP_OFFLINE UINT64_MAX
+
+static uint64_t sc_lfmap_hash(uint64_t a)
+{
+    a ^= a >> 33u;
+    a *= UINT64_C(0xff51afd7ed558ccd);
+    a ^= a >> 33u;
+    a *= UINT64_C(0xc4ceb9fe1a85ec53);
+    a ^= a >> 33u;
+
+    return a;
+}
+
+/**
+ * A key that doesn't fit into the first 'limit' slots from its home position
+ * goes to the next table. Readers use the same limit, so they never stop at an
+ * empty slot while the key lives in the next table.
+ */
+static uint64_t sc_lfmap_reprobe_limit(struct sc_lfmap_table *t)
+{
+    return 16 + (t->cap >> 2u);
+}
+
+static uint64_t sc_lfmap_threshold(struct sc_lfmap *m, struct sc_lfmap_table *t)
+{
+    return (t->cap * m->load_factor) / 100;
+}
+
+/**
+ * Returns zeroed, cache line aligned memory. '*mem' is the pointer to free.
+ */
+static void *sc_lfmap_alloc(size_t size, void **mem)
+{
+    uintptr_t p;
+
+    *mem = sc_lfmap_calloc(1, size + SC_LFMAP_CACHE_LINE);
+    if (*mem == NULL) {
+        return NULL;
+    }
+
+    p = ((uintptr_t) *mem + SC_LFMAP_CACHE_LINE - 1) &
+        ~((uintptr_t) SC_LFMAP_CACHE_LINE - 1);
+
+    return (void *) p;
+}
+
+static struct sc_lfmap_table *sc_lfmap_table_create(uint64_t cap)
+{
+    void *mem;
+    struct sc_lfmap_table *t;
+    const uint64_t max = (SC_SIZE_MAX - sizeof(*t) - SC_LFMAP_CACHE_LINE) /
+                         sizeof(t->slots[0]);
+
+    if (cap > max) {
+        sc_lfmap_on_error("Max capacity exceeded. cap(%llu).",
+                          (unsigned long long) cap);
+        return NULL;
+    }
+
+    t = sc_lfmap_alloc(sizeof(*t) + (cap * sizeof(t->slots[0])), &mem);
+    if (t == NULL) {
+        sc_lfmap_on_error("Out of memory. cap(%llu).",
+                          (unsigned long long) cap);
+        return NULL;
+    }
+
+    t->cap = cap;
+    t->mem = mem;
+
+    return t;
+}
+
+static void sc_lfmap_table_free(struct sc_lfmap_table *t)
+{
+    sc_lfmap_free(t->mem);
+}
+
+static void sc_lfmap_retire(struct sc_lfmap *m, struct sc_lfmap_table *t)
+{
+    struct sc_lfmap_table *head = sc_lfmap_load_ptr(&m->retired);
+
+    t->retire_epoch = sc_lfmap_add(&m->epoch, 1) + 1;
+
+    do {
+        t->retired = head;
+    } while (!sc_lfmap_cas_ptr(&m->retired, &head, t));
+}
+
+/**
+ * Tables are freed once every online thread has passed a quiescent state after
+ * the table was unlinked.
+ */
+static void sc_lfmap_reclaim(struct sc_lfmap *m)
+{
+    uint64_t min = SC_LFMAP_OFFLINE, epoch;
+    struct sc_lfmap_table *t, *next;
+
+    if (sc_lfmap_load_ptr(&m->retired) == NULL) {
+        return;
+    }
+
+    // Full barrier, thread epochs must be read after the retire epoch update.
+    sc_lfmap_add(&m->epoch, 0);
+
+    for (uint32_t i = 0; i < m->thread_count; i++) {
+        epoch = sc_lfmap_load(&m->threads[i].epoch);
+        min = epoch < min ? epoch : min;
+    }
+
+    t = sc_lfmap_xchg_ptr(&m->retired, NULL);
+    while (t != NULL) {
+        next = t->retired;
+
+        if (t->retire_epoch <= min) {
+            sc_lfmap_table_free(t);
+        } else {
+            t->retired = sc_lfmap_load_ptr(&m->retired);
+            while (!sc_lfmap_cas_ptr(&m->retired, &t->retired, t)) {
+            }
+        }
+
+        t = next;
+    }
+}
+
+/**
+ * Unlinks fully copied tables from the top.
+ */
+static void sc_lfmap_promote(struct sc_lfmap *m)
+{
+    struct sc_lfmap_table *t = sc_lfmap_load_ptr(&m->table);
+    struct sc_lfmap_table *next = sc_lfmap_load_ptr(&t->next);
+
+    while (next != NULL && sc_lfmap_load(&t->copied) == t->cap) {
+        if (!sc_lfmap_cas_ptr(&m->table, &t, next)) {
+            // Someone else promoted it, 't' is the current top now.
+            next = sc_lfmap_load_ptr(&t->next);
+            continue;
+        }
+
+        sc_lfmap_retire(m, t);
+        t = next;
+        next = sc_lfmap_load_ptr(&t->next);
+    }
+}
+
+/**
+ * Returns the table that replaces 't', creates it if it doesn't exist.
+ * New table is sized for the live item count, so a table full of tombstones
+ * is rehashed at the same capacity.
+ */
+static struct sc_lfmap_table *sc_lfmap_resize(struct sc_lfmap *m,
+                                              struct sc_lfmap_table *t)
+{
+    uint64_t cap = t->cap;
+    uint64_t size = sc_lfmap_load(&m->size);
+    struct sc_lfmap_table *next = sc_lfmap_load_ptr(&t->next);
+    struct sc_lfmap_table *expected = NULL;
+
+    if (next != NULL) {
+        return next;
+    }
+
+    while ((size * 2 * 100) / m->load_factor >= cap) {
+        cap *= 2;
+    }
+
+    next = sc_lfmap_table_create(cap);
+    if (next == NULL) {
+        return NULL;
+    }
+
+    if (!sc_lfmap_cas_ptr(&t->next, &expected, next)) {
+        sc_lfmap_table_free(next);
+        return expected;
+    }
+
+    return next;
+}
+
+static uint64_t sc_lfmap_put_impl(struct sc_lfmap *m, struct sc_lfmap_table *t,
+                                  uint64_t key, uint64_t hash, uint64_t val,
+                                  bool copy, bool *oom);
+
+static void sc_lfmap_copied(struct sc_lfmap *m, struct sc_lfmap_table *t)
+{
+    if (sc_lfmap_add(&t->copied, 1) + 1 == t->cap) {
+        sc_lfmap_promote(m);
+    }
+}
+
+/**
+ * Moves slot to the next table, returns when slot holds the forwarding marker.
+ * Value is frozen first, so it can't be modified while it is being copied.
+ * Copy is done with 'put if never written' semantics, if the key has been
+ * written or deleted in the next table already, that one is newer.
+ */
+static bool sc_lfmap_copy_slot(struct sc_lfmap *m, struct sc_lfmap_table *t,
+                               uint64_t idx)
+{
+    bool oom = false;
+    uint64_t key, v, frozen;
+    struct sc_lfmap_slot *slot = &t->slots[idx];
+    struct sc_lfmap_table *next = sc_lfmap_load_ptr(&t->next);
+
+    v = sc_lfmap_load(&slot->value);
+
+    while (true) {
+        if (v == SC_LFMAP_MOVED) {
+            return true;
+        }
+
+        if (v == SC_LFMAP_NONE || v == SC_LFMAP_TOMB) {
+            if (sc_lfmap_cas(&slot->value, &v, SC_LFMAP_MOVED)) {
+                sc_lfmap_copied(m, t);
+                return true;
+            }
+            continue;
+        }
+
+        if ((v & SC_LFMAP_FROZEN) == 0) {
+            if (!sc_lfmap_cas(&slot->value, &v, v | SC_LFMAP_FROZEN)) {
+                continue;
+            }
+            v |= SC_LFMAP_FROZEN;
+        }
+
+        key = sc_lfmap_load(&slot->key);
+        frozen = v & ~SC_LFMAP_FROZEN;
+
+        sc_lfmap_put_impl(m, next, key, sc_lfmap_hash(key), frozen, true, &oom);
+        if (oom) {
+            return false;
+        }
+
+        if (sc_lfmap_cas(&slot->value, &v, SC_LFMAP_MOVED)) {
+            sc_lfmap_copied(m, t);
+        }
+
+        return true;
+    }
+}
+
+/**
+ * Copies a chunk of the top table if there is an ongoing resize. After the
+ * first pass over the table, chunks are handed out again from the start, so
+ * slots left behind by a helper that ran out of memory are copied by a later
+ * one. Already copied slots are skipped with a single load.
+ */
+static bool sc_lfmap_help_copy(struct sc_lfmap *m)
+{
+    uint64_t pos, end;
+    struct sc_lfmap_table *t = sc_lfmap_load_ptr(&m->table);
+
+    if (sc_lfmap_load_ptr(&t->next) == NULL) {
+        return true;
+    }
+
+    if (sc_lfmap_load(&t->copied) != t->cap) {
+        pos = sc_lfmap_add(&t->copy_pos, SC_LFMAP_COPY_CHUNK) & (t->cap - 1);
+        end = pos + SC_LFMAP_COPY_CHUNK;
+        end = end < t->cap ? end : t->cap;
+
+        for (; pos < end; pos++) {
+            if (!sc_lfmap_copy_slot(m, t, pos)) {
+                return false;
+            }
+        }
+    }
+
+    sc_lfmap_promote(m);
+
+    return true;
+}
+
+/**
+ * Writes 'val' for 'key', returns previous value.
+ *
+ * val  : Encoded value or SC_LFMAP_TOMB to delete.
+ * copy : Write only if the slot has never been written, used by resize.
+ */
+static uint64_t sc_lfmap_put_impl(struct sc_lfmap *m, struct sc_lfmap_table *t,
+                                  uint64_t key, uint64_t hash, uint64_t val,
+                                  bool copy, bool *oom)
+{
+    uint64_t mask, idx, k, v, probes;
+    struct sc_lfmap_slot *slot;
+    struct sc_lfmap_table *next;
+
+retry:
+    mask = t->cap - 1;
+    idx = hash & mask;
+    probes = 0;
+
+    while (true) {
+        slot = &t->slots[idx];
+        k = sc_lfmap_load(&slot->key);
+
+        if (k == 0) {
+            if (val == SC_LFMAP_TOMB) {
+                return SC_LFMAP_NONE;
+            }
+
+            if (sc_lfmap_cas(&slot->key, &k, key)) {
+                sc_lfmap_add(&t->claimed, 1);
+                k = key;
+            }
+        }
+
+        if (k == key) {
+            break;
+        }
+
+        if (++probes >= sc_lfmap_reprobe_limit(t)) {
+            if (val == SC_LFMAP_TOMB &&
+                sc_lfmap_load_ptr(&t->next) == NULL) {
+                return SC_LFMAP_NONE;
+            }
+
+            t = sc_lfmap_resize(m, t);
+            if (t == NULL) {
+                *oom = true;
+                return SC_LFMAP_NONE;
+            }
+            goto retry;
+        }
+
+        idx = (idx + 1) & mask;
+    }
+
+    next = sc_lfmap_load_ptr(&t->next);
+    if (next == NULL && sc_lfmap_load(&t->claimed) > sc_lfmap_threshold(m, t)) {
+        // Out of memory is not fatal here, table has free slots.
+        next = sc_lfmap_resize(m, t);
+    }
+
+    if (next != NULL) {
+        if (!sc_lfmap_copy_slot(m, t, idx)) {
+            *oom = true;
+            return SC_LFMAP_NONE;
+        }
+        t = next;
+        goto retry;
+    }
+
+    v = sc_lfmap_load(&slot->value);
+
+    while (true) {
+        if (v == SC_LFMAP_MOVED || (v & SC_LFMAP_FROZEN)) {
+            if (!sc_lfmap_copy_slot(m, t, idx)) {
+                *oom = true;
+                return SC_LFMAP_NONE;
+            }
+            t = sc_lfmap_load_ptr(&t->next);
+            goto retry;
+        }
+
+        if (copy && v != SC_LFMAP_NONE) {
+            return v;
+        }
+
+        if (val == SC_LFMAP_TOMB && !sc_lfmap_live(v)) {
+            return v;
+        }
+
+        if (sc_lfmap_cas(&slot->value, &v, val)) {
+            return v;
+        }
+    }
+}
+
+static bool sc_lfmap_get_impl(struct sc_lfmap *m, uint64_t key, uint64_t *val)
+{
+    uint64_t mask, idx, k, v, probes, hash;
+    struct sc_lfmap_table *t;
+
+    if (key == 0) {
+        v = sc_lfmap_load(&m->zero);
+        *val = v;
+        return sc_lfmap_live(v);
+    }
+
+    hash = sc_lfmap_hash(key);
+    t = sc_lfmap_load_ptr(&m->table);
+
+retry:
+    mask = t->cap - 1;
+    idx = hash & mask;
+    probes = 0;
+
+    while (true) {
+        k = sc_lfmap_load(&t->slots[idx].key);
+        if (k == 0) {
+            return false;
+        }
+
+        if (k == key) {
+            v = sc_lfmap_load(&t->slots[idx].value);
+            if (v == SC_LFMAP_MOVED) {
+                t = sc_lfmap_load_ptr(&t->next);
+                goto retry;
+            }
+
+            *val = v;
+            return sc_lfmap_live(v);
+        }
+
+        if (++probes >= sc_lfmap_reprobe_limit(t)) {
+            t = sc_lfmap_load_ptr(&t->next);
+            if (t == NULL) {
+                return false;
+            }
+            goto retry;
+        }
+
+        idx = (idx + 1) & mask;
+    }
+}
+
+static bool sc_lfmap_write(struct sc_lfmap *m, uint64_t key, uint64_t val,
+                           uint64_t *prev)
+{
+    bool oom = false;
+    uint64_t v;
+
+    if (key == 0) {
+        v = sc_lfmap_xchg(&m->zero, val);
+    } else {
+        if (!sc_lfmap_help_copy(m)) {
+            return false;
+        }
+
+        v = sc_lfmap_put_impl(m, sc_lfmap_load_ptr(&m->table), key,
+                              sc_lfmap_hash(key), val, false, &oom);
+        if (oom) {
+            return false;
+        }
+    }
+
+    if (sc_lfmap_live(v) != sc_lfmap_live(val)) {
+        sc_lfmap_add(&m->size, sc_lfmap_live(val) ? 1 : (uint64_t) -1);
+    }
+
+    *prev = v;
+
+    return true;
+}
+
+static bool sc_lfmap_init(struct sc_lfmap *m, uint64_t cap,
+                          uint32_t load_factor, uint32_t threads)
+{
+    uint64_t v = cap < 16 ? 16 : cap;
+    uint32_t f = load_factor == 0 ? 75 : load_factor;
+
+    *m = (struct sc_lfmap){0};
+
+    if (f < 25 || f > 95) {
+        sc_lfmap_on_error("Invalid load factor. load_factor(%u).", f);
+        return false;
+    }
+
+    if (cap > SC_SIZE_MAX / sizeof(struct sc_lfmap_slot)) {
+        sc_lfmap_on_error("Max capacity exceeded. cap(%llu).",
+                          (unsigned long long) cap);
+        return false;
+    }
+
+    // Find next power of two
+    v--;
+    for (uint32_t i = 1; i < sizeof(v) * 8; i *= 2) {
+        v |= v >> i;
+    }
+    v++;
+
+    if (threads >= SC_SIZE_MAX / sizeof(*m->threads)) {
+        sc_lfmap_on_error("Too many threads. threads(%u).", threads);
+        return false;
+    }
+
+    m->threads = sc_lfmap_alloc((threads + 1) * sizeof(*m->threads),
+                                &m->threads_mem);
+    if (m->threads == NULL) {
+        sc_lfmap_on_error("Out of memory. threads(%u).", threads);
+        return false;
+    }
+
+    m->table = sc_lfmap_table_create(v);
+    if (m->table == NULL) {
+        sc_lfmap_free(m->threads_mem);
+        return false;
+    }
+
+    m->thread_count = threads;
+    m->load_factor = f;
+
+    return true;
+}
+
+static void sc_lfmap_term(struct sc_lfmap *m)
+{
+    struct sc_lfmap_table *t, *next;
+
+    for (t = m->table; t != NULL; t = next) {
+        next = t->next;
+        sc_lfmap_table_free(t);
+    }
+
+    for (t = m->retired; t != NULL; t = next) {
+        next = t->retired;
+        sc_lfmap_table_free(t);
+    }
+
+    sc_lfmap_free(m->threads_mem);
+    *m = (struct sc_lfmap){0};
+}
+
+static void sc_lfmap_quiescent(struct sc_lfmap *m, uint32_t thread)
+{
+    // Exchange is a full barrier, table must be read after the epoch update.
+    sc_lfmap_xchg(&m->threads[thread].epoch, sc_lfmap_load(&m->epoch));
+    sc_lfmap_reclaim(m);
+}
+
+static void sc_lfmap_offline(struct sc_lfmap *m, uint32_t thread)
+{
+    sc_lfmap_store(&m->threads[thread].epoch, SC_LFMAP_OFFLINE);
+    sc_lfmap_reclaim(m);
+}
+
+#define sc_lfmap_impl_of(name, V, to_u64, from_u64)                            \
+                                                                               \
+    bool sc_lfmap_init_##name(struct sc_lfmap_##name *map, uint64_t cap,       \
+                              uint32_t load_factor, uint32_t threads)          \
+    {                                                                          \
+        return sc_lfmap_init(&map->lf, cap, load_factor, threads);             \
+    }                                                                          \
+                                                                               \
+    void sc_lfmap_term_##name(struct sc_lfmap_##name *map)                     \
+    {                                                                          \
+        sc_lfmap_term(&map->lf);                                               \
+    }                                                                          \
+                                                                               \
+    uint64_t sc_lfmap_size_##name(struct sc_lfmap_##name *map)                 \
+    {                                                                          \
+        return sc_lfmap_load(&map->lf.size);                                   \
+    }                                                                          \
+                                                                               \
+    bool sc_lfmap_put_##name(struct sc_lfmap_##name *map, uint64_t key,        \
+                             V value)                                          \
+    {                                                                          \
+        uint64_t prev, v = to_u64(value);                                      \
+                                                                               \
+        if (v > SC_LFMAP_VALUE_MAX) {                                          \
+            sc_lfmap_on_error("Value out of range. value(%llu).",              \
+                              (unsigned long long) v);                         \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        return sc_lfmap_write(&map->lf, key, sc_lfmap_enc(v), &prev);          \
+    }                                                                          \
+                                                                               \
+    bool sc_lfmap_get_##name(struct sc_lfmap_##name *map, uint64_t key,        \
+                             V *value)                                         \
+    {                                                                          \
+        uint64_t v;                                                            \
+                                                                               \
+        if (!sc_lfmap_get_impl(&map->lf, key, &v)) {                           \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        *value = from_u64(sc_lfmap_dec(v));                                    \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    bool sc_lfmap_del_##name(struct sc_lfmap_##name *map, uint64_t key,        \
+                             V *value)                                         \
+    {                                                                          \
+        uint64_t prev;                                                         \
+                                                                               \
+        if (!sc_lfmap_write(&map->lf, key, SC_LFMAP_TOMB, &prev) ||            \
+            !sc_lfmap_live(prev)) {                                            \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        if (value != NULL) {                                                   \
+            *value = from_u64(sc_lfmap_dec(prev));                             \
+        }                                                                      \
+                                                                               \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    void sc_lfmap_quiescent_##name(struct sc_lfmap_##name *map,                \
+                                   uint32_t thread)                            \
+    {                                                                          \
+        sc_lfmap_quiescent(&map->lf, thread);                                  \
+    }                                                                          \
+                                                                               \
+    void sc_lfmap_offline_##name(struct sc_lfmap_##name *map, uint32_t thread) \
+    {                                                                          \
+        sc_lfmap_offline(&map->lf, thread);                                    \
+    }
+
+#define sc_lfmap_u64(v)      ((uint64_t) (v))
+#define sc_lfmap_to_ptr(v)   ((void *) (uintptr_t) (v))
+#define sc_lfmap_from_ptr(v) ((uint64_t) (uintptr_t) (v))
+
+// clang-format off
+
+//               name  value type  to uint64_t        from uint64_t
+sc_lfmap_impl_of(64,   uint64_t,   sc_lfmap_u64,      sc_lfmap_u64)
+sc_lfmap_impl_of(64v,  void *,     sc_lfmap_from_ptr, sc_lfmap_to_ptr)
+
+// clang-format on
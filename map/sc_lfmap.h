@@ -0,0 +1,187 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SC_LFMAP_H
+#define SC_LFMAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Concurrent open addressing map for 64-bit keys, for read-mostly tables.
+ *
+ * - Lookups never lock or write shared memory, they are plain atomic loads.
+ * - Inserts claim a key slot with CAS, values are replaced with CAS.
+ * - Deleted entries leave a tombstone, slots are reclaimed on the next resize.
+ * - Resize is cooperative : writers copy chunks of the old table into the new
+ *   one. Copied slots hold a forwarding marker, so readers follow them into
+ *   the new table.
+ * - Old tables are freed with quiescent state based reclamation. Each thread
+ *   that uses the map has an id in [0, threads) and calls
+ *   sc_lfmap_quiescent_##name() when it is between map operations, e.g. once
+ *   per event loop iteration. A thread that stops using the map should call
+ *   sc_lfmap_offline_##name(). Until all threads pass a quiescent state, old
+ *   tables are kept, they are always freed by sc_lfmap_term_##name().
+ *
+ * Values must not be greater than SC_LFMAP_VALUE_MAX, the rest of the range
+ * is used for internal markers. For 64v maps, pointers with the top bit set
+ * are out of range, e.g. tagged pointers on arm64 (Android heap pointers,
+ * pointer authentication) or kernel addresses. Strip tags before put.
+ */
+
+#define SC_LFMAP_VALUE_MAX ((UINT64_C(1) << 63u) - 4)
+
+/**
+ * Internals, do not use
+ */
+
+/**
+ * Fields read by every lookup are kept on their own cache line, apart from
+ * the counters writers update on every put and del. sc_lfmap is cache line
+ * aligned for that, if it is allocated on the heap, use an aligned allocator.
+ */
+#define SC_LFMAP_CACHE_LINE 64
+
+#if defined(_MSC_VER)
+    #define sc_lfmap_aligned __declspec(align(SC_LFMAP_CACHE_LINE))
+#else
+    #define sc_lfmap_aligned __attribute__((aligned(SC_LFMAP_CACHE_LINE)))
+#endif
+
+struct sc_lfmap_slot
+{
+    uint64_t key;
+    uint64_t value;
+};
+
+struct sc_lfmap_table
+{
+    // Read by lookups
+    struct sc_lfmap_table *next;
+    uint64_t cap;
+
+    // Written once, when the table is retired
+    struct sc_lfmap_table *retired;
+    uint64_t retire_epoch;
+    void *mem;
+    uint8_t pad0[SC_LFMAP_CACHE_LINE - (3 * sizeof(void *)) -
+                 (2 * sizeof(uint64_t))];
+
+    // Updated by writers
+    uint64_t claimed;
+    uint64_t copy_pos;
+    uint64_t copied;
+    uint8_t pad1[SC_LFMAP_CACHE_LINE - (3 * sizeof(uint64_t))];
+
+    struct sc_lfmap_slot slots[];
+};
+
+struct sc_lfmap_thread
+{
+    uint64_t epoch;
+    uint8_t pad[SC_LFMAP_CACHE_LINE - sizeof(uint64_t)];
+};
+
+struct sc_lfmap_aligned sc_lfmap
+{
+    // Read by lookups, 'table' changes once per resize
+    struct sc_lfmap_table *table;
+    struct sc_lfmap_thread *threads;
+    void *threads_mem;
+    uint32_t thread_count;
+    uint32_t load_factor;
+    uint8_t pad0[SC_LFMAP_CACHE_LINE - (3 * sizeof(void *)) -
+                 (2 * sizeof(uint32_t))];
+
+    // Updated by every put and del that adds or removes an item
+    uint64_t size;
+    uint8_t pad1[SC_LFMAP_CACHE_LINE - sizeof(uint64_t)];
+
+    // Reclamation and key '0'
+    struct sc_lfmap_table *retired;
+    uint64_t epoch;
+    uint64_t zero;
+};
+
+/**
+ * Internal End.
+ */
+
+#define sc_lfmap_of(name, V)                                                   \
+    struct sc_lfmap_##name                                                     \
+    {                                                                          \
+        struct sc_lfmap lf;                                                    \
+    };                                                                         \
+                                                                               \
+    bool sc_lfmap_init_##name(struct sc_lfmap_##name *map, uint64_t cap,       \
+                              uint32_t load_factor, uint32_t threads);         \
+    void sc_lfmap_term_##name(struct sc_lfmap_##name *map);                    \
+    uint64_t sc_lfmap_size_##name(struct sc_lfmap_##name *map);                \
+    bool sc_lfmap_put_##name(struct sc_lfmap_##name *map, uint64_t key,        \
+                             V value);                                         \
+    bool sc_lfmap_get_##name(struct sc_lfmap_##name *map, uint64_t key,        \
+                             V *value);                                        \
+    bool sc_lfmap_del_##name(struct sc_lfmap_##name *map, uint64_t key,        \
+                             V *value);                                        \
+    void sc_lfmap_quiescent_##name(struct sc_lfmap_##name *map,                \
+                                   uint32_t thread);                           \
+    void sc_lfmap_offline_##name(struct sc_lfmap_##name *map, uint32_t thread);
+
+/**
+ * sc_lfmap_init_##name(map, cap, load_factor, threads) :
+ *      'load_factor' is in [25, 95], '0' means 75. 'threads' is the number of
+ *      thread ids that will be passed to quiescent/offline functions.
+ *      Returns 'false' on out of memory.
+ *
+ * sc_lfmap_put_##name(map, key, value) :
+ *      Returns 'false' on out of memory or if 'value' is out of range.
+ *
+ * sc_lfmap_size_##name(map) :
+ *      Returns item count, it may be stale if there are concurrent writers.
+ *
+ * sc_lfmap_term_##name(map) :
+ *      Must not be called concurrently with other functions.
+ */
+
+// clang-format off
+
+//          name  value type
+sc_lfmap_of(64,  uint64_t)
+sc_lfmap_of(64v, void *)
+
+// clang-format on
+
+/**
+* If you want to log or abort on errors like out of memory,
+* put your error function here. It will be called with printf like error msg.
+*
+* my_on_error(const char* fmt, ...);
+*/
+#define sc_lfmap_on_error(...)
+
+#define sc_lfmap_calloc calloc
+#define sc_lfmap_free   free
+
+#endif
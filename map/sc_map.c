@@ -1,5 +1,6 @@
 #include "sc_map.h"
 
+#include <assert.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -7,6 +8,242 @@
     #define SC_SIZE_MAX UINT32_MAX
 #endif
 
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+        (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define SC_MAP_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define SC_MAP_NEON
+#endif
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+    #define sc_map_prefetch(p) __builtin_prefetch(p)
+#elif defined(SC_MAP_SSE2)
+    #define sc_map_prefetch(p) _mm_prefetch((const char *) (p), _MM_HINT_T0)
+#else
+    #define sc_map_prefetch(p) ((void) (p))
+#endif
+
+// Keys hashed and prefetched ahead of probing by sc_map_get_batch_##name().
+#define SC_MAP_BATCH 32u
+
+#ifdef SC_MAP_STATS
+    #if defined(_WIN32) || defined(_WIN64)
+        #include <windows.h>
+    #else
+        #include <time.h>
+    #endif
+
+    #define sc_map_stat(...) __VA_ARGS__
+
+static uint64_t sc_map_time_ns(void)
+{
+    #if defined(_WIN32) || defined(_WIN64)
+    LARGE_INTEGER freq, count;
+
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+
+    return (uint64_t)(count.QuadPart * 1000000000 / freq.QuadPart);
+    #else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec);
+    #endif
+}
+
+    #define sc_map_stats_impl(name, robin)                                     \
+                                                                               \
+        /* Returns slots visited by a lookup of 'hash' that stopped at 'pos',  \
+         * or for a miss, at the first empty slot. */                          \
+        static uint64_t sc_map_probes_##name(struct sc_map_item_##name *mem,   \
+                                             uint32_t mod, uint32_t hash,      \
+                                             uint32_t pos)                     \
+        {                                                                      \
+            const uint32_t home = hash & mod;                                  \
+            uint32_t dist = 0;                                                 \
+                                                                               \
+            if (pos == UINT32_MAX) {                                           \
+                pos = home;                                                    \
+                while (mem[pos].key != 0 &&                                    \
+                       (!(robin) ||                                            \
+                        sc_map_dist_##name(mem, mod, pos) >= dist)) {          \
+                    pos = (pos + 1) & mod;                                     \
+                    dist++;                                                    \
+                }                                                              \
+            }                                                                  \
+                                                                               \
+            return ((pos - home) & mod) + 1;                                   \
+        }                                                                      \
+                                                                               \
+        static void sc_map_stats_get_##name(struct sc_map_##name *map,         \
+                                            struct sc_map_item_##name *mem,    \
+                                            uint32_t mod, uint32_t hash,       \
+                                            uint32_t pos)                      \
+        {                                                                      \
+            uint64_t n = sc_map_probes_##name(mem, mod, hash, pos);            \
+                                                                               \
+            map->stats.gets++;                                                 \
+            map->stats.get_probes += n;                                        \
+            if (n > map->stats.get_max) {                                      \
+                map->stats.get_max = n;                                        \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        static void sc_map_stats_put_##name(struct sc_map_##name *map,         \
+                                            struct sc_map_item_##name *mem,    \
+                                            uint32_t mod, uint32_t hash,       \
+                                            uint32_t pos)                      \
+        {                                                                      \
+            uint64_t n = sc_map_probes_##name(mem, mod, hash, pos);            \
+                                                                               \
+            map->stats.puts++;                                                 \
+            map->stats.put_probes += n;                                        \
+            if (n > map->stats.put_max) {                                      \
+                map->stats.put_max = n;                                        \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        static void sc_map_stats_hist_##name(struct sc_map_stats *stats,       \
+                                             struct sc_map_item_##name *mem,   \
+                                             uint32_t cap)                     \
+        {                                                                      \
+            uint32_t d;                                                        \
+                                                                               \
+            for (uint32_t i = 0; i < cap; i++) {                               \
+                if (mem[i].key != 0) {                                         \
+                    d = (i - sc_map_hashof_##name(&mem[i])) & (cap - 1);       \
+                    d = d < SC_MAP_STATS_HIST ? d : SC_MAP_STATS_HIST - 1;     \
+                    stats->hist[d]++;                                          \
+                }                                                              \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        void sc_map_stats_##name(struct sc_map_##name *map,                    \
+                                 struct sc_map_stats *stats)                   \
+        {                                                                      \
+            *stats = map->stats;                                               \
+            stats->bytes = sc_map_mem_usage_##name(map);                       \
+            stats->size = map->size;                                           \
+            stats->cap = map->cap + map->old_cap;                              \
+            memset(stats->hist, 0, sizeof(stats->hist));                       \
+                                                                               \
+            sc_map_stats_hist_##name(stats, map->mem, map->cap);               \
+            if (map->old != NULL) {                                            \
+                sc_map_stats_hist_##name(stats, map->old, map->old_cap);       \
+            }                                                                  \
+        }
+#else
+    #define sc_map_stat(...)
+    #define sc_map_stats_impl(name, robin)
+#endif
+
+/**
+ * Returns true if there is a low water mark and load is below it.
+ */
+static bool sc_map_below(uint32_t size, uint32_t cap, uint32_t low_water)
+{
+    return low_water != 0 && (uint64_t) size * 100 < (uint64_t) cap * low_water;
+}
+
+#if defined(_WIN32) || defined(_WIN64)
+    #include <process.h>
+    #include <windows.h>
+
+struct sc_map_thread
+{
+    HANDLE id;
+    void (*fn)(void *);
+    void *arg;
+};
+
+static unsigned int __stdcall sc_map_thread_fn(void *arg)
+{
+    struct sc_map_thread *t = arg;
+
+    t->fn(t->arg);
+    return 0;
+}
+
+static bool sc_map_thread_start(struct sc_map_thread *t)
+{
+    t->id = (HANDLE) _beginthreadex(NULL, 0, sc_map_thread_fn, t, 0, NULL);
+    return t->id != 0;
+}
+
+static void sc_map_thread_join(struct sc_map_thread *t)
+{
+    WaitForSingleObject(t->id, INFINITE);
+    CloseHandle(t->id);
+}
+
+#else
+    #include <pthread.h>
+
+struct sc_map_thread
+{
+    pthread_t id;
+    void (*fn)(void *);
+    void *arg;
+};
+
+static void *sc_map_thread_fn(void *arg)
+{
+    struct sc_map_thread *t = arg;
+
+    t->fn(t->arg);
+    return NULL;
+}
+
+static bool sc_map_thread_start(struct sc_map_thread *t)
+{
+    return pthread_create(&t->id, NULL, sc_map_thread_fn, t) == 0;
+}
+
+static void sc_map_thread_join(struct sc_map_thread *t)
+{
+    int rc;
+
+    rc = pthread_join(t->id, NULL);
+    assert(rc == 0);
+    (void) rc;
+}
+
+#endif
+
+/**
+ * Calls fn() for each of the 'n' structs in 'args', each struct is 'size'
+ * bytes. The first one runs in the calling thread, the others in new threads.
+ * If a thread cannot be started, its call runs in the calling thread.
+ */
+static void sc_map_run(void (*fn)(void *), void *args, size_t size, uint32_t n)
+{
+    bool started[SC_MAP_BUILD_THREADS] = {false};
+    struct sc_map_thread t[SC_MAP_BUILD_THREADS];
+
+    for (uint32_t i = 1; i < n; i++) {
+        t[i].fn = fn;
+        t[i].arg = (char *) args + i * size;
+        started[i] = sc_map_thread_start(&t[i]);
+    }
+
+    fn(args);
+
+    for (uint32_t i = 1; i < n; i++) {
+        if (started[i]) {
+            sc_map_thread_join(&t[i]);
+        } else {
+            fn(t[i].arg);
+        }
+    }
+}
+
 #define sc_map_impl_of_strkey(name, K, V, cmp, hash_fn)                        \
     bool sc_map_cmp_##name(struct sc_map_item_##name *t, K key, uint32_t hash) \
     {                                                                          \
@@ -16,108 +253,1815 @@
     void sc_map_assign_##name(struct sc_map_item_##name *t, K key, V value,    \
                               uint32_t hash)                                   \
     {                                                                          \
-        t->key = key;                                                          \
-        t->value = value;                                                      \
-        t->hash = hash;                                                        \
+        t->key = key;                                                          \
+        t->value = value;                                                      \
+        t->hash = hash;                                                        \
+    }                                                                          \
+                                                                               \
+    uint32_t sc_map_hashof_##name(struct sc_map_item_##name *t)                \
+    {                                                                          \
+        return t->hash;                                                        \
+    }                                                                          \
+                                                                               \
+    void sc_map_move_##name(struct sc_map_item_##name *dst,                    \
+                            struct sc_map_item_##name *src)                    \
+    {                                                                          \
+        *dst = *src;                                                           \
+    }                                                                          \
+                                                                               \
+    uint32_t sc_map_key_hash_##name(K key)                                     \
+    {                                                                          \
+        return key != 0 ? hash_fn(key) : 0;                                    \
+    }                                                                          \
+                                                                               \
+    sc_map_impl_of(name, K, V, cmp, hash_fn, 0)
+
+#define sc_map_impl_of_robin(name, K, V, cmp, hash_fn)                         \
+    bool sc_map_cmp_##name(struct sc_map_item_##name *t, K key, uint32_t hash) \
+    {                                                                          \
+        return cmp(t->key, key);                                               \
+    }                                                                          \
+                                                                               \
+    void sc_map_assign_##name(struct sc_map_item_##name *t, K key, V value,    \
+                              uint32_t hash)                                   \
+    {                                                                          \
+        t->key = key;                                                          \
+        t->value = value;                                                      \
+    }                                                                          \
+                                                                               \
+    uint32_t sc_map_hashof_##name(struct sc_map_item_##name *t)                \
+    {                                                                          \
+        return hash_fn(t->key);                                                \
+    }                                                                          \
+                                                                               \
+    void sc_map_move_##name(struct sc_map_item_##name *dst,                    \
+                            struct sc_map_item_##name *src)                    \
+    {                                                                          \
+        *dst = *src;                                                           \
+    }                                                                          \
+                                                                               \
+    uint32_t sc_map_key_hash_##name(K key)                                     \
+    {                                                                          \
+        return key != 0 ? hash_fn(key) : 0;                                    \
+    }                                                                          \
+                                                                               \
+    sc_map_impl_of(name, K, V, cmp, hash_fn, 1)
+
+#define sc_map_impl_of_lenkey(name, K, V, cmp, hash_fn)                        \
+    bool sc_map_cmp_##name(struct sc_map_item_##name *t, K key, uint32_t hash) \
+    {                                                                          \
+        uint32_t len = sc_map_sc_str_len(key);                                 \
+        return t->hash == hash && t->len == len && cmp(t->key, key, len);      \
+    }                                                                          \
+                                                                               \
+    void sc_map_assign_##name(struct sc_map_item_##name *t, K key, V value,    \
+                              uint32_t hash)                                   \
+    {                                                                          \
+        t->key = key;                                                          \
+        t->value = value;                                                      \
+        t->hash = hash;                                                        \
+        t->len = sc_map_sc_str_len(key);                                       \
+    }                                                                          \
+                                                                               \
+    uint32_t sc_map_hashof_##name(struct sc_map_item_##name *t)                \
+    {                                                                          \
+        return t->hash;                                                        \
+    }                                                                          \
+                                                                               \
+    void sc_map_move_##name(struct sc_map_item_##name *dst,                    \
+                            struct sc_map_item_##name *src)                    \
+    {                                                                          \
+        *dst = *src;                                                           \
+    }                                                                          \
+                                                                               \
+    uint32_t sc_map_key_hash_##name(K key)                                     \
+    {                                                                          \
+        return key != 0 ? hash_fn(key) : 0;                                    \
+    }                                                                          \
+                                                                               \
+    sc_map_impl_of(name, K, V, cmp, hash_fn, 0)
+
+/**
+ * Short keys are copied into the slot and 'key' points to the copy. Slot moves
+ * must fix up that pointer, see sc_map_move_##name().
+ */
+#define sc_map_impl_of_inline(name, K, V, cmp, hash_fn)                        \
+    bool sc_map_cmp_##name(struct sc_map_item_##name *t, K key, uint32_t hash) \
+    {                                                                          \
+        return t->hash == hash && cmp(t->key, key);                            \
+    }                                                                          \
+                                                                               \
+    void sc_map_assign_##name(struct sc_map_item_##name *t, K key, V value,    \
+                              uint32_t hash)                                   \
+    {                                                                          \
+        size_t len = strlen(key);                                              \
+                                                                               \
+        t->key = key;                                                          \
+        if (len < SC_MAP_INLINE) {                                             \
+            memcpy(t->buf, key, len + 1);                                      \
+            t->key = t->buf;                                                   \
+        }                                                                      \
+                                                                               \
+        t->value = value;                                                      \
+        t->hash = hash;                                                        \
+    }                                                                          \
+                                                                               \
+    uint32_t sc_map_hashof_##name(struct sc_map_item_##name *t)                \
+    {                                                                          \
+        return t->hash;                                                        \
+    }                                                                          \
+                                                                               \
+    void sc_map_move_##name(struct sc_map_item_##name *dst,                    \
+                            struct sc_map_item_##name *src)                    \
+    {                                                                          \
+        *dst = *src;                                                           \
+        if (src->key == src->buf) {                                            \
+            dst->key = dst->buf;                                               \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    uint32_t sc_map_key_hash_##name(K key)                                     \
+    {                                                                          \
+        return key != 0 ? hash_fn(key) : 0;                                    \
+    }                                                                          \
+                                                                               \
+    sc_map_impl_of(name, K, V, cmp, hash_fn, 0)
+
+/**
+ * Hash of scalar maps is sc_map_key_hash_##name(), generated in sc_map.h from
+ * the 'hash_fn' given to sc_map_of_scalar(), so it is defined in one place.
+ */
+#define sc_map_impl_of_scalar(name, K, V, cmp)                                 \
+    bool sc_map_cmp_##name(struct sc_map_item_##name *t, K key, uint32_t hash) \
+    {                                                                          \
+        return cmp(t->key, key);                                               \
+    }                                                                          \
+                                                                               \
+    void sc_map_assign_##name(struct sc_map_item_##name *t, K key, V value,    \
+                              uint32_t hash)                                   \
+    {                                                                          \
+        t->key = key;                                                          \
+        t->value = value;                                                      \
+    }                                                                          \
+                                                                               \
+    uint32_t sc_map_hashof_##name(struct sc_map_item_##name *t)                \
+    {                                                                          \
+        return sc_map_key_hash_##name(t->key);                                 \
+    }                                                                          \
+                                                                               \
+    void sc_map_move_##name(struct sc_map_item_##name *dst,                    \
+                            struct sc_map_item_##name *src)                    \
+    {                                                                          \
+        *dst = *src;                                                           \
+    }                                                                          \
+                                                                               \
+    sc_map_impl_of(name, K, V, cmp, sc_map_key_hash_##name, 0)
+
+/**
+ * Tables of linear probing maps are cache line aligned, so a slot whose size
+ * divides the line size never straddles two lines. The pointer to free is kept
+ * right before the table.
+ */
+#define SC_MAP_CACHE_LINE 64
+
+static void *sc_map_alloc_aligned(size_t size)
+{
+    char *mem, *p;
+    const size_t extra = SC_MAP_CACHE_LINE + sizeof(mem);
+
+    if (size > SIZE_MAX - extra) {
+        return NULL;
+    }
+
+    mem = sc_map_calloc(1, size + extra);
+    if (mem == NULL) {
+        return NULL;
+    }
+
+    p = mem + sizeof(mem);
+    p += (SC_MAP_CACHE_LINE - ((uintptr_t) p % SC_MAP_CACHE_LINE)) %
+         SC_MAP_CACHE_LINE;
+    memcpy(p - sizeof(mem), &mem, sizeof(mem));
+
+    return p;
+}
+
+static void sc_map_free_aligned(void *p)
+{
+    void *mem;
+
+    if (p != NULL) {
+        memcpy(&mem, (char *) p - sizeof(mem), sizeof(mem));
+        sc_map_free(mem);
+    }
+}
+
+/**
+ * 'robin' is 0 or 1. In robin hood mode, an insert takes the slot of an item
+ * that is closer to its home slot than the new item and moves that item
+ * further. Items of a cluster stay ordered by home slot, so lookups stop at
+ * the first item that is closer to its home than the probe distance so far,
+ * instead of at an empty slot. Deletes are the same backward shift.
+ */
+#define sc_map_impl_of(name, K, V, cmp, hash_fn, robin)                        \
+                                                                               \
+    static const struct sc_map_##name sc_map_empty_##name = {                  \
+            .cap = 1,                                                          \
+            .mem = &(struct sc_map_item_##name){.key = (0)}};                  \
+                                                                               \
+    static void *sc_map_alloc_##name(uint32_t *cap, uint32_t factor)           \
+    {                                                                          \
+        uint32_t v = *cap;                                                     \
+        void *p;                                                               \
+        struct sc_map_item_##name *t;                                          \
+                                                                               \
+        if (*cap > SC_SIZE_MAX / factor) {                                     \
+            sc_map_on_error("Out of memory. cap(%zu).", *cap);                 \
+            return NULL;                                                       \
+        }                                                                      \
+                                                                               \
+        /* Find next power of two */                                           \
+        v = v < 8 ? 8 : (v * factor);                                          \
+        v--;                                                                   \
+        for (uint32_t i = 1; i < sizeof(v) * 8; i *= 2) {                      \
+            v |= v >> i;                                                       \
+        }                                                                      \
+        v++;                                                                   \
+                                                                               \
+        *cap = v;                                                              \
+        p = sc_map_alloc_aligned(sizeof(*t) * (size_t) v);                     \
+        if (p == NULL) {                                                       \
+            sc_map_on_error("Out of memory. t(%zu) v(%zu).", sizeof(*t), v);   \
+        }                                                                      \
+                                                                               \
+        return p;                                                              \
+    }                                                                          \
+                                                                               \
+    bool sc_map_init_##name(struct sc_map_##name *map, uint32_t cap,           \
+                            uint32_t load_factor)                              \
+    {                                                                          \
+        void *t;                                                               \
+        uint32_t f = (load_factor == 0) ? 75 : load_factor;                    \
+                                                                               \
+        if (f > 95 || f < 25) {                                                \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        if (cap == 0) {                                                        \
+            *map = sc_map_empty_##name;                                        \
+            map->load_factor = f;                                              \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        t = sc_map_alloc_##name(&cap, 1);                                      \
+        if (t == NULL) {                                                       \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        *map = sc_map_empty_##name;                                            \
+        map->mem = t;                                                          \
+        map->cap = cap;                                                        \
+        map->load_factor = f;                                                  \
+        map->remap = (uint32_t)(map->cap * ((double) map->load_factor / 100)); \
+                                                                               \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    void sc_map_term_##name(struct sc_map_##name *map)                         \
+    {                                                                          \
+        if (map->mem != sc_map_empty_##name.mem) {                             \
+            sc_map_free_aligned(map->mem);                                     \
+        }                                                                      \
+                                                                               \
+        sc_map_free_aligned(map->old);                                         \
+    }                                                                          \
+                                                                               \
+    void sc_map_incremental_##name(struct sc_map_##name *map, uint32_t step)   \
+    {                                                                          \
+        map->step = step;                                                      \
+    }                                                                          \
+                                                                               \
+    uint32_t sc_map_size_##name(struct sc_map_##name *map)                     \
+    {                                                                          \
+        return map->size;                                                      \
+    }                                                                          \
+                                                                               \
+    void sc_map_clear_##name(struct sc_map_##name *map)                        \
+    {                                                                          \
+        if (map->size > 0) {                                                   \
+            for (uint32_t i = 0; i < map->cap; i++) {                          \
+                map->mem[i].key = 0;                                           \
+            }                                                                  \
+                                                                               \
+            map->size = 0;                                                     \
+        }                                                                      \
+                                                                               \
+        sc_map_free_aligned(map->old);                                         \
+        map->old = NULL;                                                       \
+        map->old_cap = 0;                                                      \
+        map->old_left = 0;                                                     \
+        map->used = false;                                                     \
+                                                                               \
+        /* With a low water mark, an empty map gives its memory back. */       \
+        if (map->low_water != 0 && map->mem != sc_map_empty_##name.mem) {      \
+            sc_map_free_aligned(map->mem);                                     \
+            map->mem = sc_map_empty_##name.mem;                                \
+            map->cap = 1;                                                      \
+            map->remap = 0;                                                    \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    /* Distance of the item at 'pos' from its home slot. */                    \
+    static uint32_t sc_map_dist_##name(struct sc_map_item_##name *mem,         \
+                                       uint32_t mod, uint32_t pos)             \
+    {                                                                          \
+        return (pos - sc_map_hashof_##name(&mem[pos])) & mod;                  \
+    }                                                                          \
+                                                                               \
+    static uint32_t sc_map_find_##name(struct sc_map_item_##name *mem,         \
+                                       uint32_t mod, K key, uint32_t hash)     \
+    {                                                                          \
+        uint32_t pos = hash & mod, dist = 0;                                   \
+                                                                               \
+        while (true) {                                                         \
+            if (mem[pos].key == 0) {                                           \
+                return UINT32_MAX;                                             \
+            } else if (sc_map_cmp_##name(&mem[pos], key, hash) != true) {      \
+                if ((robin) && sc_map_dist_##name(mem, mod, pos) < dist) {     \
+                    return UINT32_MAX;                                         \
+                }                                                              \
+                pos = (pos + 1) & (mod);                                       \
+                dist++;                                                        \
+                continue;                                                      \
+            }                                                                  \
+                                                                               \
+            return pos;                                                        \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    static void sc_map_erase_##name(struct sc_map_item_##name *mem,            \
+                                    uint32_t mod, uint32_t pos)                \
+    {                                                                          \
+        uint32_t prev_elem, curr, curr_orig;                                   \
+                                                                               \
+        mem[pos].key = 0;                                                      \
+        prev_elem = pos;                                                       \
+        curr = pos;                                                            \
+                                                                               \
+        while (true) {                                                         \
+            curr = (curr + 1) & (mod);                                         \
+            if (mem[curr].key == 0) {                                          \
+                break;                                                         \
+            }                                                                  \
+                                                                               \
+            curr_orig = sc_map_hashof_##name(&mem[curr]) & (mod);              \
+                                                                               \
+            if ((curr_orig > curr &&                                           \
+                 (curr_orig <= prev_elem || curr >= prev_elem)) ||             \
+                (curr_orig <= prev_elem && curr >= prev_elem)) {               \
+                                                                               \
+                sc_map_move_##name(&mem[prev_elem], &mem[curr]);               \
+                mem[curr].key = 0;                                             \
+                prev_elem = curr;                                              \
+            }                                                                  \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    /* Moves item 't' into 'mem', see robin hood mode above. */                \
+    static void sc_map_place_##name(struct sc_map_item_##name *mem,            \
+                                    uint32_t mod,                              \
+                                    struct sc_map_item_##name *t)              \
+    {                                                                          \
+        uint32_t d, dist = 0, pos = sc_map_hashof_##name(t) & mod;             \
+        struct sc_map_item_##name item, tmp;                                   \
+                                                                               \
+        if (!(robin)) {                                                        \
+            while (mem[pos].key != 0) {                                        \
+                pos = (pos + 1) & (mod);                                       \
+            }                                                                  \
+                                                                               \
+            sc_map_move_##name(&mem[pos], t);                                  \
+            return;                                                            \
+        }                                                                      \
+                                                                               \
+        sc_map_move_##name(&item, t);                                          \
+                                                                               \
+        while (mem[pos].key != 0) {                                            \
+            d = sc_map_dist_##name(mem, mod, pos);                             \
+            if (d < dist) {                                                    \
+                sc_map_move_##name(&tmp, &mem[pos]);                           \
+                sc_map_move_##name(&mem[pos], &item);                          \
+                sc_map_move_##name(&item, &tmp);                               \
+                dist = d;                                                      \
+            }                                                                  \
+                                                                               \
+            pos = (pos + 1) & (mod);                                           \
+            dist++;                                                            \
+        }                                                                      \
+                                                                               \
+        sc_map_move_##name(&mem[pos], &item);                                  \
+    }                                                                          \
+                                                                               \
+    /* Moves up to 'n' slots from the old table to the current one. Slots are  \
+     * visited backwards, starting from an empty slot. So, each moved item is  \
+     * the last item of its cluster and removing it never breaks the probe     \
+     * sequence of the items left in the old table. */                         \
+    static void sc_map_migrate_##name(struct sc_map_##name *map, uint32_t n)   \
+    {                                                                          \
+        struct sc_map_item_##name *t;                                          \
+                                                                               \
+        for (; n > 0 && map->old_left > 0; n--) {                              \
+            map->old_pos = (map->old_pos - 1) & (map->old_cap - 1);            \
+            map->old_left--;                                                   \
+                                                                               \
+            t = &map->old[map->old_pos];                                       \
+            if (t->key == 0) {                                                 \
+                continue;                                                      \
+            }                                                                  \
+                                                                               \
+            sc_map_place_##name(map->mem, map->cap - 1, t);                    \
+            t->key = 0;                                                        \
+        }                                                                      \
+                                                                               \
+        if (map->old_left == 0) {                                              \
+            sc_map_free_aligned(map->old);                                     \
+            map->old = NULL;                                                   \
+            map->old_cap = 0;                                                  \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    /* Moves items to 'new', a table of 'cap' slots. With incremental resize,  \
+     * current table is kept as the old table and items are moved later. */    \
+    static void sc_map_rehash_##name(struct sc_map_##name *map,                \
+                                     struct sc_map_item_##name *new,           \
+                                     uint32_t cap)                             \
+    {                                                                          \
+        /* Previous resize must be completed before starting a new one. */     \
+        sc_map_migrate_##name(map, UINT32_MAX);                                \
+                                                                               \
+        if (map->step != 0 && map->mem != sc_map_empty_##name.mem) {           \
+            map->old = map->mem;                                               \
+            map->old_cap = map->cap;                                           \
+            map->old_left = map->cap;                                          \
+            map->old_pos = 0;                                                  \
+                                                                               \
+            /* Table is never full, start from an empty slot. */               \
+            while (map->old[map->old_pos].key != 0) {                          \
+                map->old_pos++;                                                \
+            }                                                                  \
+                                                                               \
+            map->mem = new;                                                    \
+            map->cap = cap;                                                    \
+            map->remap = (uint32_t)(cap * ((double) map->load_factor / 100));  \
+            return;                                                            \
+        }                                                                      \
+                                                                               \
+        for (uint32_t i = 0; i < map->cap; i++) {                              \
+            if (map->mem[i].key != 0) {                                        \
+                sc_map_place_##name(new, cap - 1, &map->mem[i]);               \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        if (map->mem != sc_map_empty_##name.mem) {                             \
+            sc_map_free_aligned(map->mem);                                     \
+        }                                                                      \
+                                                                               \
+        map->mem = new;                                                        \
+        map->cap = cap;                                                        \
+        map->remap = (uint32_t)(map->cap * ((double) map->load_factor / 100)); \
+    }                                                                          \
+                                                                               \
+    static bool sc_map_remap_##name(struct sc_map_##name *map)                 \
+    {                                                                          \
+        uint32_t cap;                                                          \
+        struct sc_map_item_##name *new;                                        \
+                                                                               \
+        if (map->size < map->remap) {                                          \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        cap = map->cap;                                                        \
+        new = sc_map_alloc_##name(&cap, 2);                                    \
+        if (new == NULL) {                                                     \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        sc_map_stat(uint64_t start = sc_map_time_ns());                        \
+        sc_map_rehash_##name(map, new, cap);                                   \
+        sc_map_stat(map->stats.remaps++;                                       \
+                    map->stats.remap_ns += sc_map_time_ns() - start);          \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    bool sc_map_shrink_##name(struct sc_map_##name *map)                       \
+    {                                                                          \
+        uint32_t cap = 8;                                                      \
+        uint64_t need;                                                         \
+        struct sc_map_item_##name *new;                                        \
+                                                                               \
+        /* Previous resize must be completed before starting a new one. */     \
+        sc_map_migrate_##name(map, UINT32_MAX);                                \
+                                                                               \
+        if (map->size - map->used == 0) {                                      \
+            if (map->mem != sc_map_empty_##name.mem) {                         \
+                sc_map_free_aligned(map->mem);                                 \
+            }                                                                  \
+                                                                               \
+            map->mem = sc_map_empty_##name.mem;                                \
+            map->cap = 1;                                                      \
+            map->remap = 0;                                                    \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        /* Smallest table that takes one more item without growing */          \
+        need = ((uint64_t) map->size + 1) * 100 / map->load_factor + 1;        \
+        while (cap < need) {                                                   \
+            cap *= 2;                                                          \
+        }                                                                      \
+                                                                               \
+        if (cap >= map->cap) {                                                 \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        new = sc_map_alloc_##name(&cap, 1);                                    \
+        if (new == NULL) {                                                     \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        sc_map_stat(uint64_t start = sc_map_time_ns());                        \
+        sc_map_rehash_##name(map, new, cap);                                   \
+        sc_map_stat(map->stats.remaps++;                                       \
+                    map->stats.remap_ns += sc_map_time_ns() - start);          \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    bool sc_map_low_water_##name(struct sc_map_##name *map, uint32_t percent)  \
+    {                                                                          \
+        /* Must be well below the load factor, so a shrink does not trigger    \
+         * a grow or another shrink right after. */                            \
+        if (percent * 2 >= map->load_factor) {                                 \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        map->low_water = percent;                                              \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    size_t sc_map_mem_usage_##name(struct sc_map_##name *map)                  \
+    {                                                                          \
+        size_t n = map->old_cap;                                               \
+                                                                               \
+        n += (map->mem != sc_map_empty_##name.mem) ? map->cap : 0;             \
+        return n * sizeof(*map->mem);                                          \
+    }                                                                          \
+                                                                               \
+    sc_map_stats_impl(name, robin)                                             \
+                                                                               \
+    bool sc_map_put_hash_##name(struct sc_map_##name *map, K key, V value,     \
+                                uint32_t hash)                                 \
+    {                                                                          \
+        uint32_t pos, mod;                                                     \
+        struct sc_map_item_##name item;                                        \
+                                                                               \
+        if (key == 0) {                                                        \
+            map->size += !map->used;                                           \
+            map->used = 1;                                                     \
+            map->value = value;                                                \
+                                                                               \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        if (!sc_map_remap_##name(map)) {                                       \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        if (map->old != NULL) {                                                \
+            sc_map_migrate_##name(map, map->step);                             \
+        }                                                                      \
+                                                                               \
+        if (map->old != NULL) {                                                \
+            pos = sc_map_find_##name(map->old, map->old_cap - 1, key, hash);   \
+            if (pos != UINT32_MAX) {                                           \
+                sc_map_stat(sc_map_stats_put_##name(map, map->old,             \
+                                                    map->old_cap - 1, hash,    \
+                                                    pos));                     \
+                sc_map_assign_##name(&map->old[pos], key, value, hash);        \
+                return true;                                                   \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        mod = map->cap - 1;                                                    \
+                                                                               \
+        if (robin) {                                                           \
+            pos = sc_map_find_##name(map->mem, mod, key, hash);                \
+            sc_map_stat(sc_map_stats_put_##name(map, map->mem, mod, hash,      \
+                                                pos));                         \
+            if (pos != UINT32_MAX) {                                           \
+                sc_map_assign_##name(&map->mem[pos], key, value, hash);        \
+                return true;                                                   \
+            }                                                                  \
+                                                                               \
+            sc_map_assign_##name(&item, key, value, hash);                     \
+            sc_map_place_##name(map->mem, mod, &item);                         \
+            map->size++;                                                       \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        pos = hash & (mod);                                                    \
+                                                                               \
+        while (true) {                                                         \
+            if (map->mem[pos].key == 0) {                                      \
+                map->size++;                                                   \
+            } else if (sc_map_cmp_##name(&map->mem[pos], key, hash) != true) { \
+                pos = (pos + 1) & (mod);                                       \
+                continue;                                                      \
+            }                                                                  \
+                                                                               \
+            sc_map_stat(sc_map_stats_put_##name(map, map->mem, mod, hash,      \
+                                                pos));                         \
+            sc_map_assign_##name(&map->mem[pos], key, value, hash);            \
+            return true;                                                       \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    bool sc_map_put_##name(struct sc_map_##name *map, K key, V value)          \
+    {                                                                          \
+        return sc_map_put_hash_##name(map, key, value,                         \
+                                      sc_map_key_hash_##name(key));            \
+    }                                                                          \
+                                                                               \
+    bool sc_map_get_hash_##name(struct sc_map_##name *map, K key, V *value,    \
+                                uint32_t hash)                                 \
+    {                                                                          \
+        uint32_t pos;                                                          \
+                                                                               \
+        if (key == 0) {                                                        \
+            *value = map->value;                                               \
+            return map->used;                                                  \
+        }                                                                      \
+                                                                               \
+        if (map->old != NULL) {                                                \
+            sc_map_migrate_##name(map, map->step);                             \
+        }                                                                      \
+                                                                               \
+        if (map->old != NULL) {                                                \
+            pos = sc_map_find_##name(map->old, map->old_cap - 1, key, hash);   \
+            if (pos != UINT32_MAX) {                                           \
+                sc_map_stat(sc_map_stats_get_##name(map, map->old,             \
+                                                    map->old_cap - 1, hash,    \
+                                                    pos));                     \
+                *value = map->old[pos].value;                                  \
+                return true;                                                   \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        pos = sc_map_find_##name(map->mem, map->cap - 1, key, hash);           \
+        sc_map_stat(sc_map_stats_get_##name(map, map->mem, map->cap - 1, hash, \
+                                            pos));                             \
+        if (pos == UINT32_MAX) {                                               \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        *value = map->mem[pos].value;                                          \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    bool sc_map_get_##name(struct sc_map_##name *map, K key, V *value)         \
+    {                                                                          \
+        return sc_map_get_hash_##name(map, key, value,                         \
+                                      sc_map_key_hash_##name(key));            \
+    }                                                                          \
+                                                                               \
+    uint32_t sc_map_get_batch_##name(struct sc_map_##name *map, K const *keys, \
+                                     uint32_t n, V *values, bool *found)       \
+    {                                                                          \
+        uint32_t i, j, len, pos, count = 0, hashes[SC_MAP_BATCH];              \
+        V value;                                                               \
+                                                                               \
+        for (i = 0; i < n; i += len) {                                         \
+            len = n - i < SC_MAP_BATCH ? n - i : SC_MAP_BATCH;                 \
+                                                                               \
+            if (map->old != NULL) {                                            \
+                for (j = i; j < i + len; j++) {                                \
+                    found[j] = sc_map_get_##name(map, keys[j], &value);        \
+                    values[j] = found[j] ? value : values[j];                  \
+                    count += found[j];                                         \
+                }                                                              \
+                continue;                                                      \
+            }                                                                  \
+                                                                               \
+            for (j = 0; j < len; j++) {                                        \
+                if (keys[i + j] != 0) {                                        \
+                    hashes[j] = hash_fn(keys[i + j]);                          \
+                    sc_map_prefetch(&map->mem[hashes[j] & (map->cap - 1)]);    \
+                }                                                              \
+            }                                                                  \
+                                                                               \
+            for (j = 0; j < len; j++) {                                        \
+                if (keys[i + j] == 0) {                                        \
+                    found[i + j] = map->used;                                  \
+                    values[i + j] = map->used ? map->value : values[i + j];    \
+                    count += map->used;                                        \
+                    continue;                                                  \
+                }                                                              \
+                                                                               \
+                pos = sc_map_find_##name(map->mem, map->cap - 1, keys[i + j],  \
+                                         hashes[j]);                           \
+                sc_map_stat(sc_map_stats_get_##name(map, map->mem,             \
+                                                    map->cap - 1, hashes[j],   \
+                                                    pos));                     \
+                found[i + j] = (pos != UINT32_MAX);                            \
+                if (pos != UINT32_MAX) {                                       \
+                    values[i + j] = map->mem[pos].value;                       \
+                    count++;                                                   \
+                }                                                              \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        return count;                                                          \
+    }                                                                          \
+                                                                               \
+    bool sc_map_del_hash_##name(struct sc_map_##name *map, K key, V *value,    \
+                                uint32_t hash)                                 \
+    {                                                                          \
+        uint32_t pos;                                                          \
+        struct sc_map_item_##name *mem = map->mem;                             \
+        uint32_t mod = map->cap - 1;                                           \
+                                                                               \
+        if (key == 0) {                                                        \
+            bool ret = map->used;                                              \
+            map->size -= map->used;                                            \
+            map->used = false;                                                 \
+                                                                               \
+            if (value != NULL) {                                               \
+                *value = map->value;                                           \
+            }                                                                  \
+                                                                               \
+            return ret;                                                        \
+        }                                                                      \
+                                                                               \
+        if (map->old != NULL) {                                                \
+            sc_map_migrate_##name(map, map->step);                             \
+        }                                                                      \
+                                                                               \
+        pos = sc_map_find_##name(map->mem, map->cap - 1, key, hash);           \
+        if (pos == UINT32_MAX && map->old != NULL) {                           \
+            mem = map->old;                                                    \
+            mod = map->old_cap - 1;                                            \
+            pos = sc_map_find_##name(mem, mod, key, hash);                     \
+        }                                                                      \
+                                                                               \
+        if (pos == UINT32_MAX) {                                               \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        if (value != NULL) {                                                   \
+            *value = mem[pos].value;                                           \
+        }                                                                      \
+                                                                               \
+        map->size--;                                                           \
+        sc_map_erase_##name(mem, mod, pos);                                    \
+                                                                               \
+        if (map->old == NULL && map->cap > 8 &&                                \
+            sc_map_below(map->size, map->cap, map->low_water)) {               \
+            /* Map stays valid if this fails, just larger than needed. */      \
+            sc_map_shrink_##name(map);                                         \
+        }                                                                      \
+                                                                               \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    bool sc_map_del_##name(struct sc_map_##name *map, K key, V *value)         \
+    {                                                                          \
+        return sc_map_del_hash_##name(map, key, value,                         \
+                                      sc_map_key_hash_##name(key));            \
+    }                                                                          \
+                                                                               \
+    /* Grows the table at once, so 'n' more items fit without a remap. */      \
+    static bool sc_map_reserve_##name(struct sc_map_##name *map, uint32_t n)   \
+    {                                                                          \
+        uint32_t step, cap = 8;                                                \
+        uint64_t need;                                                         \
+        struct sc_map_item_##name *new;                                        \
+                                                                               \
+        sc_map_migrate_##name(map, UINT32_MAX);                                \
+                                                                               \
+        need = ((uint64_t) map->size + n + 1) * 100 / map->load_factor + 1;    \
+        if (need > (UINT32_MAX / 2) + 1) {                                     \
+            sc_map_on_error("Out of memory. n(%u).", n);                       \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        while (cap < need) {                                                   \
+            cap *= 2;                                                          \
+        }                                                                      \
+                                                                               \
+        if (cap <= map->cap) {                                                 \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        new = sc_map_alloc_##name(&cap, 1);                                    \
+        if (new == NULL) {                                                     \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        step = map->step;                                                      \
+        map->step = 0;                                                         \
+        sc_map_stat(uint64_t start = sc_map_time_ns());                        \
+        sc_map_rehash_##name(map, new, cap);                                   \
+        sc_map_stat(map->stats.remaps++;                                       \
+                    map->stats.remap_ns += sc_map_time_ns() - start);          \
+        map->step = step;                                                      \
+                                                                               \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    /* Put that only visits slots below 'hi'. Returns false if the probe       \
+     * sequence reaches 'hi', the key is not in the table then. */             \
+    static bool sc_map_put_range_##name(struct sc_map_item_##name *mem,        \
+                                        uint32_t mod, uint32_t hi, K key,      \
+                                        V value, uint32_t hash,                \
+                                        uint32_t *added)                       \
+    {                                                                          \
+        uint32_t pos, dist = 0;                                                \
+        struct sc_map_item_##name item;                                        \
+                                                                               \
+        for (pos = hash & mod; pos < hi; pos++, dist++) {                      \
+            if (mem[pos].key == 0) {                                           \
+                break;                                                         \
+            } else if (sc_map_cmp_##name(&mem[pos], key, hash)) {              \
+                sc_map_assign_##name(&mem[pos], key, value, hash);             \
+                return true;                                                   \
+            } else if ((robin) && sc_map_dist_##name(mem, mod, pos) < dist) {  \
+                /* Key is not in the table, placing it needs an empty slot. */ \
+                while (pos < hi && mem[pos].key != 0) {                        \
+                    pos++;                                                     \
+                }                                                              \
+                break;                                                         \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        if (pos == hi) {                                                       \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        /* Placement writes only to slots before the empty slot at 'pos'. */   \
+        sc_map_assign_##name(&item, key, value, hash);                         \
+        sc_map_place_##name(mem, mod, &item);                                  \
+        (*added)++;                                                            \
+                                                                               \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    struct sc_map_part_##name                                                  \
+    {                                                                          \
+        struct sc_map_##name *map;                                             \
+        K const *keys;                                                         \
+        V const *values;                                                       \
+        uint32_t *hashes;                                                      \
+        uint8_t *defer;                                                        \
+        uint32_t n;                                                            \
+        uint32_t parts;                                                        \
+        uint32_t part;                                                         \
+        uint32_t added;                                                        \
+    };                                                                         \
+                                                                               \
+    /* Hashes its share of the keys, key 0 is left to the calling thread. */   \
+    static void sc_map_hash_part_##name(void *arg)                             \
+    {                                                                          \
+        struct sc_map_part_##name *p = arg;                                    \
+        uint32_t end = (uint32_t)((uint64_t) p->n * (p->part + 1) / p->parts); \
+                                                                               \
+        for (uint32_t i = (uint32_t)((uint64_t) p->n * p->part / p->parts);    \
+             i < end; i++) {                                                   \
+            if (p->keys[i] == 0) {                                             \
+                p->hashes[i] = 0;                                              \
+                p->defer[i] = 1;                                               \
+            } else {                                                           \
+                p->hashes[i] = hash_fn(p->keys[i]);                            \
+            }                                                                  \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    /* Puts keys whose home slot is in its range of the table. */              \
+    static void sc_map_put_part_##name(void *arg)                              \
+    {                                                                          \
+        struct sc_map_part_##name *p = arg;                                    \
+        const uint32_t cap = p->map->cap, mod = cap - 1;                       \
+        uint32_t home;                                                         \
+        uint32_t lo = (uint32_t)((uint64_t) cap * p->part / p->parts);         \
+        uint32_t hi = (uint32_t)((uint64_t) cap * (p->part + 1) / p->parts);   \
+                                                                               \
+        for (uint32_t i = 0; i < p->n; i++) {                                  \
+            home = p->hashes[i] & mod;                                         \
+            if (home < lo || home >= hi || p->defer[i]) {                      \
+                continue;                                                      \
+            }                                                                  \
+                                                                               \
+            if (!sc_map_put_range_##name(p->map->mem, mod, hi, p->keys[i],     \
+                                         p->values[i], p->hashes[i],           \
+                                         &p->added)) {                         \
+                p->defer[i] = 1;                                               \
+            }                                                                  \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    bool sc_map_build_##name(struct sc_map_##name *map, K const *keys,         \
+                             V const *values, uint32_t n, uint32_t threads)    \
+    {                                                                          \
+        bool rc = false;                                                       \
+        uint32_t parts, *hashes;                                               \
+        uint8_t *defer;                                                        \
+        struct sc_map_part_##name p[SC_MAP_BUILD_THREADS];                     \
+                                                                               \
+        if (n == 0) {                                                          \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        hashes = sc_map_calloc(sizeof(*hashes), n);                            \
+        defer = sc_map_calloc(sizeof(*defer), n);                              \
+        if (hashes == NULL || defer == NULL) {                                 \
+            sc_map_on_error("Out of memory. n(%u).", n);                       \
+            goto out;                                                          \
+        }                                                                      \
+                                                                               \
+        if (!sc_map_reserve_##name(map, n)) {                                  \
+            goto out;                                                          \
+        }                                                                      \
+                                                                               \
+        parts = map->cap / SC_MAP_BUILD_SLOTS;                                 \
+        parts = threads < parts ? threads : parts;                             \
+        parts = parts < SC_MAP_BUILD_THREADS ? parts : SC_MAP_BUILD_THREADS;   \
+        parts = parts == 0 ? 1 : parts;                                        \
+                                                                               \
+        for (uint32_t i = 0; i < parts; i++) {                                 \
+            p[i] = (struct sc_map_part_##name){                                \
+                    .map = map,                                                \
+                    .keys = keys,                                              \
+                    .values = values,                                          \
+                    .hashes = hashes,                                          \
+                    .defer = defer,                                            \
+                    .n = n,                                                    \
+                    .parts = parts,                                            \
+                    .part = i,                                                 \
+            };                                                                 \
+        }                                                                      \
+                                                                               \
+        sc_map_run(sc_map_hash_part_##name, p, sizeof(p[0]), parts);           \
+        sc_map_run(sc_map_put_part_##name, p, sizeof(p[0]), parts);            \
+                                                                               \
+        for (uint32_t i = 0; i < parts; i++) {                                 \
+            map->size += p[i].added;                                           \
+        }                                                                      \
+                                                                               \
+        /* Table was grown for all keys, these puts do not allocate. */        \
+        for (uint32_t i = 0; i < n; i++) {                                     \
+            if (defer[i] && keys[i] == 0) {                                    \
+                sc_map_put_##name(map, keys[i], values[i]);                    \
+            } else if (defer[i]) {                                             \
+                sc_map_put_hash_##name(map, keys[i], values[i], hashes[i]);    \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        rc = true;                                                             \
+out:                                                                           \
+        sc_map_free(hashes);                                                   \
+        sc_map_free(defer);                                                    \
+        return rc;                                                             \
+    }                                                                          \
+                                                                               \
+    static void sc_map_merge_mem_##name(struct sc_map_##name *map,             \
+                                        struct sc_map_item_##name *mem,        \
+                                        uint32_t cap)                          \
+    {                                                                          \
+        for (uint32_t i = 0; i < cap; i++) {                                   \
+            if (mem[i].key != 0) {                                             \
+                sc_map_put_hash_##name(map, mem[i].key, mem[i].value,          \
+                                       sc_map_hashof_##name(&mem[i]));         \
+            }                                                                  \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    bool sc_map_merge_##name(struct sc_map_##name *map,                        \
+                             struct sc_map_##name *src)                        \
+    {                                                                          \
+        if (map == src) {                                                      \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        if (!sc_map_reserve_##name(map, src->size)) {                          \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        if (src->used) {                                                       \
+            sc_map_put_##name(map, 0, src->value);                             \
+        }                                                                      \
+                                                                               \
+        /* Table was grown for all items, these puts do not allocate. */       \
+        sc_map_merge_mem_##name(map, src->mem, src->cap);                      \
+        if (src->old != NULL) {                                                \
+            sc_map_merge_mem_##name(map, src->old, src->old_cap);              \
+        }                                                                      \
+                                                                               \
+        return true;                                                           \
+    }
+
+/**
+ * Swiss table control bytes. A full slot holds the top 7 bits of the hash,
+ * empty and deleted slots have the high bit set.
+ */
+#define SC_MAP_GROUP   16u
+#define SC_MAP_EMPTY   0x80u
+#define SC_MAP_DELETED 0xFEu
+
+static uint32_t sc_map_ctz(uint32_t x)
+{
+#if defined(_MSC_VER)
+    unsigned long i;
+    _BitScanForward(&i, x);
+    return (uint32_t) i;
+#else
+    return (uint32_t) __builtin_ctz(x);
+#endif
+}
+
+/**
+ * Returns a bitmask of the slots in the group starting at 'ctrl' that are
+ * equal to 'tag'. Bit 'i' is set if ctrl[i] == tag.
+ */
+static uint32_t sc_map_group_match(const uint8_t *ctrl, uint8_t tag)
+{
+#if defined(SC_MAP_SSE2)
+    __m128i g = _mm_loadu_si128((const __m128i *) ctrl);
+    __m128i m = _mm_cmpeq_epi8(g, _mm_set1_epi8((char) tag));
+
+    return (uint32_t) _mm_movemask_epi8(m);
+#elif defined(SC_MAP_NEON)
+    static const uint8_t bits[16] = {1, 2, 4, 8, 16, 32, 64, 128,
+                                     1, 2, 4, 8, 16, 32, 64, 128};
+    uint8x16_t m = vceqq_u8(vld1q_u8(ctrl), vdupq_n_u8(tag));
+    uint8x8_t lo, hi;
+
+    m = vandq_u8(m, vld1q_u8(bits));
+    lo = vget_low_u8(m);
+    hi = vget_high_u8(m);
+    lo = vpadd_u8(lo, hi);
+    lo = vpadd_u8(lo, lo);
+    lo = vpadd_u8(lo, lo);
+
+    return (uint32_t) vget_lane_u8(lo, 0) |
+           ((uint32_t) vget_lane_u8(lo, 1) << 8u);
+#else
+    uint32_t mask = 0;
+
+    for (uint32_t i = 0; i < SC_MAP_GROUP; i++) {
+        mask |= (uint32_t)(ctrl[i] == tag) << i;
+    }
+
+    return mask;
+#endif
+}
+
+/**
+ * Returns a bitmask of the empty or deleted slots in the group.
+ */
+static uint32_t sc_map_group_free(const uint8_t *ctrl)
+{
+#if defined(SC_MAP_SSE2)
+    return (uint32_t) _mm_movemask_epi8(
+            _mm_loadu_si128((const __m128i *) ctrl));
+#else
+    uint32_t mask = 0;
+
+    for (uint32_t i = 0; i < SC_MAP_GROUP; i++) {
+        mask |= (uint32_t)(ctrl[i] >> 7u) << i;
+    }
+
+    return mask;
+#endif
+}
+
+/**
+ * Empty map instances point at this, all slots are empty. Size is one group
+ * plus the mirrored bytes at the end.
+ */
+static const uint8_t sc_map_empty_ctrl[SC_MAP_GROUP * 2] = {
+        0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+        0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+        0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80};
+
+/**
+ * First 'SC_MAP_GROUP' control bytes are mirrored at the end, so a group can be
+ * loaded at any position without wrapping around.
+ */
+static void sc_map_ctrl_set(uint8_t *ctrl, uint32_t cap, uint32_t pos,
+                            uint8_t tag)
+{
+    ctrl[pos] = tag;
+    ctrl[((pos - SC_MAP_GROUP) & (cap - 1)) + SC_MAP_GROUP] = tag;
+}
+
+/**
+ * Returns the first empty or deleted slot on the probe sequence of 'hash'.
+ */
+static uint32_t sc_map_ctrl_free(const uint8_t *ctrl, uint32_t cap,
+                                 uint32_t hash)
+{
+    const uint32_t mod = cap - 1;
+    uint32_t free, step = 0, pos = hash & mod;
+
+    while ((free = sc_map_group_free(&ctrl[pos])) == 0) {
+        step += SC_MAP_GROUP;
+        pos = (pos + step) & mod;
+    }
+
+    return (pos + sc_map_ctz(free)) & mod;
+}
+
+#define sc_map_impl_of_swiss(name, K, V, cmp, hash_fn)                         \
+                                                                               \
+    static struct sc_map_item_##name sc_map_empty_mem_##name[SC_MAP_GROUP];    \
+                                                                               \
+    static bool sc_map_alloc_##name(struct sc_map_##name *map, uint32_t cap)   \
+    {                                                                          \
+        uint32_t v = cap < SC_MAP_GROUP ? SC_MAP_GROUP : cap;                  \
+        size_t bytes;                                                          \
+        void *p;                                                               \
+                                                                               \
+        if (v > SC_SIZE_MAX / 2) {                                             \
+            sc_map_on_error("Out of memory. cap(%u).", cap);                   \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        /* Find next power of two */                                           \
+        v--;                                                                   \
+        for (uint32_t i = 1; i < sizeof(v) * 8; i *= 2) {                      \
+            v |= v >> i;                                                       \
+        }                                                                      \
+        v++;                                                                   \
+                                                                               \
+        bytes = (sizeof(*map->mem) * v) + v + SC_MAP_GROUP;                    \
+        p = sc_map_calloc(1, bytes);                                           \
+        if (p == NULL) {                                                       \
+            sc_map_on_error("Out of memory. bytes(%zu).", bytes);              \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        map->mem = p;                                                          \
+        map->ctrl = (uint8_t *) (map->mem + v);                                \
+        map->cap = v;                                                          \
+        map->deleted = 0;                                                      \
+        map->remap = (uint32_t)(v * ((double) map->load_factor / 100));        \
+        memset(map->ctrl, SC_MAP_EMPTY, v + SC_MAP_GROUP);                     \
+                                                                               \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    static void sc_map_release_##name(struct sc_map_##name *map)               \
+    {                                                                          \
+        if (map->mem != sc_map_empty_mem_##name) {                             \
+            sc_map_free(map->mem);                                             \
+        }                                                                      \
+                                                                               \
+        sc_map_free(map->old);                                                 \
+        map->old = NULL;                                                       \
+        map->old_cap = 0;                                                      \
+        map->old_left = 0;                                                     \
+    }                                                                          \
+                                                                               \
+    bool sc_map_init_##name(struct sc_map_##name *map, uint32_t cap,           \
+                            uint32_t load_factor)                              \
+    {                                                                          \
+        uint32_t f = (load_factor == 0) ? 75 : load_factor;                    \
+                                                                               \
+        if (f > 95 || f < 25) {                                                \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        *map = (struct sc_map_##name){.load_factor = f};                       \
+                                                                               \
+        if (cap == 0) {                                                        \
+            map->mem = sc_map_empty_mem_##name;                                \
+            map->ctrl = (uint8_t *) sc_map_empty_ctrl;                         \
+            map->cap = SC_MAP_GROUP;                                           \
+            map->remap = 0;                                                    \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        return sc_map_alloc_##name(map, cap);                                  \
+    }                                                                          \
+                                                                               \
+    void sc_map_term_##name(struct sc_map_##name *map)                         \
+    {                                                                          \
+        sc_map_release_##name(map);                                            \
+    }                                                                          \
+                                                                               \
+    void sc_map_incremental_##name(struct sc_map_##name *map, uint32_t step)   \
+    {                                                                          \
+        map->step = step;                                                      \
+    }                                                                          \
+                                                                               \
+    uint32_t sc_map_size_##name(struct sc_map_##name *map)                     \
+    {                                                                          \
+        return map->size;                                                      \
+    }                                                                          \
+                                                                               \
+    void sc_map_clear_##name(struct sc_map_##name *map)                        \
+    {                                                                          \
+        /* Empty instances share the static ctrl, only key 0 can be set. */    \
+        if ((map->size > 0 || map->deleted > 0) &&                             \
+            map->mem != sc_map_empty_mem_##name) {                             \
+            for (uint32_t i = 0; i < map->cap; i++) {                          \
+                map->mem[i].key = 0;                                           \
+            }                                                                  \
+                                                                               \
+            memset(map->ctrl, SC_MAP_EMPTY, map->cap + SC_MAP_GROUP);          \
+        }                                                                      \
+                                                                               \
+        map->size = 0;                                                         \
+        map->deleted = 0;                                                      \
+                                                                               \
+        sc_map_free(map->old);                                                 \
+        map->old = NULL;                                                       \
+        map->old_cap = 0;                                                      \
+        map->old_left = 0;                                                     \
+        map->used = false;                                                     \
+                                                                               \
+        /* With a low water mark, an empty map gives its memory back. */       \
+        if (map->low_water != 0 && map->mem != sc_map_empty_mem_##name) {      \
+            sc_map_release_##name(map);                                        \
+            map->mem = sc_map_empty_mem_##name;                                \
+            map->ctrl = (uint8_t *) sc_map_empty_ctrl;                         \
+            map->cap = SC_MAP_GROUP;                                           \
+            map->remap = 0;                                                    \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    static uint32_t sc_map_find_##name(struct sc_map_item_##name *mem,         \
+                                       const uint8_t *ctrl, uint32_t cap,      \
+                                       K key, uint32_t hash)                   \
+    {                                                                          \
+        const uint32_t mod = cap - 1;                                          \
+        const uint8_t tag = (uint8_t)(hash >> 25u);                            \
+        uint32_t match, i, step = 0, pos = hash & mod;                         \
+                                                                               \
+        while (true) {                                                         \
+            match = sc_map_group_match(&ctrl[pos], tag);                       \
+            while (match != 0) {                                               \
+                i = (pos + sc_map_ctz(match)) & mod;                           \
+                if (cmp(mem[i].key, key)) {                                    \
+                    return i;                                                  \
+                }                                                              \
+                match &= match - 1;                                            \
+            }                                                                  \
+                                                                               \
+            if (sc_map_group_match(&ctrl[pos], SC_MAP_EMPTY) != 0) {           \
+                return UINT32_MAX;                                             \
+            }                                                                  \
+                                                                               \
+            step += SC_MAP_GROUP;                                              \
+            pos = (pos + step) & mod;                                          \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    /* Moves up to 'n' slots from the old table to the current one. Moved      \
+     * slots are marked as deleted in the old table, so lookups there keep     \
+     * working until the old table is released. */                             \
+    static void sc_map_migrate_##name(struct sc_map_##name *map, uint32_t n)   \
+    {                                                                          \
+        uint32_t pos, hash, i;                                                 \
+        uint8_t *ctrl = (uint8_t *) (map->old + map->old_cap);                 \
+                                                                               \
+        for (; n > 0 && map->old_left > 0; n--) {                              \
+            pos = map->old_pos++;                                              \
+            map->old_left--;                                                   \
+                                                                               \
+            if (ctrl[pos] & SC_MAP_EMPTY) {                                    \
+                continue;                                                      \
+            }                                                                  \
+                                                                               \
+            hash = hash_fn(map->old[pos].key);                                 \
+            sc_map_ctrl_set(ctrl, map->old_cap, pos, SC_MAP_DELETED);          \
+                                                                               \
+            i = sc_map_ctrl_free(map->ctrl, map->cap, hash);                   \
+            map->deleted -= (map->ctrl[i] == SC_MAP_DELETED);                  \
+            sc_map_ctrl_set(map->ctrl, map->cap, i, (uint8_t)(hash >> 25u));   \
+            map->mem[i] = map->old[pos];                                       \
+            map->old[pos].key = 0;                                             \
+        }                                                                      \
+                                                                               \
+        if (map->old_left == 0) {                                              \
+            sc_map_free(map->old);                                             \
+            map->old = NULL;                                                   \
+            map->old_cap = 0;                                                  \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    /* Moves items to a new table of 'cap' slots. With incremental resize,     \
+     * current table is kept as the old table and items are moved later. */    \
+    static bool sc_map_rehash_##name(struct sc_map_##name *map, uint32_t cap)  \
+    {                                                                          \
+        uint32_t pos, hash;                                                    \
+        struct sc_map_##name prev;                                             \
+                                                                               \
+        /* Previous resize must be completed before starting a new one. */     \
+        if (map->old != NULL) {                                                \
+            sc_map_migrate_##name(map, UINT32_MAX);                            \
+        }                                                                      \
+                                                                               \
+        prev = *map;                                                           \
+                                                                               \
+        if (!sc_map_alloc_##name(map, cap)) {                                  \
+            *map = prev;                                                       \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        if (map->step != 0 && prev.mem != sc_map_empty_mem_##name) {           \
+            map->old = prev.mem;                                               \
+            map->old_cap = prev.cap;                                           \
+            map->old_left = prev.cap;                                          \
+            map->old_pos = 0;                                                  \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        for (uint32_t i = 0; i < prev.cap; i++) {                              \
+            if (prev.ctrl[i] & SC_MAP_EMPTY) {                                 \
+                continue;                                                      \
+            }                                                                  \
+                                                                               \
+            hash = hash_fn(prev.mem[i].key);                                   \
+            pos = sc_map_ctrl_free(map->ctrl, map->cap, hash);                 \
+            sc_map_ctrl_set(map->ctrl, map->cap, pos, (uint8_t)(hash >> 25u)); \
+            map->mem[pos] = prev.mem[i];                                       \
+        }                                                                      \
+                                                                               \
+        sc_map_release_##name(&prev);                                          \
+                                                                               \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    static bool sc_map_remap_##name(struct sc_map_##name *map)                 \
+    {                                                                          \
+        if (map->size + map->deleted < map->remap) {                           \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        /* If most of the used slots are tombstones, rehash at the same        \
+         * capacity to clean them up, otherwise double the capacity. */        \
+        return sc_map_rehash_##name(map, map->size >= map->remap / 2 ?         \
+                                                 map->cap * 2 :                \
+                                                 map->cap);                    \
+    }                                                                          \
+                                                                               \
+    bool sc_map_shrink_##name(struct sc_map_##name *map)                       \
+    {                                                                          \
+        uint32_t cap = SC_MAP_GROUP;                                           \
+        uint64_t need;                                                         \
+                                                                               \
+        if (map->old != NULL) {                                                \
+            sc_map_migrate_##name(map, UINT32_MAX);                            \
+        }                                                                      \
+                                                                               \
+        if (map->size - map->used == 0) {                                      \
+            sc_map_release_##name(map);                                        \
+            map->mem = sc_map_empty_mem_##name;                                \
+            map->ctrl = (uint8_t *) sc_map_empty_ctrl;                         \
+            map->cap = SC_MAP_GROUP;                                           \
+            map->deleted = 0;                                                  \
+            map->remap = 0;                                                    \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        /* Smallest table that takes one more item without growing */          \
+        need = ((uint64_t) map->size + 1) * 100 / map->load_factor + 1;        \
+        while (cap < need) {                                                   \
+            cap *= 2;                                                          \
+        }                                                                      \
+                                                                               \
+        /* Same size rehash is still useful if there are tombstones. */        \
+        if (cap > map->cap || (cap == map->cap && map->deleted == 0)) {        \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        return sc_map_rehash_##name(map, cap);                                 \
+    }                                                                          \
+                                                                               \
+    bool sc_map_low_water_##name(struct sc_map_##name *map, uint32_t percent)  \
+    {                                                                          \
+        if (percent * 2 >= map->load_factor) {                                 \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        map->low_water = percent;                                              \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    size_t sc_map_mem_usage_##name(struct sc_map_##name *map)                  \
+    {                                                                          \
+        size_t n = 0, slot = sizeof(*map->mem) + 1;                            \
+                                                                               \
+        if (map->mem != sc_map_empty_mem_##name) {                             \
+            n += (slot * map->cap) + SC_MAP_GROUP;                             \
+        }                                                                      \
+                                                                               \
+        if (map->old != NULL) {                                                \
+            n += (slot * map->old_cap) + SC_MAP_GROUP;                         \
+        }                                                                      \
+                                                                               \
+        return n;                                                              \
+    }                                                                          \
+                                                                               \
+    bool sc_map_put_##name(struct sc_map_##name *map, K key, V value)          \
+    {                                                                          \
+        uint32_t pos, hash;                                                    \
+                                                                               \
+        if (key == 0) {                                                        \
+            map->size += !map->used;                                           \
+            map->used = 1;                                                     \
+            map->value = value;                                                \
+                                                                               \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        if (!sc_map_remap_##name(map)) {                                       \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        hash = hash_fn(key);                                                   \
+                                                                               \
+        if (map->old != NULL) {                                                \
+            sc_map_migrate_##name(map, map->step);                             \
+        }                                                                      \
+                                                                               \
+        if (map->old != NULL) {                                                \
+            pos = sc_map_find_##name(map->old,                                 \
+                                     (uint8_t *) (map->old + map->old_cap),    \
+                                     map->old_cap, key, hash);                 \
+            if (pos != UINT32_MAX) {                                           \
+                map->old[pos].value = value;                                   \
+                return true;                                                   \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        pos = sc_map_find_##name(map->mem, map->ctrl, map->cap, key, hash);    \
+        if (pos != UINT32_MAX) {                                               \
+            map->mem[pos].value = value;                                       \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        /* Take the first free slot on the probe sequence, it may be a         \
+         * tombstone that comes before the empty slot 'find' stopped at. */    \
+        pos = sc_map_ctrl_free(map->ctrl, map->cap, hash);                     \
+        map->deleted -= (map->ctrl[pos] == SC_MAP_DELETED);                    \
+        sc_map_ctrl_set(map->ctrl, map->cap, pos, (uint8_t)(hash >> 25u));     \
+        map->mem[pos].key = key;                                               \
+        map->mem[pos].value = value;                                           \
+        map->size++;                                                           \
+                                                                               \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    bool sc_map_get_##name(struct sc_map_##name *map, K key, V *value)         \
+    {                                                                          \
+        uint32_t pos, hash;                                                    \
+                                                                               \
+        if (key == 0) {                                                        \
+            *value = map->value;                                               \
+            return map->used;                                                  \
+        }                                                                      \
+                                                                               \
+        hash = hash_fn(key);                                                   \
+                                                                               \
+        if (map->old != NULL) {                                                \
+            sc_map_migrate_##name(map, map->step);                             \
+        }                                                                      \
+                                                                               \
+        pos = sc_map_find_##name(map->mem, map->ctrl, map->cap, key, hash);    \
+        if (pos != UINT32_MAX) {                                               \
+            *value = map->mem[pos].value;                                      \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        if (map->old != NULL) {                                                \
+            pos = sc_map_find_##name(map->old,                                 \
+                                     (uint8_t *) (map->old + map->old_cap),    \
+                                     map->old_cap, key, hash);                 \
+            if (pos != UINT32_MAX) {                                           \
+                *value = map->old[pos].value;                                  \
+                return true;                                                   \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        return false;                                                          \
+    }                                                                          \
+                                                                               \
+    uint32_t sc_map_get_batch_##name(struct sc_map_##name *map, K const *keys, \
+                                     uint32_t n, V *values, bool *found)       \
+    {                                                                          \
+        uint32_t i, j, len, pos, count = 0, hashes[SC_MAP_BATCH];              \
+        V value;                                                               \
+                                                                               \
+        for (i = 0; i < n; i += len) {                                         \
+            len = n - i < SC_MAP_BATCH ? n - i : SC_MAP_BATCH;                 \
+                                                                               \
+            if (map->old != NULL) {                                            \
+                for (j = i; j < i + len; j++) {                                \
+                    found[j] = sc_map_get_##name(map, keys[j], &value);        \
+                    values[j] = found[j] ? value : values[j];                  \
+                    count += found[j];                                         \
+                }                                                              \
+                continue;                                                      \
+            }                                                                  \
+                                                                               \
+            for (j = 0; j < len; j++) {                                        \
+                if (keys[i + j] != 0) {                                        \
+                    hashes[j] = hash_fn(keys[i + j]);                          \
+                    pos = hashes[j] & (map->cap - 1);                          \
+                    sc_map_prefetch(&map->ctrl[pos]);                          \
+                    sc_map_prefetch(&map->mem[pos]);                           \
+                }                                                              \
+            }                                                                  \
+                                                                               \
+            for (j = 0; j < len; j++) {                                        \
+                if (keys[i + j] == 0) {                                        \
+                    found[i + j] = map->used;                                  \
+                    values[i + j] = map->used ? map->value : values[i + j];    \
+                    count += map->used;                                        \
+                    continue;                                                  \
+                }                                                              \
+                                                                               \
+                pos = sc_map_find_##name(map->mem, map->ctrl, map->cap,        \
+                                         keys[i + j], hashes[j]);              \
+                found[i + j] = (pos != UINT32_MAX);                            \
+                if (pos != UINT32_MAX) {                                       \
+                    values[i + j] = map->mem[pos].value;                       \
+                    count++;                                                   \
+                }                                                              \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        return count;                                                          \
+    }                                                                          \
+                                                                               \
+    bool sc_map_del_##name(struct sc_map_##name *map, K key, V *value)         \
+    {                                                                          \
+        uint32_t pos, hash;                                                    \
+        struct sc_map_item_##name *mem = map->mem;                             \
+        uint8_t *ctrl = map->ctrl;                                             \
+        uint32_t cap = map->cap;                                               \
+                                                                               \
+        if (key == 0) {                                                        \
+            bool ret = map->used;                                              \
+            map->size -= map->used;                                            \
+            map->used = false;                                                 \
+                                                                               \
+            if (value != NULL) {                                               \
+                *value = map->value;                                           \
+            }                                                                  \
+                                                                               \
+            return ret;                                                        \
+        }                                                                      \
+                                                                               \
+        hash = hash_fn(key);                                                   \
+                                                                               \
+        if (map->old != NULL) {                                                \
+            sc_map_migrate_##name(map, map->step);                             \
+        }                                                                      \
+                                                                               \
+        pos = sc_map_find_##name(mem, ctrl, cap, key, hash);                   \
+        if (pos != UINT32_MAX) {                                               \
+            map->deleted++;                                                    \
+        } else if (map->old != NULL) {                                         \
+            mem = map->old;                                                    \
+            ctrl = (uint8_t *) (map->old + map->old_cap);                      \
+            cap = map->old_cap;                                                \
+            pos = sc_map_find_##name(mem, ctrl, cap, key, hash);               \
+        }                                                                      \
+                                                                               \
+        if (pos == UINT32_MAX) {                                               \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        if (value != NULL) {                                                   \
+            *value = mem[pos].value;                                           \
+        }                                                                      \
+                                                                               \
+        sc_map_ctrl_set(ctrl, cap, pos, SC_MAP_DELETED);                       \
+        mem[pos].key = 0;                                                      \
+        map->size--;                                                           \
+                                                                               \
+        if (map->old == NULL && map->cap > SC_MAP_GROUP &&                     \
+            sc_map_below(map->size, map->cap, map->low_water)) {               \
+            /* Map stays valid if this fails, just larger than needed. */      \
+            sc_map_shrink_##name(map);                                         \
+        }                                                                      \
+                                                                               \
+        return true;                                                           \
+    }
+
+/**
+ * Insertion ordered map. Items are appended to the dense 'mem' array, 'index'
+ * is an open addressing table of 'mem' positions (+1, so '0' is empty).
+ * Deleted items leave a hole in 'mem' (key is set to zero), holes are removed
+ * when 'mem' is full, before growing it.
+ */
+#define sc_map_impl_of_ordered(name, K, V, cmp, hash_fn)                       \
+                                                                               \
+    static void sc_map_fill_##name(struct sc_map_##name *map)                  \
+    {                                                                          \
+        const uint32_t mod = map->index_cap - 1;                               \
+        uint32_t pos;                                                          \
+                                                                               \
+        for (uint32_t i = 0; i < map->cap; i++) {                              \
+            if (map->mem[i].key == 0) {                                        \
+                continue;                                                      \
+            }                                                                  \
+                                                                               \
+            pos = map->mem[i].hash & mod;                                      \
+            while (map->index[pos] != 0) {                                     \
+                pos = (pos + 1) & mod;                                         \
+            }                                                                  \
+            map->index[pos] = i + 1;                                           \
+        }                                                                      \
     }                                                                          \
                                                                                \
-    uint32_t sc_map_hashof_##name(struct sc_map_item_##name *t)                \
+    static bool sc_map_reindex_##name(struct sc_map_##name *map, uint32_t cap) \
     {                                                                          \
-        return t->hash;                                                        \
+        uint32_t *index;                                                       \
+                                                                               \
+        if (cap > SC_SIZE_MAX / sizeof(*index)) {                              \
+            sc_map_on_error("Out of memory. cap(%u).", cap);                   \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        index = sc_map_calloc(cap, sizeof(*index));                            \
+        if (index == NULL) {                                                   \
+            sc_map_on_error("Out of memory. cap(%u).", cap);                   \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        sc_map_free(map->index);                                               \
+        map->index = index;                                                    \
+        map->index_cap = cap;                                                  \
+        map->remap = (uint32_t)(cap * ((double) map->load_factor / 100));      \
+        sc_map_fill_##name(map);                                               \
+                                                                               \
+        return true;                                                           \
     }                                                                          \
                                                                                \
-    sc_map_impl_of(name, K, V, cmp, hash_fn)
-
-#define sc_map_impl_of_scalar(name, K, V, cmp, hash_fn)                        \
-    bool sc_map_cmp_##name(struct sc_map_item_##name *t, K key, uint32_t hash) \
+    static bool sc_map_reserve_##name(struct sc_map_##name *map, uint32_t cap) \
     {                                                                          \
-        return cmp(t->key, key);                                               \
+        struct sc_map_item_##name *mem;                                        \
+                                                                               \
+        if (cap > SC_SIZE_MAX / sizeof(*mem)) {                                \
+            sc_map_on_error("Out of memory. cap(%u).", cap);                   \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        mem = sc_map_calloc(cap, sizeof(*mem));                                \
+        if (mem == NULL) {                                                     \
+            sc_map_on_error("Out of memory. cap(%u).", cap);                   \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        if (map->cap > 0) {                                                    \
+            memcpy(mem, map->mem, sizeof(*mem) * map->cap);                    \
+        }                                                                      \
+                                                                               \
+        sc_map_free(map->mem);                                                 \
+        map->mem = mem;                                                        \
+        map->mem_cap = cap;                                                    \
+                                                                               \
+        return true;                                                           \
     }                                                                          \
                                                                                \
-    void sc_map_assign_##name(struct sc_map_item_##name *t, K key, V value,    \
-                              uint32_t hash)                                   \
+    /* Removes holes, keeps the order. Index slots are updated in place */     \
+    static void sc_map_compact_##name(struct sc_map_##name *map)               \
     {                                                                          \
-        t->key = key;                                                          \
-        t->value = value;                                                      \
+        const uint32_t mod = map->index_cap - 1;                               \
+        uint32_t pos, n = 0;                                                   \
+                                                                               \
+        for (uint32_t i = 0; i < map->cap; i++) {                              \
+            if (map->mem[i].key == 0) {                                        \
+                continue;                                                      \
+            }                                                                  \
+                                                                               \
+            if (n != i) {                                                      \
+                pos = map->mem[i].hash & mod;                                  \
+                while (map->index[pos] != i + 1) {                             \
+                    pos = (pos + 1) & mod;                                     \
+                }                                                              \
+                map->index[pos] = n + 1;                                       \
+                map->mem[n] = map->mem[i];                                     \
+            }                                                                  \
+            n++;                                                               \
+        }                                                                      \
+                                                                               \
+        map->cap = n;                                                          \
     }                                                                          \
                                                                                \
-    uint32_t sc_map_hashof_##name(struct sc_map_item_##name *t)                \
+    bool sc_map_shrink_##name(struct sc_map_##name *map)                       \
     {                                                                          \
-        return hash_fn(t->key);                                                \
-    }                                                                          \
+        uint32_t cap = 8;                                                      \
+        uint64_t need;                                                         \
                                                                                \
-    sc_map_impl_of(name, K, V, cmp, hash_fn)
-
-#define sc_map_impl_of(name, K, V, cmp, hash_fn)                               \
+        if (map->index_cap != 0) {                                             \
+            sc_map_compact_##name(map);                                        \
+        }                                                                      \
                                                                                \
-    static const struct sc_map_##name sc_map_empty_##name = {                  \
-            .cap = 1,                                                          \
-            .mem = &(struct sc_map_item_##name){.key = (0)}};                  \
+        if (map->cap == 0) {                                                   \
+            sc_map_free(map->mem);                                             \
+            sc_map_free(map->index);                                           \
+            map->mem = NULL;                                                   \
+            map->index = NULL;                                                 \
+            map->mem_cap = 0;                                                  \
+            map->index_cap = 0;                                                \
+            map->remap = 0;                                                    \
+            return true;                                                       \
+        }                                                                      \
                                                                                \
-    static void *sc_map_alloc_##name(uint32_t *cap, uint32_t factor)           \
-    {                                                                          \
-        uint32_t v = *cap;                                                     \
-        void *p;                                                               \
-        struct sc_map_item_##name *t;                                          \
+        /* Smallest index that takes one more item without growing */          \
+        need = ((uint64_t) map->size + 1) * 100 / map->load_factor + 1;        \
+        while (cap < need) {                                                   \
+            cap *= 2;                                                          \
+        }                                                                      \
                                                                                \
-        if (*cap > SC_SIZE_MAX / factor) {                                     \
-            sc_map_on_error("Out of memory. cap(%zu).", *cap);                 \
-            return NULL;                                                       \
+        if (cap < map->index_cap && !sc_map_reindex_##name(map, cap)) {        \
+            return false;                                                      \
         }                                                                      \
                                                                                \
-        /* Find next power of two */                                           \
-        v = v < 8 ? 8 : (v * factor);                                          \
-        v--;                                                                   \
-        for (uint32_t i = 1; i < sizeof(v) * 8; i *= 2) {                      \
-            v |= v >> i;                                                       \
+        if (map->cap < map->mem_cap) {                                         \
+            return sc_map_reserve_##name(map, map->cap);                       \
         }                                                                      \
-        v++;                                                                   \
                                                                                \
-        *cap = v;                                                              \
-        p = sc_map_calloc(sizeof(*t), v);                                      \
-        if (p == NULL) {                                                       \
-            sc_map_on_error("Out of memory. t(%zu) v(%zu).", sizeof(*t), v);   \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    bool sc_map_low_water_##name(struct sc_map_##name *map, uint32_t percent)  \
+    {                                                                          \
+        if (percent * 2 >= map->load_factor) {                                 \
+            return false;                                                      \
         }                                                                      \
                                                                                \
-        return p;                                                              \
+        map->low_water = percent;                                              \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    size_t sc_map_mem_usage_##name(struct sc_map_##name *map)                  \
+    {                                                                          \
+        return ((size_t) map->mem_cap * sizeof(*map->mem)) +                   \
+               ((size_t) map->index_cap * sizeof(*map->index));                \
     }                                                                          \
                                                                                \
     bool sc_map_init_##name(struct sc_map_##name *map, uint32_t cap,           \
                             uint32_t load_factor)                              \
     {                                                                          \
-        void *t;                                                               \
+        uint32_t v;                                                            \
         uint32_t f = (load_factor == 0) ? 75 : load_factor;                    \
                                                                                \
         if (f > 95 || f < 25) {                                                \
             return false;                                                      \
         }                                                                      \
                                                                                \
+        *map = (struct sc_map_##name){.load_factor = f};                       \
         if (cap == 0) {                                                        \
-            *map = sc_map_empty_##name;                                        \
-            map->load_factor = f;                                              \
             return true;                                                       \
         }                                                                      \
                                                                                \
-        t = sc_map_alloc_##name(&cap, 1);                                      \
-        if (t == NULL) {                                                       \
+        if (cap > SC_SIZE_MAX / 100) {                                         \
+            sc_map_on_error("Out of memory. cap(%u).", cap);                   \
             return false;                                                      \
         }                                                                      \
                                                                                \
-        map->mem = t;                                                          \
-        map->size = 0;                                                         \
-        map->used = false;                                                     \
-        map->cap = cap;                                                        \
-        map->load_factor = f;                                                  \
-        map->remap = (uint32_t)(map->cap * ((double) map->load_factor / 100)); \
+        /* Find next power of two */                                           \
+        v = (cap * 100) / f;                                                   \
+        v = v < 8 ? 8 : v;                                                     \
+        v--;                                                                   \
+        for (uint32_t i = 1; i < sizeof(v) * 8; i *= 2) {                      \
+            v |= v >> i;                                                       \
+        }                                                                      \
+        v++;                                                                   \
+                                                                               \
+        if (!sc_map_reserve_##name(map, cap) ||                                \
+            !sc_map_reindex_##name(map, v)) {                                  \
+            sc_map_free(map->mem);                                             \
+            return false;                                                      \
+        }                                                                      \
                                                                                \
         return true;                                                           \
     }                                                                          \
                                                                                \
     void sc_map_term_##name(struct sc_map_##name *map)                         \
     {                                                                          \
-        if (map->mem != sc_map_empty_##name.mem) {                             \
-            sc_map_free(map->mem);                                             \
-        }                                                                      \
+        sc_map_free(map->mem);                                                 \
+        sc_map_free(map->index);                                               \
+    }                                                                          \
+                                                                               \
+    /* Ordered maps grow the index at once, it holds 4 bytes per slot. */      \
+    void sc_map_incremental_##name(struct sc_map_##name *map, uint32_t step)   \
+    {                                                                          \
+        (void) map;                                                            \
+        (void) step;                                                           \
     }                                                                          \
                                                                                \
     uint32_t sc_map_size_##name(struct sc_map_##name *map)                     \
@@ -127,61 +2071,46 @@
                                                                                \
     void sc_map_clear_##name(struct sc_map_##name *map)                        \
     {                                                                          \
-        if (map->size > 0) {                                                   \
-            for (uint32_t i = 0; i < map->cap; i++) {                          \
-                map->mem[i].key = 0;                                           \
-            }                                                                  \
+        if (map->index != NULL) {                                              \
+            memset(map->index, 0, sizeof(*map->index) * map->index_cap);       \
+        }                                                                      \
                                                                                \
-            map->size = 0;                                                     \
+        map->cap = 0;                                                          \
+        map->size = 0;                                                         \
+        map->used = false;                                                     \
+                                                                               \
+        /* With a low water mark, an empty map gives its memory back. */       \
+        if (map->low_water != 0) {                                             \
+            sc_map_shrink_##name(map);                                         \
         }                                                                      \
     }                                                                          \
                                                                                \
-    static bool sc_map_remap_##name(struct sc_map_##name *map)                 \
+    static uint32_t sc_map_find_##name(struct sc_map_##name *map, K key,       \
+                                       uint32_t hash)                          \
     {                                                                          \
-        uint32_t pos, cap, mod;                                                \
-        struct sc_map_item_##name *new;                                        \
-                                                                               \
-        if (map->size < map->remap) {                                          \
-            return true;                                                       \
-        }                                                                      \
+        const uint32_t mod = map->index_cap - 1;                               \
+        uint32_t i, pos = hash & mod;                                          \
+        struct sc_map_item_##name *t;                                          \
                                                                                \
-        cap = map->cap;                                                        \
-        new = sc_map_alloc_##name(&cap, 2);                                    \
-        if (new == NULL) {                                                     \
-            return false;                                                      \
+        if (map->index_cap == 0) {                                             \
+            return UINT32_MAX;                                                 \
         }                                                                      \
                                                                                \
-        mod = cap - 1;                                                         \
-                                                                               \
-        for (uint32_t i = 0; i < map->cap; i++) {                              \
-            if (map->mem[i].key != 0) {                                        \
-                pos = sc_map_hashof_##name(&map->mem[i]) & (mod);              \
-                                                                               \
-                while (true) {                                                 \
-                    if (new[pos].key == 0) {                                   \
-                        new[pos] = map->mem[i];                                \
-                        break;                                                 \
-                    }                                                          \
-                                                                               \
-                    pos = (pos + 1) & (mod);                                   \
-                }                                                              \
+        while ((i = map->index[pos]) != 0) {                                   \
+            t = &map->mem[i - 1];                                              \
+            if (t->hash == hash && cmp(t->key, key)) {                         \
+                return pos;                                                    \
             }                                                                  \
+            pos = (pos + 1) & mod;                                             \
         }                                                                      \
                                                                                \
-        if (map->mem != sc_map_empty_##name.mem) {                             \
-            sc_map_free(map->mem);                                             \
-        }                                                                      \
-                                                                               \
-        map->mem = new;                                                        \
-        map->cap = cap;                                                        \
-        map->remap = (uint32_t)(map->cap * ((double) map->load_factor / 100)); \
-                                                                               \
-        return true;                                                           \
+        return UINT32_MAX;                                                     \
     }                                                                          \
                                                                                \
     bool sc_map_put_##name(struct sc_map_##name *map, K key, V value)          \
     {                                                                          \
-        uint32_t pos, mod, hash;                                               \
+        uint32_t pos, mod, hash, cap, holes;                                   \
+        struct sc_map_item_##name *t;                                          \
                                                                                \
         if (key == 0) {                                                        \
             map->size += !map->used;                                           \
@@ -191,57 +2120,121 @@
             return true;                                                       \
         }                                                                      \
                                                                                \
-        if (!sc_map_remap_##name(map)) {                                       \
-            return false;                                                      \
+        hash = hash_fn(key);                                                   \
+        pos = sc_map_find_##name(map, key, hash);                              \
+        if (pos != UINT32_MAX) {                                               \
+            map->mem[map->index[pos] - 1].value = value;                       \
+            return true;                                                       \
         }                                                                      \
                                                                                \
-        mod = map->cap - 1;                                                    \
-        hash = hash_fn(key);                                                   \
-        pos = hash & (mod);                                                    \
+        if (map->size >= map->remap) {                                         \
+            cap = map->index_cap == 0 ? 8 : map->index_cap * 2;                \
+            if (!sc_map_reindex_##name(map, cap)) {                            \
+                return false;                                                  \
+            }                                                                  \
+        }                                                                      \
                                                                                \
-        while (true) {                                                         \
-            if (map->mem[pos].key == 0) {                                      \
-                map->size++;                                                   \
-            } else if (sc_map_cmp_##name(&map->mem[pos], key, hash) != true) { \
-                pos = (pos + 1) & (mod);                                       \
-                continue;                                                      \
+        if (map->cap == map->mem_cap) {                                        \
+            holes = map->cap - (map->size - map->used);                        \
+            if (holes >= map->cap / 4 && map->cap >= 8) {                      \
+                sc_map_compact_##name(map);                                    \
+            } else {                                                           \
+                cap = map->mem_cap < 4 ? 8 : map->mem_cap * 2;                 \
+                if (!sc_map_reserve_##name(map, cap)) {                        \
+                    return false;                                              \
+                }                                                              \
             }                                                                  \
+        }                                                                      \
                                                                                \
-            sc_map_assign_##name(&map->mem[pos], key, value, hash);            \
-            return true;                                                       \
+        t = &map->mem[map->cap];                                               \
+        t->key = key;                                                          \
+        t->value = value;                                                      \
+        t->hash = hash;                                                        \
+                                                                               \
+        mod = map->index_cap - 1;                                              \
+        pos = hash & mod;                                                      \
+        while (map->index[pos] != 0) {                                         \
+            pos = (pos + 1) & mod;                                             \
         }                                                                      \
+                                                                               \
+        map->index[pos] = ++map->cap;                                          \
+        map->size++;                                                           \
+                                                                               \
+        return true;                                                           \
     }                                                                          \
                                                                                \
     bool sc_map_get_##name(struct sc_map_##name *map, K key, V *value)         \
     {                                                                          \
-        const uint32_t mod = map->cap - 1;                                     \
-        uint32_t hash, pos;                                                    \
+        uint32_t pos;                                                          \
                                                                                \
         if (key == 0) {                                                        \
             *value = map->value;                                               \
             return map->used;                                                  \
         }                                                                      \
                                                                                \
-        hash = hash_fn(key);                                                   \
-        pos = hash & mod;                                                      \
+        pos = sc_map_find_##name(map, key, hash_fn(key));                      \
+        if (pos == UINT32_MAX) {                                               \
+            return false;                                                      \
+        }                                                                      \
                                                                                \
-        while (true) {                                                         \
-            if (map->mem[pos].key == 0) {                                      \
-                return false;                                                  \
-            } else if (sc_map_cmp_##name(&map->mem[pos], key, hash) != true) { \
-                pos = (pos + 1) & (mod);                                       \
-                continue;                                                      \
+        *value = map->mem[map->index[pos] - 1].value;                          \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    uint32_t sc_map_get_batch_##name(struct sc_map_##name *map, K const *keys, \
+                                     uint32_t n, V *values, bool *found)       \
+    {                                                                          \
+        const uint32_t mod = map->index_cap - 1;                               \
+        const bool indexed = map->index_cap != 0;                              \
+        uint32_t i, j, e, len, pos, count = 0, hashes[SC_MAP_BATCH];           \
+                                                                               \
+        for (i = 0; i < n; i += len) {                                         \
+            len = n - i < SC_MAP_BATCH ? n - i : SC_MAP_BATCH;                 \
+                                                                               \
+            for (j = 0; j < len; j++) {                                        \
+                if (keys[i + j] != 0) {                                        \
+                    hashes[j] = hash_fn(keys[i + j]);                          \
+                    if (indexed) {                                             \
+                        sc_map_prefetch(&map->index[hashes[j] & mod]);         \
+                    }                                                          \
+                }                                                              \
             }                                                                  \
                                                                                \
-            *value = map->mem[pos].value;                                      \
-            return true;                                                       \
+            /* Home index slots are in cache now, prefetch their items. */     \
+            for (j = 0; j < len && indexed; j++) {                             \
+                if (keys[i + j] != 0) {                                        \
+                    e = map->index[hashes[j] & mod];                           \
+                    if (e != 0) {                                              \
+                        sc_map_prefetch(&map->mem[e - 1]);                     \
+                    }                                                          \
+                }                                                              \
+            }                                                                  \
+                                                                               \
+            for (j = 0; j < len; j++) {                                        \
+                if (keys[i + j] == 0) {                                        \
+                    found[i + j] = map->used;                                  \
+                    values[i + j] = map->used ? map->value : values[i + j];    \
+                    count += map->used;                                        \
+                    continue;                                                  \
+                }                                                              \
+                                                                               \
+                pos = sc_map_find_##name(map, keys[i + j], hashes[j]);         \
+                found[i + j] = (pos != UINT32_MAX);                            \
+                if (pos != UINT32_MAX) {                                       \
+                    values[i + j] = map->mem[map->index[pos] - 1].value;       \
+                    count++;                                                   \
+                }                                                              \
+            }                                                                  \
         }                                                                      \
+                                                                               \
+        return count;                                                          \
     }                                                                          \
                                                                                \
     bool sc_map_del_##name(struct sc_map_##name *map, K key, V *value)         \
     {                                                                          \
-        const uint32_t mod = map->cap - 1;                                     \
-        uint32_t pos, prev_elem, curr, curr_orig, hash;                        \
+        const uint32_t mod = map->index_cap - 1;                               \
+        uint32_t pos, prev_elem, curr, curr_orig;                              \
+        struct sc_map_item_##name *t;                                          \
                                                                                \
         if (key == 0) {                                                        \
             bool ret = map->used;                                              \
@@ -255,64 +2248,64 @@
             return ret;                                                        \
         }                                                                      \
                                                                                \
-        hash = hash_fn(key);                                                   \
-        pos = hash & (mod);                                                    \
+        pos = sc_map_find_##name(map, key, hash_fn(key));                      \
+        if (pos == UINT32_MAX) {                                               \
+            return false;                                                      \
+        }                                                                      \
                                                                                \
-        while (true) {                                                         \
-            if (map->mem[pos].key == 0) {                                      \
-                return false;                                                  \
-            } else if (sc_map_cmp_##name(&map->mem[pos], key, hash) != true) { \
-                pos = (pos + 1) & (mod);                                       \
-                continue;                                                      \
-            }                                                                  \
+        t = &map->mem[map->index[pos] - 1];                                    \
+        t->key = 0;                                                            \
+        if (value != NULL) {                                                   \
+            *value = t->value;                                                 \
+        }                                                                      \
+        map->size--;                                                           \
                                                                                \
-            if (value != NULL) {                                               \
-                *value = map->mem[pos].value;                                  \
-            }                                                                  \
                                                                                \
-            map->size--;                                                       \
-            map->mem[pos].key = 0;                                             \
-            prev_elem = pos;                                                   \
-            curr = pos;                                                        \
+        /* Backward shift deletion on the index */                             \
+        map->index[pos] = 0;                                                   \
+        prev_elem = pos;                                                       \
+        curr = pos;                                                            \
                                                                                \
-            while (true) {                                                     \
-                curr = (curr + 1) & (mod);                                     \
-                if (map->mem[curr].key == 0) {                                 \
-                    break;                                                     \
-                }                                                              \
+        while (true) {                                                         \
+            curr = (curr + 1) & mod;                                           \
+            if (map->index[curr] == 0) {                                       \
+                break;                                                         \
+            }                                                                  \
                                                                                \
-                curr_orig = sc_map_hashof_##name(&map->mem[curr]) & (mod);     \
+            curr_orig = map->mem[map->index[curr] - 1].hash & mod;             \
                                                                                \
-                if ((curr_orig > curr &&                                       \
-                     (curr_orig <= prev_elem || curr >= prev_elem)) ||         \
-                    (curr_orig <= prev_elem && curr >= prev_elem)) {           \
+            if ((curr_orig > curr &&                                           \
+                 (curr_orig <= prev_elem || curr >= prev_elem)) ||             \
+                (curr_orig <= prev_elem && curr >= prev_elem)) {               \
                                                                                \
-                    map->mem[prev_elem] = map->mem[curr];                      \
-                    map->mem[curr].key = 0;                                    \
-                    prev_elem = curr;                                          \
-                }                                                              \
+                map->index[prev_elem] = map->index[curr];                      \
+                map->index[curr] = 0;                                          \
+                prev_elem = curr;                                              \
             }                                                                  \
+        }                                                                      \
                                                                                \
-            return true;                                                       \
+        /* Drop trailing holes, compact if more than half is holes. */         \
+        while (map->cap > 0 && map->mem[map->cap - 1].key == 0) {              \
+            map->cap--;                                                        \
+        }                                                                      \
+                                                                               \
+        if (map->cap >= 8 && (map->size - map->used) < map->cap / 2) {         \
+            sc_map_compact_##name(map);                                        \
         }                                                                      \
+                                                                               \
+        if (map->index_cap > 8 &&                                              \
+            sc_map_below(map->size, map->index_cap, map->low_water)) {         \
+            /* Map stays valid if this fails, just larger than needed. */      \
+            sc_map_shrink_##name(map);                                         \
+        }                                                                      \
+                                                                               \
+        return true;                                                           \
     }
 
-
-static uint32_t sc_map_hash_32(uint32_t a)
-{
-    return a;
-}
-
-static uint32_t sc_map_hash_64(uint64_t a)
-{
-    return ((uint32_t) a) ^ (uint32_t)(a >> 32u);
-}
-
 // clang-format off
-uint32_t murmurhash(const char *key)
+static uint32_t sc_map_murmur(const char *key, size_t len)
 {
     const uint64_t m = UINT64_C(0xc6a4a7935bd1e995);
-    const size_t len = strlen(key);
     const char *end = key + (len & ~(uint64_t) 0x7);
     uint64_t h = (len * m);
 
@@ -346,18 +2339,57 @@ uint32_t murmurhash(const char *key)
 
     return h;
 }
+// clang-format on
+
+uint32_t murmurhash(const char *key)
+{
+    return sc_map_murmur(key, strlen(key));
+}
+
+/**
+ * sc_str keeps the length in a header right before the string.
+ */
+static uint32_t sc_map_sc_str_len(const char *key)
+{
+    uint32_t len;
+
+    memcpy(&len, key - sizeof(len), sizeof(len));
+    return len;
+}
+
+static uint32_t sc_map_hash_sc_str(const char *key)
+{
+    return sc_map_murmur(key, sc_map_sc_str_len(key));
+}
+
 // clang-format off
 
 #define sc_map_varcmp(a, b) ((a) == (b))
 #define sc_map_strcmp(a, b) (!strcmp(a, b))
+#define sc_map_memcmp(a, b, len) (!memcmp(a, b, len))
 
 //                   name, key type, value type,    cmp           hash
-sc_map_impl_of_scalar(32,  uint32_t, uint32_t, sc_map_varcmp, sc_map_hash_32)
-sc_map_impl_of_scalar(64,  uint64_t, uint64_t, sc_map_varcmp, sc_map_hash_64)
-sc_map_impl_of_scalar(64v, uint64_t, void *,   sc_map_varcmp, sc_map_hash_64)
-sc_map_impl_of_scalar(64s, uint64_t, char *,   sc_map_varcmp, sc_map_hash_64)
+sc_map_impl_of_scalar(32,  uint32_t, uint32_t, sc_map_varcmp)
+sc_map_impl_of_scalar(64,  uint64_t, uint64_t, sc_map_varcmp)
+sc_map_impl_of_scalar(64v, uint64_t, void *,   sc_map_varcmp)
+sc_map_impl_of_scalar(64s, uint64_t, char *,   sc_map_varcmp)
+sc_map_impl_of_scalar(64m, uint64_t, uint64_t, sc_map_varcmp)
 sc_map_impl_of_strkey(str, char *,   char *,   sc_map_strcmp, murmurhash)
 sc_map_impl_of_strkey(sv,  char *,   void *,   sc_map_strcmp, murmurhash)
 sc_map_impl_of_strkey(s64, char *,   uint64_t, sc_map_strcmp, murmurhash)
+sc_map_impl_of_lenkey(lstr, char *,  char *,   sc_map_memcmp, sc_map_hash_sc_str)
+sc_map_impl_of_lenkey(lsv,  char *,  void *,   sc_map_memcmp, sc_map_hash_sc_str)
+sc_map_impl_of_lenkey(ls64, char *,  uint64_t, sc_map_memcmp, sc_map_hash_sc_str)
+sc_map_impl_of_inline(istr, char *,  char *,   sc_map_strcmp, murmurhash)
+sc_map_impl_of_inline(isv,  char *,  void *,   sc_map_strcmp, murmurhash)
+sc_map_impl_of_inline(is64, char *,  uint64_t, sc_map_strcmp, murmurhash)
+sc_map_impl_of_ordered(o64,  uint64_t, uint64_t, sc_map_varcmp, sc_map_hash_fmix64)
+sc_map_impl_of_ordered(o64v, uint64_t, void *,   sc_map_varcmp, sc_map_hash_fmix64)
+sc_map_impl_of_ordered(ostr, char *,   char *,   sc_map_strcmp, murmurhash)
+sc_map_impl_of_ordered(osv,  char *,   void *,   sc_map_strcmp, murmurhash)
+sc_map_impl_of_robin(r64,  uint64_t, uint64_t, sc_map_varcmp, sc_map_hash_fmix64)
+sc_map_impl_of_robin(r64v, uint64_t, void *,   sc_map_varcmp, sc_map_hash_fmix64)
+sc_map_impl_of_swiss(sw64,  uint64_t, uint64_t, sc_map_varcmp, sc_map_hash_fmix64)
+sc_map_impl_of_swiss(sw64v, uint64_t, void *,   sc_map_varcmp, sc_map_hash_fmix64)
 
         // clang-format on
@@ -31,6 +31,10 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
 #define sc_map_of_strkey(name, K, V)                                           \
     struct sc_map_item_##name                                                  \
     {                                                                          \
@@ -39,67 +43,745 @@
         uint32_t hash;                                                         \
     };                                                                         \
                                                                                \
-    sc_map_of(name, K, V)
+    sc_map_of(name, K, V)                                                      \
+    uint32_t sc_map_key_hash_##name(K key);
+
+/**
+ * Length-aware string keys. Keys must be sc_str strings (see string/sc_str.h),
+ * the key length is read from the sc_str header, so keys are never scanned for
+ * the terminating zero. Length is cached next to the hash, lookups reject
+ * mismatches on hash and length before touching key memory and then compare
+ * keys with a single memcmp().
+ */
+#define sc_map_of_lenkey(name, K, V)                                           \
+    struct sc_map_item_##name                                                  \
+    {                                                                          \
+        K key;                                                                 \
+        V value;                                                               \
+        uint32_t hash;                                                         \
+        uint32_t len;                                                          \
+    };                                                                         \
+                                                                               \
+    sc_map_of(name, K, V)                                                      \
+    uint32_t sc_map_key_hash_##name(K key);
+
+/**
+ * String keys shorter than SC_MAP_INLINE bytes are copied into the slot, so
+ * probing compares them without leaving the slot and the caller may release
+ * them after put. Longer keys are referenced like in sc_map_of_strkey maps and
+ * must stay valid while they are in the map. Keys returned from foreach macros
+ * point to the copy for short keys, they are valid until the map is modified.
+ *
+ * With 64-bit pointers and values, a slot is 64 bytes. Tables are cache line
+ * aligned, so each slot is exactly one cache line.
+ */
+#define SC_MAP_INLINE 44
+
+#define sc_map_of_inline(name, K, V)                                           \
+    struct sc_map_item_##name                                                  \
+    {                                                                          \
+        K key;                                                                 \
+        V value;                                                               \
+        uint32_t hash;                                                         \
+        char buf[SC_MAP_INLINE];                                               \
+    };                                                                         \
+                                                                               \
+    sc_map_of(name, K, V)                                                      \
+    uint32_t sc_map_key_hash_##name(K key);
+
+/**
+ * Integer keys. Each map picks its own hash, e.g. sc_map_hash_64 for keys that
+ * are sequential ids, sc_map_hash_wyhash for strided or patterned keys. The
+ * implementation in sc_map.c probes with sc_map_key_hash_##name() below, so
+ * the hash is only named here.
+ *
+ * hash_fn : uint32_t hash_fn(K key), see sc_map_hash_*().
+ */
+#define sc_map_of_scalar(name, K, V, hash_fn)                                  \
+    struct sc_map_item_##name                                                  \
+    {                                                                          \
+        K key;                                                                 \
+        V value;                                                               \
+    };                                                                         \
+                                                                               \
+    sc_map_of(name, K, V)                                                      \
+                                                                               \
+    static inline uint32_t sc_map_key_hash_##name(K key)                       \
+    {                                                                          \
+        return key != 0 ? hash_fn(key) : 0;                                    \
+    }
+
+/**
+ * Robin hood insertion for scalar keys. An insert takes the slot of any item
+ * that is closer to its home slot and moves that item further, so probe lengths
+ * stay short and even at high load factors. Lookups for missing keys stop as
+ * soon as the probe distance exceeds the distance of the visited item, without
+ * scanning to the next empty slot. Deletes use the same backward shift as other
+ * maps.
+ *
+ * The distance of an item is not stored, it is computed from the hash of its
+ * key, so items are as small as in sc_map_of_scalar maps. Use a cheap hash.
+ */
+#define sc_map_of_robin(name, K, V)                                            \
+    struct sc_map_item_##name                                                  \
+    {                                                                          \
+        K key;                                                                 \
+        V value;                                                               \
+    };                                                                         \
+                                                                               \
+    sc_map_of(name, K, V)                                                      \
+    uint32_t sc_map_key_hash_##name(K key);
+
+/**
+ * Swiss table style layout. A separate array of 1-byte control tags, one per
+ * slot, holds 7 bits of the hash or an empty/deleted marker. Lookups scan the
+ * tags 16 at a time (SSE2/NEON when available) and only touch the slots whose
+ * tag matches, so probing stays cheap at high load factors.
+ *
+ * Keys are stored in 'mem' like other maps, so sc_map_foreach() works as is.
+ */
+#define sc_map_of_swiss(name, K, V)                                            \
+    struct sc_map_item_##name                                                  \
+    {                                                                          \
+        K key;                                                                 \
+        V value;                                                               \
+    };                                                                         \
+                                                                               \
+    struct sc_map_##name                                                       \
+    {                                                                          \
+        struct sc_map_item_##name *mem;                                        \
+        struct sc_map_item_##name *old;                                        \
+        uint8_t *ctrl;                                                         \
+        uint32_t cap;                                                          \
+        uint32_t size;                                                         \
+        uint32_t deleted;                                                      \
+        uint32_t load_factor;                                                  \
+        uint32_t remap;                                                        \
+        uint32_t old_cap;                                                      \
+        uint32_t old_pos;                                                      \
+        uint32_t old_left;                                                     \
+        uint32_t step;                                                         \
+        uint32_t low_water;                                                    \
+        V value;                                                               \
+        bool used;                                                             \
+    };                                                                         \
+                                                                               \
+    sc_map_dec(name, K, V)
 
-#define sc_map_of_scalar(name, K, V)                                           \
+/**
+ * Insertion ordered compact map. Items are kept in a dense array in insertion
+ * order, a separate table of 32-bit positions indexes them. Foreach macros
+ * visit items in insertion order and only walk the dense array. In these maps,
+ * 'cap' is the length of the dense array, not the table size.
+ *
+ * Deleted items leave a hole, holes are removed when the array is full, before
+ * it grows. Incremental resize is not supported, sc_map_incremental_##name()
+ * has no effect.
+ */
+#define sc_map_of_ordered(name, K, V)                                          \
     struct sc_map_item_##name                                                  \
     {                                                                          \
         K key;                                                                 \
         V value;                                                               \
+        uint32_t hash;                                                         \
+    };                                                                         \
+                                                                               \
+    struct sc_map_##name                                                       \
+    {                                                                          \
+        struct sc_map_item_##name *mem;                                        \
+        struct sc_map_item_##name *old;                                        \
+        uint32_t *index;                                                       \
+        uint32_t cap;                                                          \
+        uint32_t old_cap;                                                      \
+        uint32_t mem_cap;                                                      \
+        uint32_t index_cap;                                                    \
+        uint32_t size;                                                         \
+        uint32_t load_factor;                                                  \
+        uint32_t remap;                                                        \
+        uint32_t low_water;                                                    \
+        V value;                                                               \
+        bool used;                                                             \
     };                                                                         \
                                                                                \
-    sc_map_of(name, K, V)
+    sc_map_dec(name, K, V)
+
+/**
+ * Define SC_MAP_STATS to collect statistics in linear probing maps: scalar,
+ * strkey, lenkey, inline and robin maps. It adds a 'stats' field to the map struct
+ * and sc_map_stats_##name(map, stats), which copies the counters and fills in
+ * occupancy fields. All translation units must agree on it, as it changes the
+ * struct layout. Off by default, it has no cost when off.
+ *
+ * Average probe length is get_probes / gets (or put_probes / puts). A probe
+ * is a slot visited, so a lookup that finds the key at its home slot is one
+ * probe. Gets and puts of key 0 are not counted. Remaps count both growing and
+ * shrinking; with incremental resize, migration steps are not timed.
+ *
+ * hist[i] is the number of items at distance 'i' from their home slot, the
+ * last bucket also counts items that are further away.
+ */
+#ifdef SC_MAP_STATS
+    #define SC_MAP_STATS_HIST 16
+
+struct sc_map_stats
+{
+    uint64_t gets;
+    uint64_t get_probes;
+    uint64_t get_max;
+    uint64_t puts;
+    uint64_t put_probes;
+    uint64_t put_max;
+    uint64_t remaps;
+    uint64_t remap_ns;
+
+    // Filled by sc_map_stats_##name()
+    uint64_t bytes;
+    uint32_t size;
+    uint32_t cap;
+    uint64_t hist[SC_MAP_STATS_HIST];
+};
+
+    #define sc_map_stats_field struct sc_map_stats stats;
+    #define sc_map_stats_dec(name)                                             \
+        void sc_map_stats_##name(struct sc_map_##name *map,                    \
+                                 struct sc_map_stats *stats);
+#else
+    #define sc_map_stats_field
+    #define sc_map_stats_dec(name)
+#endif
 
 #define sc_map_of(name, K, V)                                                  \
     struct sc_map_##name                                                       \
     {                                                                          \
         struct sc_map_item_##name *mem;                                        \
+        struct sc_map_item_##name *old;                                        \
         uint32_t cap;                                                          \
         uint32_t size;                                                         \
         uint32_t load_factor;                                                  \
         uint32_t remap;                                                        \
+        uint32_t old_cap;                                                      \
+        uint32_t old_pos;                                                      \
+        uint32_t old_left;                                                     \
+        uint32_t step;                                                         \
+        uint32_t low_water;                                                    \
         V value;                                                               \
         bool used;                                                             \
+        sc_map_stats_field                                                     \
     };                                                                         \
                                                                                \
+    sc_map_dec(name, K, V)                                                     \
+    sc_map_build_dec(name, K, V)                                               \
+    sc_map_stats_dec(name)
+
+/**
+ * Bulk insert, only for linear probing maps: scalar, strkey, lenkey, inline and
+ * robin maps.
+ *
+ * sc_map_build_##name(map, keys, values, n, threads) :
+ *
+ * Puts 'n' pairs into the map, keys[i] maps to values[i]. The table is grown
+ * once to hold all of them, then 'threads' threads insert at the same time,
+ * each one into its own range of slots, picked by the hash of the key. Items
+ * whose probe sequence leaves their range are put by the calling thread after
+ * the others are done. 'threads' is capped at SC_MAP_BUILD_THREADS and so that
+ * a range has at least SC_MAP_BUILD_SLOTS slots, '0' or '1' does it in the
+ * calling thread. If a key appears more than once, the last value is kept, as
+ * with sc_map_put_##name(). Returns false on out of memory, map stays as it
+ * is.
+ *
+ * sc_map_merge_##name(map, src) :
+ *
+ * Puts all items of 'src' into 'map', values of 'src' win for keys that exist
+ * in both. Maps that store the hash of the key (strkey, lenkey and inline) do
+ * not hash keys again. 'src' is not modified. Returns false on out of memory,
+ * map stays as it is.
+ */
+#define SC_MAP_BUILD_THREADS 64
+#define SC_MAP_BUILD_SLOTS   4096
+
+#define sc_map_build_dec(name, K, V)                                           \
+    bool sc_map_build_##name(struct sc_map_##name *map, K const *keys,         \
+                             V const *values, uint32_t n, uint32_t threads);   \
+    bool sc_map_merge_##name(struct sc_map_##name *map,                        \
+                             struct sc_map_##name *src);
+
+/**
+ * sc_map_incremental_##name(map, step) :
+ *
+ * By default, a map rehashes all items at once when it grows. If 'step' is not
+ * zero, the old table is kept next to the new one and each put/get/del call
+ * moves up to 'step' slots to the new table, so no single call pays for the
+ * whole rehash. If there are still items left in the old table when the map
+ * needs to grow again, they are moved at once.
+ *
+ * sc_map_get_batch_##name(map, keys, n, values, found) :
+ *
+ * Looks up 'n' keys. found[i] is set to whether keys[i] exists, values[i] is
+ * set only if it does. Returns found key count. Keys are hashed and their home
+ * slots are prefetched in groups before probing, so cache misses of a group
+ * overlap instead of being paid one by one as in sc_map_get_##name().
+ *
+ * sc_map_shrink_##name(map) :
+ *
+ * Moves items to the smallest table that holds them at the load factor and
+ * releases the rest, an empty map releases all of its memory. Incremental maps
+ * move items in steps as they do when growing. Returns false on out of memory,
+ * map stays as it is.
+ *
+ * sc_map_low_water_##name(map, percent) :
+ *
+ * Shrinks the map automatically when a delete drops the load below 'percent'
+ * and makes clear release the table. Zero disables it, it is the default.
+ * Must be less than half of the load factor, returns false otherwise.
+ *
+ * sc_map_mem_usage_##name(map) :
+ *
+ * Returns bytes allocated for the tables. Memory of the keys and values that
+ * items point to is not included.
+ *
+ * sc_map_key_hash_##name(key) :
+ * sc_map_put_hash_##name(map, key, val, hash) :
+ * sc_map_get_hash_##name(map, key, value, hash) :
+ * sc_map_del_hash_##name(map, key, value, hash) :
+ *
+ * Put, get and del for callers that already have the hash of the key, 'hash'
+ * must be sc_map_key_hash_##name(key). sc_cmap uses them to hash a key once,
+ * both to pick the shard and to probe it.
+ */
+#define sc_map_dec(name, K, V)                                                 \
     bool sc_map_init_##name(struct sc_map_##name *map, uint32_t cap,           \
                             uint32_t load_factor);                             \
     void sc_map_term_##name(struct sc_map_##name *map);                        \
+    void sc_map_incremental_##name(struct sc_map_##name *map, uint32_t step);  \
     uint32_t sc_map_size_##name(struct sc_map_##name *map);                    \
     void sc_map_clear_##name(struct sc_map_##name *map);                       \
     bool sc_map_put_##name(struct sc_map_##name *map, K key, V val);           \
     bool sc_map_get_##name(struct sc_map_##name *map, K key, V *value);        \
-    bool sc_map_del_##name(struct sc_map_##name *map, K key, V *value);
+    bool sc_map_del_##name(struct sc_map_##name *map, K key, V *value);        \
+    uint32_t sc_map_get_batch_##name(struct sc_map_##name *map, K const *keys, \
+                                     uint32_t n, V *values, bool *found);      \
+    bool sc_map_shrink_##name(struct sc_map_##name *map);                      \
+    bool sc_map_low_water_##name(struct sc_map_##name *map, uint32_t percent); \
+    size_t sc_map_mem_usage_##name(struct sc_map_##name *map);                 \
+    bool sc_map_put_hash_##name(struct sc_map_##name *map, K key, V val,       \
+                                uint32_t hash);                                \
+    bool sc_map_get_hash_##name(struct sc_map_##name *map, K key, V *value,    \
+                                uint32_t hash);                                \
+    bool sc_map_del_hash_##name(struct sc_map_##name *map, K key, V *value,    \
+                                uint32_t hash);
+
+/**
+ * While an incremental resize is in progress, items are spread over 'mem' and
+ * 'old', foreach macros visit both tables.
+ */
+#define sc_map_slot(map, i)                                                    \
+    ((i) < (map)->cap ? &(map)->mem[(i)] : &(map)->old[(i) - (map)->cap])
 
 #define sc_map_foreach(map, K, V)                                              \
-    for (uint32_t __i = 0, __b = 0; __i < (map)->cap; __i++)                   \
-        for ((V) = (map)->mem[__i].value, (K) = (map)->mem[__i].key, __b = 1;  \
-             __b && (V) != 0; __b = 0)
+    for (uint32_t __i = 0, __b = 0; __i < (map)->cap + (map)->old_cap; __i++)  \
+        for ((V) = sc_map_slot(map, __i)->value,                               \
+             (K) = sc_map_slot(map, __i)->key, __b = 1;                        \
+             __b && (K) != 0; __b = 0)
 
 #define sc_map_foreach_key(map, K)                                             \
-    for (uint32_t __i = 0, __b = 0; __i < (map)->cap; __i++)                   \
-        for ((K) = (map)->mem[__i].key, __b = 1; __b && (K) != 0; __b = 0)
+    for (uint32_t __i = 0, __b = 0; __i < (map)->cap + (map)->old_cap; __i++)  \
+        for ((K) = sc_map_slot(map, __i)->key, __b = 1; __b && (K) != 0;       \
+             __b = 0)
 
 #define sc_map_foreach_value(map, V)                                           \
-    for (uint32_t __i = 0, __b = 0; __i < (map)->cap; __i++)                   \
-        for ((V) = (map)->mem[__i].value, __b = 1; __b && (V) != 0; __b = 0)
+    for (uint32_t __i = 0, __b = 0; __i < (map)->cap + (map)->old_cap; __i++)  \
+        for ((V) = sc_map_slot(map, __i)->value, __b = 1;                      \
+             __b && sc_map_slot(map, __i)->key != 0; __b = 0)
 
 #define sc_map_calloc calloc
 #define sc_map_free   free
 
+/**
+ * Hash functions for integer keys. Except for the first two, each one mixes
+ * all bits of the key into the result, so sequential, strided or otherwise
+ * patterned keys spread evenly over the table. Run "sc_map_bench probe" to
+ * compare them on your keys.
+ *
+ * 32, 64         : Identity and xor of the halves, cheap but strided keys
+ *                  collide.
+ * fmix32, fmix64 : MurmurHash3 finalizers.
+ * wyhash         : wyhash 64-bit mixer, two 64x64->128 bit multiplies.
+ * rrmxmx         : XXH3 finalizer for 8-byte inputs, rotates and multiplies.
+ *
+ * Swiss maps take the position from the low bits and the control tag from the
+ * high bits of the hash, so they need a mixing hash. These are static inline,
+ * so maps generated with sc_map_of_pod() inline them into probing.
+ */
+static inline uint32_t sc_map_hash_32(uint32_t a)
+{
+    return a;
+}
+
+static inline uint32_t sc_map_hash_64(uint64_t a)
+{
+    return ((uint32_t) a) ^ (uint32_t)(a >> 32u);
+}
+
+static inline uint32_t sc_map_hash_fmix32(uint32_t a)
+{
+    a ^= a >> 16u;
+    a *= UINT32_C(0x85ebca6b);
+    a ^= a >> 13u;
+    a *= UINT32_C(0xc2b2ae35);
+    a ^= a >> 16u;
+
+    return a;
+}
+
+static inline uint32_t sc_map_hash_fmix64(uint64_t a)
+{
+    a ^= a >> 33u;
+    a *= UINT64_C(0xff51afd7ed558ccd);
+    a ^= a >> 33u;
+    a *= UINT64_C(0xc4ceb9fe1a85ec53);
+    a ^= a >> 33u;
+
+    return (uint32_t) a;
+}
+
+/**
+ * 64x64 -> 128 bit multiply, returns high and low halves xor'ed.
+ */
+static inline uint64_t sc_map_mum(uint64_t a, uint64_t b)
+{
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t) a * b;
+    return (uint64_t)(r >> 64u) ^ (uint64_t) r;
+#elif defined(_MSC_VER) && defined(_M_X64)
+    uint64_t hi, lo = _umul128(a, b, &hi);
+    return hi ^ lo;
+#else
+    uint64_t ha = a >> 32u, la = (uint32_t) a;
+    uint64_t hb = b >> 32u, lb = (uint32_t) b;
+    uint64_t hh = ha * hb, hl = ha * lb, lh = la * hb, ll = la * lb;
+    uint64_t mid = (ll >> 32u) + (uint32_t) hl + (uint32_t) lh;
+    uint64_t lo = (mid << 32u) | (uint32_t) ll;
+    uint64_t hi = hh + (hl >> 32u) + (lh >> 32u) + (mid >> 32u);
+
+    return hi ^ lo;
+#endif
+}
+
+static inline uint32_t sc_map_hash_wyhash(uint64_t a)
+{
+    a += UINT64_C(0x60bee2bee120fc15);
+    a = sc_map_mum(a, UINT64_C(0xa3b195354a39b70d));
+    a = sc_map_mum(a, UINT64_C(0x1b03738712fad5c9));
+
+    return (uint32_t) a;
+}
+
+static inline uint32_t sc_map_hash_rrmxmx(uint64_t a)
+{
+    a ^= ((a << 49u) | (a >> 15u)) ^ ((a << 24u) | (a >> 40u));
+    a *= UINT64_C(0x9fb21c651e98df25);
+    a ^= (a >> 35u) + 8;
+    a *= UINT64_C(0x9fb21c651e98df25);
+    a ^= a >> 28u;
+
+    return (uint32_t) a;
+}
+
 // clang-format off
 
-//              name  key type  value type);
-sc_map_of_scalar(32,  uint32_t, uint32_t)
-sc_map_of_scalar(64,  uint64_t, uint64_t)
-sc_map_of_scalar(64v, uint64_t, void *)
-sc_map_of_scalar(64s, uint64_t, char *)
+//              name  key type  value type  hash
+sc_map_of_scalar(32,  uint32_t, uint32_t, sc_map_hash_32)
+sc_map_of_scalar(64,  uint64_t, uint64_t, sc_map_hash_64)
+sc_map_of_scalar(64v, uint64_t, void *,   sc_map_hash_64)
+sc_map_of_scalar(64s, uint64_t, char *,   sc_map_hash_64)
+sc_map_of_scalar(64m, uint64_t, uint64_t, sc_map_hash_wyhash)
+
+//              name  key type  value type
 sc_map_of_strkey(str, char *,   char *)
 sc_map_of_strkey(sv,  char *,   void*)
 sc_map_of_strkey(s64, char *,   uint64_t)
+sc_map_of_lenkey(lstr, char *,  char *)
+sc_map_of_lenkey(lsv,  char *,  void *)
+sc_map_of_lenkey(ls64, char *,  uint64_t)
+sc_map_of_inline(istr, char *,  char *)
+sc_map_of_inline(isv,  char *,  void *)
+sc_map_of_inline(is64, char *,  uint64_t)
+sc_map_of_ordered(o64,  uint64_t, uint64_t)
+sc_map_of_ordered(o64v, uint64_t, void *)
+sc_map_of_ordered(ostr, char *,   char *)
+sc_map_of_ordered(osv,  char *,   void *)
+sc_map_of_robin(r64,  uint64_t, uint64_t)
+sc_map_of_robin(r64v, uint64_t, void *)
+sc_map_of_swiss(sw64,  uint64_t, uint64_t)
+sc_map_of_swiss(sw64v, uint64_t, void *)
 
 // clang-format on
 
+/**
+ * Header-only maps for user defined key and value types, e.g. struct keys.
+ * All functions are static inline, so hash and equality calls are inlined into
+ * probing. Any key value is valid, slot state is kept in a separate byte array
+ * instead of using a zero key.
+ *
+ * hash_fn : uint32_t hash_fn(K key), must mix all bits, see sc_map_hash_*().
+ * eq_fn   : bool eq_fn(K a, K b)
+ *
+ * e.g.
+ *   struct id { uint32_t tenant; uint64_t object; };
+ *
+ *   static inline uint32_t id_hash(struct id k) {...}
+ *   static inline bool id_eq(struct id a, struct id b) {...}
+ *
+ *   sc_map_of_pod(id, struct id, void *, id_hash, id_eq)
+ *
+ * Functions are named like the functions of other maps. Incremental resize,
+ * batch get and low water mark are not supported. Use sc_map_foreach_pod() to
+ * iterate, other foreach macros do not work with these maps.
+ */
+#define sc_map_of_pod(name, K, V, hash_fn, eq_fn)                              \
+    struct sc_map_item_##name                                                  \
+    {                                                                          \
+        K key;                                                                 \
+        V value;                                                               \
+    };                                                                         \
+                                                                               \
+    struct sc_map_##name                                                       \
+    {                                                                          \
+        struct sc_map_item_##name *mem;                                        \
+        uint8_t *used;                                                         \
+        uint32_t cap;                                                          \
+        uint32_t size;                                                         \
+        uint32_t load_factor;                                                  \
+        uint32_t remap;                                                        \
+    };                                                                         \
+                                                                               \
+    /* Allocates a table that holds 'n' items at the load factor. */           \
+    static inline bool sc_map_alloc_##name(struct sc_map_##name *map,          \
+                                           uint32_t n)                         \
+    {                                                                          \
+        uint64_t need = ((uint64_t) n * 100) / map->load_factor + 1;           \
+        uint32_t cap = 8;                                                      \
+        size_t bytes;                                                          \
+        void *p;                                                               \
+                                                                               \
+        if (need > (UINT32_C(1) << 31u) ||                                     \
+            need > SIZE_MAX / (sizeof(*map->mem) + 1)) {                       \
+            sc_map_on_error("Out of memory. n(%u).", n);                       \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        while (cap < need) {                                                   \
+            cap *= 2;                                                          \
+        }                                                                      \
+                                                                               \
+        bytes = (sizeof(*map->mem) + 1) * (size_t) cap;                        \
+        p = sc_map_calloc(1, bytes);                                           \
+        if (p == NULL) {                                                       \
+            sc_map_on_error("Out of memory. bytes(%zu).", bytes);              \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        map->mem = p;                                                          \
+        map->used = (uint8_t *) (map->mem + cap);                              \
+        map->cap = cap;                                                        \
+        map->remap = (uint32_t)(cap * ((double) map->load_factor / 100));      \
+                                                                               \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    static inline bool sc_map_init_##name(struct sc_map_##name *map,           \
+                                          uint32_t cap, uint32_t load_factor)  \
+    {                                                                          \
+        uint32_t f = (load_factor == 0) ? 75 : load_factor;                    \
+                                                                               \
+        if (f > 95 || f < 25) {                                                \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        *map = (struct sc_map_##name){.load_factor = f};                       \
+                                                                               \
+        return cap == 0 || sc_map_alloc_##name(map, cap);                      \
+    }                                                                          \
+                                                                               \
+    static inline void sc_map_term_##name(struct sc_map_##name *map)           \
+    {                                                                          \
+        sc_map_free(map->mem);                                                 \
+    }                                                                          \
+                                                                               \
+    static inline uint32_t sc_map_size_##name(struct sc_map_##name *map)       \
+    {                                                                          \
+        return map->size;                                                      \
+    }                                                                          \
+                                                                               \
+    static inline void sc_map_clear_##name(struct sc_map_##name *map)          \
+    {                                                                          \
+        if (map->size > 0) {                                                   \
+            memset(map->used, 0, map->cap);                                    \
+            map->size = 0;                                                     \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    static inline size_t sc_map_mem_usage_##name(struct sc_map_##name *map)    \
+    {                                                                          \
+        return (sizeof(*map->mem) + 1) * (size_t) map->cap;                    \
+    }                                                                          \
+                                                                               \
+    static inline uint32_t sc_map_find_##name(struct sc_map_##name *map,       \
+                                              K key)                           \
+    {                                                                          \
+        const uint32_t mod = map->cap - 1;                                     \
+        uint32_t pos;                                                          \
+                                                                               \
+        if (map->size == 0) {                                                  \
+            return UINT32_MAX;                                                 \
+        }                                                                      \
+                                                                               \
+        pos = hash_fn(key) & mod;                                              \
+        while (map->used[pos]) {                                               \
+            if (eq_fn(map->mem[pos].key, key)) {                               \
+                return pos;                                                    \
+            }                                                                  \
+            pos = (pos + 1) & mod;                                             \
+        }                                                                      \
+                                                                               \
+        return UINT32_MAX;                                                     \
+    }                                                                          \
+                                                                               \
+    /* Moves items to a table sized for 'n' items. */                          \
+    static inline bool sc_map_rehash_##name(struct sc_map_##name *map,         \
+                                            uint32_t n)                        \
+    {                                                                          \
+        uint32_t pos, mod;                                                     \
+        struct sc_map_##name prev = *map;                                      \
+                                                                               \
+        if (!sc_map_alloc_##name(map, n)) {                                    \
+            *map = prev;                                                       \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        mod = map->cap - 1;                                                    \
+        for (uint32_t i = 0; i < prev.cap; i++) {                              \
+            if (!prev.used[i]) {                                               \
+                continue;                                                      \
+            }                                                                  \
+                                                                               \
+            pos = hash_fn(prev.mem[i].key) & mod;                              \
+            while (map->used[pos]) {                                           \
+                pos = (pos + 1) & mod;                                         \
+            }                                                                  \
+                                                                               \
+            map->used[pos] = 1;                                                \
+            map->mem[pos] = prev.mem[i];                                       \
+        }                                                                      \
+                                                                               \
+        sc_map_free(prev.mem);                                                 \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    static inline bool sc_map_shrink_##name(struct sc_map_##name *map)         \
+    {                                                                          \
+        if (map->size == 0) {                                                  \
+            sc_map_free(map->mem);                                             \
+            *map = (struct sc_map_##name){.load_factor = map->load_factor};    \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        /* Sized for one more item, so the next put does not grow it back. */  \
+        if (((uint64_t) map->size + 1) * 100 / map->load_factor + 1 >          \
+            map->cap / 2) {                                                    \
+            return true;                                                       \
+        }                                                                      \
+                                                                               \
+        return sc_map_rehash_##name(map, map->size + 1);                       \
+    }                                                                          \
+                                                                               \
+    static inline bool sc_map_put_##name(struct sc_map_##name *map, K key,     \
+                                         V value)                              \
+    {                                                                          \
+        uint32_t pos, mod;                                                     \
+                                                                               \
+        if (map->size >= map->remap &&                                         \
+            !sc_map_rehash_##name(map, map->remap + 1)) {                      \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        mod = map->cap - 1;                                                    \
+        pos = hash_fn(key) & mod;                                              \
+                                                                               \
+        while (map->used[pos]) {                                               \
+            if (eq_fn(map->mem[pos].key, key)) {                               \
+                map->mem[pos].value = value;                                   \
+                return true;                                                   \
+            }                                                                  \
+            pos = (pos + 1) & mod;                                             \
+        }                                                                      \
+                                                                               \
+        map->used[pos] = 1;                                                    \
+        map->mem[pos].key = key;                                               \
+        map->mem[pos].value = value;                                           \
+        map->size++;                                                           \
+                                                                               \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    static inline bool sc_map_get_##name(struct sc_map_##name *map, K key,     \
+                                         V *value)                             \
+    {                                                                          \
+        uint32_t pos = sc_map_find_##name(map, key);                           \
+                                                                               \
+        if (pos == UINT32_MAX) {                                               \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        *value = map->mem[pos].value;                                          \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    static inline bool sc_map_del_##name(struct sc_map_##name *map, K key,     \
+                                         V *value)                             \
+    {                                                                          \
+        const uint32_t mod = map->cap - 1;                                     \
+        uint32_t prev, curr, orig, pos = sc_map_find_##name(map, key);         \
+                                                                               \
+        if (pos == UINT32_MAX) {                                               \
+            return false;                                                      \
+        }                                                                      \
+                                                                               \
+        if (value != NULL) {                                                   \
+            *value = map->mem[pos].value;                                      \
+        }                                                                      \
+                                                                               \
+        map->size--;                                                           \
+        map->used[pos] = 0;                                                    \
+        prev = pos;                                                            \
+        curr = pos;                                                            \
+                                                                               \
+        /* Backward shift, items that can move closer to home move back. */    \
+        while (true) {                                                         \
+            curr = (curr + 1) & mod;                                           \
+            if (!map->used[curr]) {                                            \
+                break;                                                         \
+            }                                                                  \
+                                                                               \
+            orig = hash_fn(map->mem[curr].key) & mod;                          \
+                                                                               \
+            if ((orig > curr && (orig <= prev || curr >= prev)) ||             \
+                (orig <= prev && curr >= prev)) {                              \
+                map->mem[prev] = map->mem[curr];                               \
+                map->used[prev] = 1;                                           \
+                map->used[curr] = 0;                                           \
+                prev = curr;                                                   \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        return true;                                                           \
+    }
+
+#define sc_map_foreach_pod(map, K, V)                                          \
+    for (uint32_t __i = 0, __b = 0; __i < (map)->cap; __i++)                   \
+        for ((K) = (map)->mem[__i].key, (V) = (map)->mem[__i].value, __b = 1;  \
+             __b && (map)->used[__i]; __b = 0)
+
 /**
 * If you want to log or abort on errors like out of memory,
 * put your error function here. It will be called with printf like error msg.
@@ -0,0 +1,200 @@
+#include "sc_queue.h"
+#include "sc_ring.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_COUNT 20000000ull
+#define BENCH_CAP   4096
+#define BENCH_BATCH 64
+
+static uint64_t time_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+static void report(const char *name, uint64_t elapsed, uint64_t sum)
+{
+    printf("%-8s msgs %llu  %8.2f ms  %6.2f ns/msg  %7.2f M msgs/s  (%llu)\n",
+           name, BENCH_COUNT, (double) elapsed / 1e6,
+           (double) elapsed / BENCH_COUNT, BENCH_COUNT * 1e3 / elapsed,
+           (unsigned long long) sum);
+}
+
+struct locked {
+    pthread_mutex_t mtx;
+    uint64_t *q;
+};
+
+static void *locked_producer(void *arg)
+{
+    struct locked *l = arg;
+
+    for (uint64_t i = 0; i < BENCH_COUNT;) {
+        pthread_mutex_lock(&l->mtx);
+        if (sc_queue_size(l->q) < BENCH_CAP) {
+            sc_queue_add_last(l->q, i);
+            i++;
+            pthread_mutex_unlock(&l->mtx);
+            continue;
+        }
+        pthread_mutex_unlock(&l->mtx);
+        sched_yield();
+    }
+
+    return NULL;
+}
+
+static void bench_mutex(void)
+{
+    struct locked l;
+    pthread_t producer;
+    uint64_t start, sum = 0, n = 0;
+
+    pthread_mutex_init(&l.mtx, NULL);
+    sc_queue_create(l.q, BENCH_CAP);
+
+    start = time_ns();
+    pthread_create(&producer, NULL, locked_producer, &l);
+
+    while (n < BENCH_COUNT) {
+        pthread_mutex_lock(&l.mtx);
+        if (!sc_queue_empty(l.q)) {
+            sum += sc_queue_remove_first(l.q);
+            n++;
+            pthread_mutex_unlock(&l.mtx);
+            continue;
+        }
+        pthread_mutex_unlock(&l.mtx);
+        sched_yield();
+    }
+
+    pthread_join(producer, NULL);
+    report("mutex", time_ns() - start, sum);
+
+    sc_queue_destroy(l.q);
+    pthread_mutex_destroy(&l.mtx);
+}
+
+static void *ring_producer(void *arg)
+{
+    struct sc_ring_64 *r = arg;
+
+    for (uint64_t i = 0; i < BENCH_COUNT;) {
+        if (sc_ring_push_64(r, i)) {
+            i++;
+        } else {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+static void bench_ring(void)
+{
+    struct sc_ring_64 r;
+    pthread_t producer;
+    uint64_t start, v, sum = 0, n = 0;
+
+    sc_ring_init_64(&r, BENCH_CAP);
+
+    start = time_ns();
+    pthread_create(&producer, NULL, ring_producer, &r);
+
+    while (n < BENCH_COUNT) {
+        if (sc_ring_pop_64(&r, &v)) {
+            sum += v;
+            n++;
+        } else {
+            sched_yield();
+        }
+    }
+
+    pthread_join(producer, NULL);
+    report("ring", time_ns() - start, sum);
+
+    sc_ring_term_64(&r);
+}
+
+static void *batch_producer(void *arg)
+{
+    struct sc_ring_64 *r = arg;
+    uint64_t a[BENCH_BATCH];
+    size_t k = BENCH_BATCH;
+
+    for (uint64_t i = 0; i < BENCH_COUNT; i += k) {
+        k = BENCH_COUNT - i < BENCH_BATCH ? BENCH_COUNT - i : BENCH_BATCH;
+        for (size_t j = 0; j < k; j++) {
+            a[j] = i + j;
+        }
+
+        k = sc_ring_push_n_64(r, a, k);
+        if (k == 0) {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+static void bench_batch(void)
+{
+    struct sc_ring_64 r;
+    pthread_t producer;
+    uint64_t a[BENCH_BATCH], start, sum = 0, n = 0;
+    size_t k;
+
+    sc_ring_init_64(&r, BENCH_CAP);
+
+    start = time_ns();
+    pthread_create(&producer, NULL, batch_producer, &r);
+
+    while (n < BENCH_COUNT) {
+        k = sc_ring_pop_n_64(&r, a, BENCH_BATCH);
+        if (k == 0) {
+            sched_yield();
+        }
+        for (size_t i = 0; i < k; i++) {
+            sum += a[i];
+        }
+        n += k;
+    }
+
+    pthread_join(producer, NULL);
+    report("batch", time_ns() - start, sum);
+
+    sc_ring_term_64(&r);
+}
+
+// clang-format off
+static const struct bench
+{
+    const char *name;
+    void (*fn)(void);
+} benches[] = {
+        {"mutex", bench_mutex},
+        {"ring",  bench_ring },
+        {"batch", bench_batch},
+};
+// clang-format on
+
+/**
+ * Usage : sc_queue_bench [name]   Runs all benchmarks if name is not given.
+ */
+int main(int argc, char *argv[])
+{
+    for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+        if (argc < 2 || strcmp(argv[1], benches[i].name) == 0) {
+            benches[i].fn();
+        }
+    }
+
+    return 0;
+}
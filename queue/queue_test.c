@@ -1,4 +1,5 @@
 #include "sc_queue.h"
+#include "sc_ring.h"
 
 #include <stddef.h>
 #include <stdio.h>
@@ -61,6 +62,15 @@ void fail_test(void)
     sc_queue_destroy(q);
     assert(sc_queue_create(q, max + 100) == false);
     fail_realloc = false;
+
+    struct sc_ring_64 r;
+
+    fail_realloc = true;
+    assert(!sc_ring_init_64(&r, 16));
+    fail_realloc = false;
+    assert(!sc_ring_init_64(&r, SIZE_MAX));
+    assert(sc_ring_init_64(&r, 16));
+    sc_ring_term_64(&r);
 }
 #else
 void fail_test(void)
@@ -152,10 +162,157 @@ void test1(void)
     sc_queue_destroy(p);
 }
 
+void test2(void)
+{
+    struct sc_ring_64 r;
+    uint64_t v, a[40], b[40];
+    uint64_t next = 0, expect = 0;
+
+    struct
+    {
+        int x;
+        struct sc_ring_64 r;
+    } embedded;
+
+    // Producer, consumer and read-only fields are on separate cache lines,
+    // wherever the ring is placed.
+    assert(offsetof(struct sc_ring, tail) == 0);
+    assert(offsetof(struct sc_ring, head) == SC_RING_CACHE_LINE);
+    assert(offsetof(struct sc_ring, cap) == 2 * SC_RING_CACHE_LINE);
+    assert(sizeof(struct sc_ring) == 3 * SC_RING_CACHE_LINE);
+    assert((uintptr_t) &embedded.r % SC_RING_CACHE_LINE == 0);
+    assert((uintptr_t) &r % SC_RING_CACHE_LINE == 0);
+
+    assert(sc_ring_init_64(&r, 0));
+    assert(r.r.cap == 2);
+    sc_ring_term_64(&r);
+
+    assert(sc_ring_init_64(&r, 5));
+    assert(r.r.cap == 8);
+    assert(sc_ring_size_64(&r) == 0);
+    assert(!sc_ring_pop_64(&r, &v));
+
+    for (int i = 0; i < 8; i++) {
+        assert(sc_ring_push_64(&r, next++));
+    }
+    assert(!sc_ring_push_64(&r, 100));
+    assert(sc_ring_size_64(&r) == 8);
+    assert(sc_ring_push_n_64(&r, a, 3) == 0);
+
+    // Single and batch calls across the wrap around point
+    for (int round = 0; round < 100; round++) {
+        size_t n = (size_t) round % 7 + 1, k;
+
+        k = sc_ring_pop_n_64(&r, b, n);
+        assert(k == n || sc_ring_size_64(&r) == 0);
+        for (size_t i = 0; i < k; i++) {
+            assert(b[i] == expect++);
+        }
+
+        if (sc_ring_pop_64(&r, &v)) {
+            assert(v == expect++);
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            a[i] = next + i;
+        }
+        k = sc_ring_push_n_64(&r, a, n);
+        next += k;
+        assert(sc_ring_size_64(&r) == next - expect);
+        assert(sc_ring_size_64(&r) <= 8);
+    }
+
+    while (sc_ring_pop_64(&r, &v)) {
+        assert(v == expect++);
+    }
+    assert(expect == next);
+    assert(sc_ring_pop_n_64(&r, b, 40) == 0);
+
+    sc_ring_term_64(&r);
+}
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <pthread.h>
+#include <sched.h>
+
+#define RING_COUNT 500000
+
+static void *ring_producer(void *arg)
+{
+    struct sc_ring_64 *r = arg;
+    uint64_t a[37];
+    uint64_t next = 0;
+    size_t n;
+
+    while (next < RING_COUNT) {
+        if (next % 3 == 0) {
+            if (sc_ring_push_64(r, next)) {
+                next++;
+            } else {
+                sched_yield();
+            }
+            continue;
+        }
+
+        n = RING_COUNT - next < 37 ? RING_COUNT - next : 37;
+        for (size_t i = 0; i < n; i++) {
+            a[i] = next + i;
+        }
+        n = sc_ring_push_n_64(r, a, n);
+        if (n == 0) {
+            sched_yield();
+        }
+        next += n;
+    }
+
+    return NULL;
+}
+
+void test3(void)
+{
+    struct sc_ring_64 r;
+    pthread_t producer;
+    uint64_t a[29], v, expect = 0;
+    size_t n;
+
+    assert(sc_ring_init_64(&r, 64));
+    assert(pthread_create(&producer, NULL, ring_producer, &r) == 0);
+
+    while (expect < RING_COUNT) {
+        if (expect % 2 == 0) {
+            if (sc_ring_pop_64(&r, &v)) {
+                assert(v == expect++);
+            } else {
+                sched_yield();
+            }
+            continue;
+        }
+
+        n = sc_ring_pop_n_64(&r, a, 29);
+        if (n == 0) {
+            sched_yield();
+        }
+        for (size_t i = 0; i < n; i++) {
+            assert(a[i] == expect++);
+        }
+    }
+
+    assert(pthread_join(producer, NULL) == 0);
+    assert(sc_ring_size_64(&r) == 0);
+    sc_ring_term_64(&r);
+}
+#else
+void test3(void)
+{
+}
+#endif
+
 int main(int argc, char *argv[])
 {
     fail_test();
     example();
     test1();
+    test2();
+    test3();
     return 0;
 }
@@ -0,0 +1,68 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "sc_ring.h"
+
+#include <stdlib.h>
+
+#ifndef SC_SIZE_MAX
+    #define SC_SIZE_MAX SIZE_MAX
+#endif
+
+bool sc_ring_init(struct sc_ring *r, size_t elem_size, size_t cap)
+{
+    const size_t max = SC_SIZE_MAX / elem_size;
+    size_t v = cap < 2 ? 2 : cap;
+
+    // Find next power of two.
+    v--;
+    for (size_t i = 1; i < sizeof(v) * 8; i *= 2) {
+        v |= v >> i;
+    }
+    v++;
+
+    if (cap > max || v == 0 || v > max) {
+        sc_ring_on_error("Max capacity has been exceed. cap(%zu). ", cap);
+        return false;
+    }
+
+    *r = (struct sc_ring){0};
+
+    r->elems = sc_ring_realloc(NULL, v * elem_size);
+    if (r->elems == NULL) {
+        sc_ring_on_error("Out of memory. alloc(%zu). ", v * elem_size);
+        return false;
+    }
+
+    r->cap = v;
+    r->mask = v - 1;
+
+    return true;
+}
+
+void sc_ring_term(struct sc_ring *r)
+{
+    sc_ring_free(r->elems);
+    *r = (struct sc_ring){0};
+}
@@ -0,0 +1,268 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Ozan Tezcan
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SC_RING_H
+#define SC_RING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Bounded single producer single consumer ring, for passing elements from one
+ * thread to another without locks.
+ *
+ * - Capacity is a power of two, indexes are masked as in sc_queue.
+ * - Producer and consumer indexes are on separate cache lines. Each side keeps
+ *   a cached copy of the other side's index and reloads it only when the ring
+ *   looks full (producer) or empty (consumer), so most calls touch no cache
+ *   line written by the other thread except the element slots.
+ * - Publishing is a release store of the own index, reading the other index is
+ *   an acquire load.
+ *
+ * Exactly one thread may push and exactly one thread may pop at a time.
+ */
+
+#define SC_RING_CACHE_LINE 64
+
+/**
+ * Internals, do not use
+ */
+
+/**
+ * Each side's fields are on their own cache line only if the ring starts on a
+ * line boundary. sc_ring is cache line aligned for that, if it is allocated on
+ * the heap, use an aligned allocator, e.g. aligned_alloc() or
+ * posix_memalign().
+ */
+#if defined(_MSC_VER)
+    #define sc_ring_aligned __declspec(align(SC_RING_CACHE_LINE))
+#else
+    #define sc_ring_aligned __attribute__((aligned(SC_RING_CACHE_LINE)))
+#endif
+
+struct sc_ring_aligned sc_ring
+{
+    // Producer side
+    size_t tail;
+    size_t head_cache;
+    uint8_t pad1[SC_RING_CACHE_LINE - 2 * sizeof(size_t)];
+
+    // Consumer side
+    size_t head;
+    size_t tail_cache;
+    uint8_t pad2[SC_RING_CACHE_LINE - 2 * sizeof(size_t)];
+
+    // Read only after init
+    size_t cap;
+    size_t mask;
+    void *elems;
+    uint8_t pad3[SC_RING_CACHE_LINE - 2 * sizeof(size_t) - sizeof(void *)];
+};
+
+bool sc_ring_init(struct sc_ring *r, size_t elem_size, size_t cap);
+void sc_ring_term(struct sc_ring *r);
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+
+// Plain loads and stores are acquire/release on x86 and x64.
+static inline size_t sc_ring_load(size_t *p)
+{
+    size_t v = *(volatile size_t *) p;
+    _ReadWriteBarrier();
+    return v;
+}
+
+static inline void sc_ring_store(size_t *p, size_t v)
+{
+    _ReadWriteBarrier();
+    *(volatile size_t *) p = v;
+}
+
+#else
+    #define sc_ring_load(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+    #define sc_ring_store(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#endif
+
+/**
+ * Internal End.
+ */
+
+/**
+* If you want to log or abort on errors like out of memory,
+* put your error function here. It will be called with printf like error msg.
+*
+* my_on_error(const char* fmt, ...);
+*/
+#define sc_ring_on_error(...)
+
+/**
+ * Plug your allocator if you want.
+ */
+#define sc_ring_realloc realloc
+#define sc_ring_free    free
+
+/**
+ * sc_ring_of(name, T) defines struct sc_ring_##name for elements of type T :
+ *
+ * bool   sc_ring_init_##name(r, cap)   : 'cap' is rounded up to a power of
+ *                                        two, returns false on out of memory.
+ * void   sc_ring_term_##name(r)        : Frees the ring, no thread may use it.
+ * bool   sc_ring_push_##name(r, v)     : Producer, false if the ring is full.
+ * bool   sc_ring_pop_##name(r, &v)     : Consumer, false if the ring is empty.
+ * size_t sc_ring_push_n_##name(r, a, n): Producer, pushes up to 'n' elements
+ *                                        from 'a', returns the pushed count.
+ * size_t sc_ring_pop_n_##name(r, a, n) : Consumer, pops up to 'n' elements to
+ *                                        'a', returns the popped count.
+ * size_t sc_ring_size_##name(r)        : Element count, may be stale.
+ *
+ * Batch functions publish all elements with a single store, the other side
+ * sees either none or all of them.
+ *
+ *      struct sc_ring_64 ring;
+ *
+ *      sc_ring_init_64(&ring, 1024);
+ *
+ *      // I/O thread                      // Worker thread
+ *      while (!sc_ring_push_64(&ring, v))  if (sc_ring_pop_64(&ring, &v)) {
+ *          ;                                   ...
+ *                                          }
+ */
+#define sc_ring_of(name, T)                                                    \
+    struct sc_ring_##name                                                      \
+    {                                                                          \
+        struct sc_ring r;                                                      \
+    };                                                                         \
+                                                                               \
+    static inline bool sc_ring_init_##name(struct sc_ring_##name *ring,        \
+                                           size_t cap)                         \
+    {                                                                          \
+        return sc_ring_init(&ring->r, sizeof(T), cap);                         \
+    }                                                                          \
+                                                                               \
+    static inline void sc_ring_term_##name(struct sc_ring_##name *ring)        \
+    {                                                                          \
+        sc_ring_term(&ring->r);                                                \
+    }                                                                          \
+                                                                               \
+    static inline bool sc_ring_push_##name(struct sc_ring_##name *ring, T v)   \
+    {                                                                          \
+        struct sc_ring *r = &ring->r;                                          \
+        const size_t tail = r->tail;                                           \
+                                                                               \
+        if (tail - r->head_cache == r->cap) {                                  \
+            r->head_cache = sc_ring_load(&r->head);                            \
+            if (tail - r->head_cache == r->cap) {                              \
+                return false;                                                  \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        ((T *) r->elems)[tail & r->mask] = v;                                  \
+        sc_ring_store(&r->tail, tail + 1);                                     \
+                                                                               \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    static inline bool sc_ring_pop_##name(struct sc_ring_##name *ring, T *v)   \
+    {                                                                          \
+        struct sc_ring *r = &ring->r;                                          \
+        const size_t head = r->head;                                           \
+                                                                               \
+        if (head == r->tail_cache) {                                           \
+            r->tail_cache = sc_ring_load(&r->tail);                            \
+            if (head == r->tail_cache) {                                       \
+                return false;                                                  \
+            }                                                                  \
+        }                                                                      \
+                                                                               \
+        *v = ((T *) r->elems)[head & r->mask];                                 \
+        sc_ring_store(&r->head, head + 1);                                     \
+                                                                               \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    static inline size_t sc_ring_push_n_##name(struct sc_ring_##name *ring,    \
+                                               const T *a, size_t n)           \
+    {                                                                          \
+        struct sc_ring *r = &ring->r;                                          \
+        const size_t tail = r->tail;                                           \
+        size_t room = r->cap - (tail - r->head_cache);                         \
+        size_t i, first;                                                       \
+                                                                               \
+        if (room < n) {                                                        \
+            r->head_cache = sc_ring_load(&r->head);                            \
+            room = r->cap - (tail - r->head_cache);                            \
+            n = room < n ? room : n;                                           \
+        }                                                                      \
+                                                                               \
+        i = tail & r->mask;                                                    \
+        first = r->cap - i < n ? r->cap - i : n;                               \
+        memcpy((T *) r->elems + i, a, first * sizeof(T));                      \
+        memcpy(r->elems, a + first, (n - first) * sizeof(T));                  \
+        sc_ring_store(&r->tail, tail + n);                                     \
+                                                                               \
+        return n;                                                              \
+    }                                                                          \
+                                                                               \
+    static inline size_t sc_ring_pop_n_##name(struct sc_ring_##name *ring,     \
+                                              T *a, size_t n)                  \
+    {                                                                          \
+        struct sc_ring *r = &ring->r;                                          \
+        const size_t head = r->head;                                           \
+        size_t avail = r->tail_cache - head;                                   \
+        size_t i, first;                                                       \
+                                                                               \
+        if (avail < n) {                                                       \
+            r->tail_cache = sc_ring_load(&r->tail);                            \
+            avail = r->tail_cache - head;                                      \
+            n = avail < n ? avail : n;                                         \
+        }                                                                      \
+                                                                               \
+        i = head & r->mask;                                                    \
+        first = r->cap - i < n ? r->cap - i : n;                               \
+        memcpy(a, (T *) r->elems + i, first * sizeof(T));                      \
+        memcpy(a + first, r->elems, (n - first) * sizeof(T));                  \
+        sc_ring_store(&r->head, head + n);                                     \
+                                                                               \
+        return n;                                                              \
+    }                                                                          \
+                                                                               \
+    static inline size_t sc_ring_size_##name(struct sc_ring_##name *ring)      \
+    {                                                                          \
+        const size_t head = sc_ring_load(&ring->r.head);                       \
+                                                                               \
+        return sc_ring_load(&ring->r.tail) - head;                             \
+    }
+
+// clang-format off
+
+//         name  type
+sc_ring_of(64,  uint64_t)
+sc_ring_of(ptr, void *)
+
+// clang-format on
+
+#endif